@@ -1,24 +1,34 @@
-QT       += core gui sql
+QT       += core gui sql concurrent network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++23
 
+# Everything below the windows; bench/ builds on the same
+include(backend.pri)
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
     addnewplaylistwindow.cpp \
-    db_sqlite.cpp \
+    folderwatcher.cpp \
+    headlesscli.cpp \
     main.cpp \
     mainwindow.cpp \
-    settings.cpp
+    metadataprober.cpp \
+    playerdiscovery.cpp \
+    settings.cpp \
+    startuptrace.cpp
 
 HEADERS += \
     addnewplaylistwindow.h \
-    include/db_sqlite.h \
-    include/structures.h \
+    include/folderwatcher.h \
+    include/headlesscli.h \
+    include/metadataprober.h \
+    include/playerdiscovery.h \
+    include/startuptrace.h \
     mainwindow.h \
     settings.h
 
@@ -1,13 +1,11 @@
 #include "addnewplaylistwindow.h"
 #include "ui_addnewplaylistwindow.h"
-#include <QCollator>
+#include "include/videoingest.h"
 #include <QDateTime>
 #include <QDebug>
 #include <QDir>
-#include <QDirIterator>
 #include <QStringList>
 #include <QVector>
-#include <algorithm>
 
 #define printdebug qDebug() << "[AddEditPlaylistWindow] "
 
@@ -26,8 +24,7 @@ AddNewPlaylistWindow::AddNewPlaylistWindow(QWidget *parent, int plListId,
         "<html><head/><body><p align=\"center\"><span style=\" "
         "font-size:16pt;\">Add New Playlist</span></p></body></html>");
 
-    vdos = getAllVideosFromDir(plpath);
-    ui->totalVideoCount->setText(QString::number(vdos.count));
+    startDirScan(plpath);
     ui->watchedVideoCount->setText(QString::number(0));
 
     QDir plPath(plpath);
@@ -46,9 +43,8 @@ AddNewPlaylistWindow::AddNewPlaylistWindow(QWidget *parent, int plListId,
     // NOTE: fetch info from database
     vdos = AddNewPlaylistWindow::getAllVideosFromDB();
 
-    QSqlQuery playlistInfo =
-        dbInstance->execQuery("SELECT * FROM Playlist WHERE playlistId = " +
-                              QString::number(playlistID) + ";");
+    QSqlQuery playlistInfo = dbInstance->execPrepared(
+        "SELECT * FROM Playlist WHERE playlistId = ?", {playlistID});
     while (playlistInfo.next()) {
       ui->folderPath->setText(playlistInfo.value("playlistPath").toString());
       ui->playlistTitle->setText(
@@ -62,11 +58,17 @@ AddNewPlaylistWindow::AddNewPlaylistWindow(QWidget *parent, int plListId,
           playlistInfo.value("totalTimeHour").toString());
       ui->playlistCreationDate->setText(
           playlistInfo.value("creationDateTime").toString());
+      ui->watchFolder->setChecked(playlistInfo.value("watchFolder").toInt());
     }
   }
 }
 
-AddNewPlaylistWindow::~AddNewPlaylistWindow() { delete ui; }
+AddNewPlaylistWindow::~AddNewPlaylistWindow() {
+  // Closing mid-scan: stop the workers, the scanner (a child) waits for them
+  if (scanner)
+    scanner->cancel();
+  delete ui;
+}
 
 void AddNewPlaylistWindow::on_pushButton_2_clicked() { // SAVE TO DB
   printdebug << "Started saving to DB";
@@ -76,152 +78,101 @@ void AddNewPlaylistWindow::on_pushButton_2_clicked() { // SAVE TO DB
   QString status =
       ui->comboBox->currentText(); // Status: Planned, Watching, Completed
 
-  // Note: Converting UI text to Int. ensuring defaults if empty.
-  int totalCount = ui->totalVideoCount->text().toInt();
-  int watchedCount = ui->watchedVideoCount->text().toInt();
+  // Video / watched counts are not taken from the labels: the Video
+  // triggers keep them (and a derived status) in line with the rows.
 
   // Assuming you have a widget for hours, if not change this to 0 or specific
   // widget name Based on your read logic, you seemed to imply a field for this.
   int totalHours =
       ui->totalHourWatched->text().toInt(); // Replace with  if widget exists
+  int watchFolder = ui->watchFolder->isChecked() ? 1 : 0;
 
-  // Simple sanitization for SQL strings (doubling single quotes)
-  QString safeTitle = title;
-  safeTitle.replace("'", "''");
-  QString safePath = path;
-  safePath.replace("'", "''");
+  // Writes run on DbWriter; the window stays up (save disabled) until they
+  // are committed, so MainWindow reloads the finished playlist.
+  ui->pushButton_2->setEnabled(false);
+  auto closeWhenSaved = [this]() {
+    // Close the window after saving
+    printdebug << "End saving data to DB";
+    close();
+  };
 
   /* ---- CASE 1 : New Playlist (Insert) ---- */
   if (playlistID == -1) {
-    // A. Insert the Playlist Record
-    QString sql =
-        QString("INSERT INTO Playlist (playlistTitle, playlistPath, status, "
-                "totalVideoCount, watchedCount, totalTimeHour) "
-                "VALUES ('%1', '%2', '%3', %4, %5, %6);")
-            .arg(safeTitle, safePath, status)
-            .arg(totalCount)
-            .arg(watchedCount)
-            .arg(totalHours);
-
-    QSqlQuery insertQuery = dbInstance->execQuery(sql);
-
-    // B. Get the ID of the playlist we just created
-    // We need this ID to link the videos in the Video table
-    // 2. Get the ID directly from the query object
-    // No need to run "SELECT last_insert_rowid()"
-    QVariant lastId = insertQuery.lastInsertId();
-
-    int newPlaylistID = -1;
-    if (lastId.isValid()) {
-      newPlaylistID = lastId.toInt();
-    }
-
-    // C. Insert all Videos found in the directory (from vdos struct)
-    /*
-        if (newPlaylistID != -1 && !vdos.fileList.isEmpty()) {
-          // Optimization: In a real app, use a Transaction here for speed
-          for (const QString &videoPath : vdos.fileList) {
-            QString safeVideoPath = videoPath;
-            safeVideoPath.replace("'", "''"); // Escape quotes in filenames
-
-            QString videoSql =
-                QString(
-                    "INSERT INTO Video (playlistID, videoPath) VALUES (%1,
-       '%2');") .arg(newPlaylistID) .arg(safeVideoPath);
-            dbInstance->execQuery(videoSql);
-          }    }
-    */
-    if (newPlaylistID != -1 && !vdos.fileList.isEmpty()) {
-
-      // 1. Start Transaction
-      dbInstance->execQuery("BEGIN TRANSACTION;");
-
-      for (const QString &videoPath : vdos.fileList) {
-        QString safeVideoPath = videoPath;
-        qDebug() << safeVideoPath;
-        safeVideoPath.replace("'", "''");
-
-        QString videoSql =
-            QString(
-                "INSERT INTO Video (playlistID, videoPath) VALUES (%1, '%2');")
-                .arg(newPlaylistID)
-                .arg(safeVideoPath);
-        dbInstance->execQuery(videoSql);
-      }
-
-      // 2. Commit Transaction
-      dbInstance->execQuery("COMMIT;");
-    }
+    const VideoCollection videos = vdos;
+    Playlist pl{};
+    pl.playlistTitle = title;
+    pl.playlistPath = path;
+    pl.status = status;
+    pl.totalTimeHour = totalHours;
+    pl.watchFolder = watchFolder;
+    DbWriter::instance()
+        ->run([pl, videos]() {
+          // Playlist row, then all videos found in the directory: chunked
+          // transactions + multi-row INSERTs, titles and sort keys
+          // precomputed, folder fingerprints seeded for rescans
+          return VideoIngest::createPlaylist(pl, videos);
+        })
+        .then(this, [closeWhenSaved](int) { closeWhenSaved(); });
   }
 
   /* ---- CASE 2 : Edit Existing Playlist (Update) ---- */
   else if (playlistID >= 0) {
-    // We update Title, Status, Counts, and set updatingDateTime to NOW
+    // We update Title, Status, and set updatingDateTime to NOW
     // We usually do NOT update the Video list here unless you want to re-scan
     // the folder
 
-    QString sql = QString("UPDATE Playlist SET "
-                          "playlistTitle = '%1', "
-                          "status = '%2', "
-                          "totalVideoCount = %3, "
-                          "watchedCount = %4, "
-                          "totalTimeHour = %5, "
-                          "updatingDateTime = CURRENT_TIMESTAMP "
-                          "WHERE playlistId = %6;")
-                      .arg(safeTitle, status)
-                      .arg(totalCount)
-                      .arg(watchedCount)
-                      .arg(totalHours)
-                      .arg(playlistID);
-
-    dbInstance->execQuery(sql);
+    DbWriter::instance()
+        ->enqueue("UPDATE Playlist SET "
+                  "playlistTitle = ?, "
+                  "status = ?, "
+                  "totalTimeHour = ?, "
+                  "watchFolder = ?, "
+                  "updatingDateTime = CURRENT_TIMESTAMP "
+                  "WHERE playlistId = ?",
+                  {title, status, totalHours, watchFolder, playlistID})
+        .then(this, [closeWhenSaved](const WriteResult &) { closeWhenSaved(); });
   }
-
-  // Close the window after saving
-
-  printdebug << "End saving data to DB";
-  close();
 }
 
-VideoCollection AddNewPlaylistWindow::getAllVideosFromDir(QString rootPath) {
-  VideoCollection result;
-  result.count = 0;
-
-  // 1. Define what counts as a "Video"
-  QStringList filters;
-  filters << "*.mp4" << "*.avi" << "*.mkv" << "*.mov"
-          << "*.wmv" << "*.flv" << "*.webm" << "*.ts";
-
-  // 2. Setup the Iterator
-  // QDir::Files -> Only look for files (not folders)
-  // QDir::NoDotAndDotDot -> Skip "." and ".."
-  // QDirIterator::Subdirectories -> RECURSIVE (Looks inside nested folders)
-  QDirIterator it(rootPath, filters, QDir::Files | QDir::NoDotAndDotDot,
-                  QDirIterator::Subdirectories);
-
-  // 3. Iterate through the directory tree
-  while (it.hasNext()) {
-    QString fullPath = it.next(); // Returns full absolute path (e.g.,
-    // C:/Movies/Action/Matrix.mp4)
-    result.fileList.append(fullPath);
-    result.count++;
-  }
-
-  QCollator collator;
-  collator.setNumericMode(true);
-  collator.setCaseSensitivity(Qt::CaseInsensitive);
-  std::sort(result.fileList.begin(), result.fileList.end(), collator);
-  return result;
+void AddNewPlaylistWindow::startDirScan(const QString &rootPath) {
+  // Scanning runs on a worker pool; the window stays responsive and the
+  // count label grows folder by folder. Saving waits for the full list.
+  scanner = new VideoScanner(this);
+  ui->pushButton_2->setEnabled(false);
+  ui->totalVideoCount->setText("0 (scanning...)");
+
+  connect(scanner, &VideoScanner::progress, this,
+          [this](int dirsScanned, int dirsPending, int filesFound) {
+            ui->totalVideoCount->setText(
+                QString("%1 (scanning... %2 folders done, %3 left)")
+                    .arg(filesFound)
+                    .arg(dirsScanned)
+                    .arg(dirsPending));
+          });
+
+  connect(scanner, &VideoScanner::finished, this,
+          [this](const VideoCollection &found) {
+            vdos = found;
+            ui->totalVideoCount->setText(QString::number(vdos.count));
+            ui->pushButton_2->setEnabled(true);
+            printdebug << "Directory scan done. Videos:" << vdos.count;
+          });
+
+  scanner->start(rootPath);
 }
 
 VideoCollection AddNewPlaylistWindow::getAllVideosFromDB() {
-  QSqlQuery allVdosFromDb = dbInstance->execQuery(
-      "SELECT * FROM Video WHERE playlistID = " + QString::number(playlistID) +
-      ";");
-
+  // Rows hold videoPath below the playlist folder
+  QSqlQuery root = dbInstance->execPrepared(
+      "SELECT playlistPath FROM Playlist WHERE playlistId = ?", {playlistID});
   VideoCollection vdos;
+  vdos.fileList = PathStore(root.next() ? root.value(0).toString() : QString());
+  root.finish();
+
+  QSqlQuery allVdosFromDb = dbInstance->execPrepared(
+      "SELECT videoPath FROM Video WHERE playlistID = ?", {playlistID});
   while (allVdosFromDb.next()) {
-    vdos.fileList.append(allVdosFromDb.value("videoPath").toString());
+    vdos.fileList.add(allVdosFromDb.value("videoPath").toString());
   }
   vdos.count = vdos.fileList.size();
   return vdos;
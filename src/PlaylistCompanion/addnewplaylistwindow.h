@@ -3,17 +3,14 @@
 
 #include <QWidget>
 #include <include/db_sqlite.h>
+#include <include/dbwriter.h>
+#include <include/structures.h>
+#include <include/videoscanner.h>
 
 namespace Ui {
 class AddNewPlaylistWindow;
 }
 
-struct VideoCollection {
-    QVector<QString> fileList; // Contains full absolute path + filename
-    int count;
-};
-
-
 class AddNewPlaylistWindow : public QWidget
 {
     Q_OBJECT
@@ -30,8 +27,9 @@ private:
     SQliteDB *dbInstance;
     VideoCollection vdos;
     int playlistID;
+    VideoScanner *scanner = nullptr;
 
-    VideoCollection getAllVideosFromDir(QString rootPath);
+    void startDirScan(const QString &rootPath);
     VideoCollection getAllVideosFromDB();
 };
 
@@ -0,0 +1,70 @@
+# Backend of the app without widgets: SQLite and its writer, migrations,
+# backups, scanning, ingest, rescans, search, the video table model,
+# thumbnails and the player controller. Shared by PlaylistCompanion.pro and
+# bench/bench.pro.
+
+QT += core gui sql concurrent network
+
+INCLUDEPATH += $$PWD
+
+# SQLite C API for online backups (dbbackup.cpp). Qt's QSQLITE plugin must
+# use the same library (-system-sqlite, the default of Linux distro Qt);
+# DbBackup::checkDriver() disables backups of the live file otherwise.
+unix: CONFIG += link_pkgconfig
+unix: PKGCONFIG += sqlite3
+win32: LIBS += -lsqlite3
+
+# zstd for the chunks of the backup store; zlib (qCompress) without it
+unix:packagesExist(libzstd) {
+    PKGCONFIG += libzstd
+    DEFINES += PLC_HAVE_ZSTD
+}
+
+# Frame grabs for thumbnails of videos without cover art (thumbnailservice)
+qtHaveModule(multimedia) {
+    QT += multimedia
+    DEFINES += PLC_HAVE_MULTIMEDIA
+}
+
+# Hot-path spans (include/tracing.h): qmake CONFIG+=tracing
+CONFIG(tracing): DEFINES += PLC_TRACING
+
+SOURCES += \
+    $$PWD/backupstore.cpp \
+    $$PWD/db_migrations.cpp \
+    $$PWD/db_sqlite.cpp \
+    $$PWD/dbbackup.cpp \
+    $$PWD/dbevents.cpp \
+    $$PWD/dbwriter.cpp \
+    $$PWD/mediaprobe.cpp \
+    $$PWD/naturalsortkey.cpp \
+    $$PWD/pathstore.cpp \
+    $$PWD/playercontroller.cpp \
+    $$PWD/playlistrescanner.cpp \
+    $$PWD/thumbnailservice.cpp \
+    $$PWD/tracing.cpp \
+    $$PWD/videoingest.cpp \
+    $$PWD/videoscanner.cpp \
+    $$PWD/videosearch.cpp \
+    $$PWD/videotablemodel.cpp \
+    $$PWD/watchhistory.cpp
+
+HEADERS += \
+    $$PWD/include/backupstore.h \
+    $$PWD/include/db_sqlite.h \
+    $$PWD/include/dbbackup.h \
+    $$PWD/include/dbevents.h \
+    $$PWD/include/dbwriter.h \
+    $$PWD/include/mediaprobe.h \
+    $$PWD/include/naturalsortkey.h \
+    $$PWD/include/pathstore.h \
+    $$PWD/include/playercontroller.h \
+    $$PWD/include/playlistrescanner.h \
+    $$PWD/include/structures.h \
+    $$PWD/include/thumbnailservice.h \
+    $$PWD/include/tracing.h \
+    $$PWD/include/videoingest.h \
+    $$PWD/include/videoscanner.h \
+    $$PWD/include/videosearch.h \
+    $$PWD/include/videotablemodel.h \
+    $$PWD/include/watchhistory.h
@@ -0,0 +1,509 @@
+#include "include/backupstore.h"
+#include "include/db_sqlite.h"
+#include "include/dbbackup.h"
+#include "include/tracing.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtEndian>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#ifdef PLC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+#ifdef PLC_HAVE_ZSTD
+const QString kCodec = "zstd";
+#else
+const QString kCodec = "zlib"; // qCompress, when built without libzstd
+#endif
+constexpr int kManifestFormat = 1;
+constexpr int kStartupDelayMs = 60 * 1000; // overdue snapshot after start
+
+QString idFor(const QDateTime &created) {
+  return created.toString("yyyy-MM-dd_HH-mm-ss");
+}
+
+QString manifestPath(const QString &id) {
+  return BackupStore::storePath() + "manifests/" + id + ".json";
+}
+
+} // namespace
+
+BackupStore *BackupStore::storeInstance = nullptr;
+QRecursiveMutex BackupStore::storeMutex;
+
+BackupStore *BackupStore::instance() {
+  if (!storeInstance)
+    storeInstance = new BackupStore();
+  return storeInstance;
+}
+
+void BackupStore::shutdown() {
+  if (!storeInstance)
+    return;
+  delete storeInstance;
+  storeInstance = nullptr;
+}
+
+BackupStore::BackupStore(QObject *parent) : QObject(parent) {
+  connect(&watcher, &QFutureWatcher<JobResult>::finished, this,
+          &BackupStore::onJobDone);
+  connect(&autoTimer, &QTimer::timeout, this, [this]() { start(); });
+}
+
+BackupStore::~BackupStore() { watcher.waitForFinished(); }
+
+QString BackupStore::storePath() {
+  return SQliteDB::getDbDirPath() + "backups/";
+}
+
+QString BackupStore::chunkPath(const QString &hash, const QString &codec) {
+  return storePath() + "chunks/" + hash.left(2) + "/" + hash +
+         (codec == "zstd" ? ".zst" : ".z");
+}
+
+QByteArray BackupStore::compress(const QByteArray &raw, const QString &codec) {
+  if (codec == "zlib")
+    return qCompress(raw);
+#ifdef PLC_HAVE_ZSTD
+  QByteArray packed(qsizetype(ZSTD_compressBound(raw.size())),
+                    Qt::Uninitialized);
+  const size_t size = ZSTD_compress(packed.data(), packed.size(),
+                                    raw.constData(), raw.size(), kZstdLevel);
+  if (ZSTD_isError(size))
+    return QByteArray();
+  packed.resize(qsizetype(size));
+  return packed;
+#else
+  return QByteArray();
+#endif
+}
+
+QByteArray BackupStore::decompress(const QByteArray &packed,
+                                   const QString &codec, bool *ok) {
+  QByteArray raw;
+  if (codec == "zlib") {
+    raw = qUncompress(packed);
+  }
+#ifdef PLC_HAVE_ZSTD
+  else if (codec == "zstd") {
+    raw.resize(kChunkSize);
+    const size_t size = ZSTD_decompress(raw.data(), raw.size(),
+                                        packed.constData(), packed.size());
+    raw.resize(ZSTD_isError(size) ? 0 : qsizetype(size));
+  }
+#endif
+  *ok = !raw.isEmpty(); // a chunk is never empty
+  return raw;
+}
+
+bool BackupStore::readManifest(const QString &id, SnapshotInfo *info,
+                               QStringList *chunks, QString *codec,
+                               QByteArray *fileHash) {
+  QFile file(manifestPath(id));
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+  if (root.value("format").toInt() != kManifestFormat)
+    return false;
+
+  if (info) {
+    info->id = id;
+    info->created =
+        QDateTime::fromString(root.value("created").toString(), Qt::ISODate);
+    info->schemaVersion = root.value("schemaVersion").toInt();
+    info->size = root.value("size").toInteger();
+    info->chunkCount = int(root.value("chunks").toArray().size());
+    info->newChunks = root.value("newChunks").toInt();
+    info->storedBytes = root.value("storedBytes").toInteger();
+  }
+  if (chunks) {
+    chunks->clear();
+    for (const QJsonValue &hash : root.value("chunks").toArray())
+      chunks->append(hash.toString());
+  }
+  if (codec)
+    *codec = root.value("codec").toString();
+  if (fileHash)
+    *fileHash = root.value("sha256").toString().toLatin1();
+  return true;
+}
+
+bool BackupStore::snapshot(const QString &srcPath, SnapshotInfo *info,
+                           QString *error,
+                           const std::function<void(int, int)> &progress,
+                           const QDateTime &created) {
+  PLC_TRACE_SPAN(span, "backup.snapshot");
+  QMutexLocker locker(&storeMutex);
+  const auto fail = [error](const QString &reason) {
+    if (error)
+      *error = reason;
+    return false;
+  };
+
+  QDir store(storePath());
+  if (!store.mkpath("manifests") || !store.mkpath("chunks"))
+    return fail("Can not create the backup store: " + storePath());
+
+  // 1. A consistent, verified copy first; the chunks are cut from it
+  const QString copyPath = store.filePath("snapshot.tmp.sqlite");
+  const BackupResult copied = DbBackup::copy(srcPath, copyPath, progress);
+  if (!copied.ok)
+    return fail(copied.error);
+
+  QFile file(copyPath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    QFile::remove(copyPath);
+    return fail("Can not read the copy: " + copyPath);
+  }
+
+  SnapshotInfo snap;
+  snap.created = created;
+  snap.size = file.size();
+  // PRAGMA user_version: 4 bytes big-endian at offset 60 of the header
+  const QByteArray header = file.peek(100);
+  if (header.size() == 100)
+    snap.schemaVersion = qFromBigEndian<qint32>(header.constData() + 60);
+
+  // 2. Store the chunks that are not in the store yet
+  QStringList chunks;
+  QCryptographicHash fileHash(QCryptographicHash::Sha256);
+  QString writeError;
+  while (writeError.isEmpty()) {
+    const QByteArray raw = file.read(kChunkSize);
+    if (raw.isEmpty())
+      break;
+    fileHash.addData(raw);
+    const QString hash = QString::fromLatin1(
+        QCryptographicHash::hash(raw, QCryptographicHash::Sha256).toHex());
+    chunks.append(hash);
+
+    const QString path = chunkPath(hash, kCodec);
+    if (QFile::exists(path))
+      continue;
+    const QByteArray packed = compress(raw, kCodec);
+    QSaveFile out(path); // never a half-written chunk under its hash
+    if (packed.isEmpty() || !store.mkpath("chunks/" + hash.left(2)) ||
+        !out.open(QIODevice::WriteOnly) || out.write(packed) != packed.size() ||
+        !out.commit()) {
+      writeError = "Can not store chunk " + path;
+      break;
+    }
+    snap.newChunks++;
+    snap.storedBytes += packed.size();
+  }
+  file.close();
+  QFile::remove(copyPath);
+  if (!writeError.isEmpty())
+    return fail(writeError);
+  snap.chunkCount = int(chunks.size());
+
+  // 3. Nothing changed since the newest snapshot: no new manifest
+  const QVector<SnapshotInfo> existing = listSnapshots();
+  QStringList newestChunks;
+  if (!existing.isEmpty() &&
+      readManifest(existing.first().id, nullptr, &newestChunks, nullptr,
+                   nullptr) &&
+      newestChunks == chunks) {
+    snap.id = existing.first().id;
+    snap.unchanged = true;
+    if (info)
+      *info = snap;
+    storedebug << "no changes since" << snap.id;
+    return true;
+  }
+
+  // 4. The manifest makes the snapshot visible, so it is written last
+  snap.id = idFor(created);
+  for (int n = 2; QFile::exists(manifestPath(snap.id)); ++n)
+    snap.id = idFor(created) + "-" + QString::number(n);
+
+  QJsonObject root;
+  root["format"] = kManifestFormat;
+  root["created"] = created.toString(Qt::ISODate);
+  root["schemaVersion"] = snap.schemaVersion;
+  root["size"] = snap.size;
+  root["chunkSize"] = kChunkSize;
+  root["codec"] = kCodec;
+  root["sha256"] = QString::fromLatin1(fileHash.result().toHex());
+  root["newChunks"] = snap.newChunks;
+  root["storedBytes"] = snap.storedBytes;
+  root["chunks"] = QJsonArray::fromStringList(chunks);
+
+  QSaveFile manifest(manifestPath(snap.id));
+  const QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Compact);
+  if (!manifest.open(QIODevice::WriteOnly) ||
+      manifest.write(json) != json.size() || !manifest.commit())
+    return fail("Can not write manifest " + manifestPath(snap.id));
+
+  storedebug << "snapshot" << snap.id << ":" << snap.newChunks << "of"
+             << snap.chunkCount << "chunks new," << snap.storedBytes
+             << "bytes stored";
+  if (info)
+    *info = snap;
+  return true;
+}
+
+QVector<SnapshotInfo> BackupStore::listSnapshots() {
+  // No lock: manifests appear atomically (QSaveFile), so the GUI thread can
+  // list them while a snapshot runs. One pruned meanwhile is just skipped.
+  QVector<SnapshotInfo> snapshots;
+  const QFileInfoList manifests =
+      QDir(storePath() + "manifests").entryInfoList({"*.json"}, QDir::Files);
+  for (const QFileInfo &fi : manifests) {
+    SnapshotInfo info;
+    if (readManifest(fi.completeBaseName(), &info, nullptr, nullptr, nullptr))
+      snapshots.append(info);
+    else if (fi.exists())
+      qWarning() << "[BackupStore] unreadable manifest:" << fi.fileName();
+  }
+  std::sort(snapshots.begin(), snapshots.end(),
+            [](const SnapshotInfo &a, const SnapshotInfo &b) {
+              return a.created > b.created;
+            });
+  return snapshots;
+}
+
+bool BackupStore::rebuild(const QString &id, const QString &destPath,
+                          QString *error) {
+  PLC_TRACE_SPAN(span, "backup.rebuild");
+  PLC_TRACE_DETAIL(span, id);
+  QMutexLocker locker(&storeMutex);
+  const auto fail = [error](const QString &reason) {
+    if (error)
+      *error = reason;
+    return false;
+  };
+
+  QStringList chunks;
+  QString codec;
+  QByteArray expectedHash;
+  if (!readManifest(id, nullptr, &chunks, &codec, &expectedHash))
+    return fail("Snapshot not found: " + id);
+
+  // 1. Chunks in manifest order, each checked against its name
+  const QString partPath = destPath + ".part";
+  QFile out(partPath);
+  if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return fail("Can not write " + partPath);
+
+  QCryptographicHash fileHash(QCryptographicHash::Sha256);
+  QString readError;
+  for (const QString &hash : std::as_const(chunks)) {
+    QFile in(chunkPath(hash, codec));
+    bool ok = in.open(QIODevice::ReadOnly);
+    const QByteArray raw = ok ? decompress(in.readAll(), codec, &ok)
+                              : QByteArray();
+    if (!ok || QCryptographicHash::hash(raw, QCryptographicHash::Sha256)
+                       .toHex() != hash.toLatin1()) {
+      readError = "Chunk missing or damaged: " + hash;
+      break;
+    }
+    fileHash.addData(raw);
+    if (out.write(raw) != raw.size()) {
+      readError = "Can not write " + partPath;
+      break;
+    }
+  }
+  out.close();
+
+  // 2. The whole file, then SQLite itself
+  if (readError.isEmpty() && fileHash.result().toHex() != expectedHash)
+    readError = "Snapshot " + id + " does not match its checksum";
+  if (readError.isEmpty())
+    DbBackup::verify(partPath, &readError);
+  if (readError.isEmpty()) {
+    QFile::remove(destPath);
+    if (!QFile::rename(partPath, destPath))
+      readError = "Can not move the snapshot into place: " + destPath;
+  }
+  if (!readError.isEmpty()) {
+    QFile::remove(partPath);
+    return fail(readError);
+  }
+  storedebug << "snapshot" << id << "rebuilt at" << destPath;
+  return true;
+}
+
+int BackupStore::prune(const RetentionPolicy &policy) {
+  QMutexLocker locker(&storeMutex);
+  const QVector<SnapshotInfo> snapshots = listSnapshots(); // newest first
+
+  // 1. Pick the survivors
+  QSet<QString> keep;
+  for (int i = 0; i < snapshots.size() && i < qMax(1, policy.keepLast); ++i)
+    keep.insert(snapshots[i].id);
+
+  const auto keepNewestPer =
+      [&](int buckets, const std::function<QString(const QDateTime &)> &of) {
+        QSet<QString> seen;
+        for (const SnapshotInfo &snap : snapshots) {
+          const QString bucket = of(snap.created);
+          if (seen.contains(bucket))
+            continue;
+          if (seen.size() >= buckets)
+            break;
+          seen.insert(bucket);
+          keep.insert(snap.id);
+        }
+      };
+  keepNewestPer(policy.keepHourly, [](const QDateTime &t) {
+    return t.toString("yyyyMMddHH");
+  });
+  keepNewestPer(policy.keepDaily, [](const QDateTime &t) {
+    return t.toString("yyyyMMdd");
+  });
+  keepNewestPer(policy.keepWeekly, [](const QDateTime &t) {
+    int year = 0;
+    const int week = t.date().weekNumber(&year);
+    return QString("%1-%2").arg(year).arg(week);
+  });
+
+  int removed = 0;
+  for (const SnapshotInfo &snap : snapshots) {
+    if (!keep.contains(snap.id) && QFile::remove(manifestPath(snap.id)))
+      removed++;
+  }
+
+  // 2. Sweep chunks that no remaining manifest refers to. A manifest that
+  // can not be read might still need any chunk: keep them all then.
+  QSet<QString> referenced;
+  const QFileInfoList manifests =
+      QDir(storePath() + "manifests").entryInfoList({"*.json"}, QDir::Files);
+  for (const QFileInfo &fi : manifests) {
+    QStringList chunks;
+    QString codec;
+    if (!readManifest(fi.completeBaseName(), nullptr, &chunks, &codec,
+                      nullptr)) {
+      qWarning() << "[BackupStore] not sweeping, unreadable manifest:"
+                 << fi.fileName();
+      return removed;
+    }
+    for (const QString &hash : std::as_const(chunks))
+      referenced.insert(QFileInfo(chunkPath(hash, codec)).fileName());
+  }
+
+  int sweptChunks = 0;
+  QDirIterator it(storePath() + "chunks", QDir::Files,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    const QFileInfo chunk = it.nextFileInfo();
+    if (!referenced.contains(chunk.fileName()) &&
+        QFile::remove(chunk.absoluteFilePath()))
+      sweptChunks++;
+  }
+
+  if (removed > 0 || sweptChunks > 0)
+    storedebug << "pruned" << removed << "snapshots," << sweptChunks
+               << "chunks";
+  return removed;
+}
+
+int BackupStore::importLegacyBackups() {
+  QMutexLocker locker(&storeMutex);
+  int imported = 0;
+  const QFileInfoList legacy = QDir(SQliteDB::getDbDirPath())
+                                   .entryInfoList({"backup_*.sqlite"},
+                                                  QDir::Files, QDir::Name);
+  for (const QFileInfo &fi : legacy) {
+    // backup_yyyy-MM-dd_HH-mm-ss.sqlite, as SQliteDB used to name them
+    QDateTime created = QDateTime::fromString(
+        fi.completeBaseName().mid(int(qstrlen("backup_"))),
+        "yyyy-MM-dd_HH-mm-ss");
+    if (!created.isValid())
+      created = fi.lastModified();
+
+    SnapshotInfo info;
+    QString error;
+    if (!snapshot(fi.absoluteFilePath(), &info, &error, {}, created)) {
+      qWarning() << "[BackupStore] could not import" << fi.fileName() << ":"
+                 << error;
+      continue;
+    }
+    // The content is in the store now (or identical to the newest)
+    QFile::remove(fi.absoluteFilePath());
+    imported++;
+  }
+  if (imported > 0)
+    storedebug << "imported" << imported << "old backup files";
+  return imported;
+}
+
+RetentionPolicy BackupStore::loadPolicy() {
+  RetentionPolicy policy;
+  QSqlQuery query = SQliteDB::instance()->execRead(
+      "SELECT backupKeepLast, backupKeepHourly, backupKeepDaily, "
+      "backupKeepWeekly, autoBackupHours FROM General WHERE id = 1");
+  if (query.next()) {
+    policy.keepLast = query.value(0).toInt();
+    policy.keepHourly = query.value(1).toInt();
+    policy.keepDaily = query.value(2).toInt();
+    policy.keepWeekly = query.value(3).toInt();
+    policy.autoBackupHours = query.value(4).toInt();
+  }
+  query.finish();
+  return policy;
+}
+
+bool BackupStore::start() {
+  if (isRunning())
+    return false;
+
+  const QString srcPath = SQliteDB::getDbPath();
+  const RetentionPolicy policy = loadPolicy();
+  watcher.setFuture(QtConcurrent::run([this, srcPath, policy]() {
+    // Full-copy backups of older versions join the store once
+    static std::atomic_bool legacyChecked{false};
+    if (!legacyChecked.exchange(true))
+      importLegacyBackups();
+
+    JobResult result;
+    result.ok = snapshot(
+        srcPath, &result.info, &result.error, [this](int copied, int total) {
+          QMetaObject::invokeMethod(
+              this, [this, copied, total]() { emit progress(copied, total); },
+              Qt::QueuedConnection);
+        });
+    if (result.ok)
+      prune(policy);
+    return result;
+  }));
+  return true;
+}
+
+bool BackupStore::isRunning() const { return watcher.isRunning(); }
+
+void BackupStore::setAutoBackupInterval(int hours) {
+  autoBackupHours = qMax(0, hours);
+  if (autoBackupHours == 0) {
+    autoTimer.stop();
+    return;
+  }
+  autoTimer.start(std::chrono::hours(autoBackupHours));
+
+  // Short sessions never reach the timer: catch up on an overdue snapshot
+  const QVector<SnapshotInfo> snapshots = listSnapshots();
+  if (snapshots.isEmpty() ||
+      snapshots.first().created.addSecs(qint64(autoBackupHours) * 3600) <
+          QDateTime::currentDateTime())
+    QTimer::singleShot(kStartupDelayMs, this, [this]() { start(); });
+}
+
+void BackupStore::onJobDone() {
+  const JobResult result = watcher.result();
+  if (!result.ok)
+    qWarning() << "[BackupStore] snapshot failed:" << result.error;
+  emit finished(result.ok, result.info, result.error);
+}
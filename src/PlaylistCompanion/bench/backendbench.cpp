@@ -0,0 +1,372 @@
+#include "backendbench.h"
+#include "fakempv.h"
+#include "librarygenerator.h"
+#include "include/backupstore.h"
+#include "include/db_sqlite.h"
+#include "include/dbwriter.h"
+#include "include/playercontroller.h"
+#include "include/playlistrescanner.h"
+#include "include/videoscanner.h"
+#include "include/videosearch.h"
+#include "include/videotablemodel.h"
+
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QSet>
+#include <QSignalSpy>
+#include <QTimer>
+#include <QtTest>
+#include <algorithm>
+
+BackendBench::BackendBench(const QVector<int> &dbSizes,
+                           const QVector<int> &treeSizes, QObject *parent)
+    : QObject(parent), dbSizes(dbSizes), treeSizes(treeSizes) {}
+
+QString BackendBench::treeRoot(int videos) const {
+  return work.filePath("tree-" + LibraryGenerator::sizeTag(videos));
+}
+
+void BackendBench::addSizeRows(const QVector<int> &sizes) {
+  QTest::addColumn<int>("videos");
+  for (int size : sizes)
+    QTest::newRow(qPrintable(LibraryGenerator::sizeTag(size))) << size;
+}
+
+void BackendBench::initTestCase() {
+  QVERIFY(work.isValid());
+  QVERIFY(SQliteDB::instance()->isOpen());
+
+  // 1. One playlist per size, plus the small ones a real library has
+  for (int size : std::as_const(dbSizes)) {
+    const int playlistId = LibraryGenerator::createPlaylist(
+        "/bench/" + LibraryGenerator::sizeTag(size), size);
+    QVERIFY(playlistId > 0);
+    playlistOfSize.insert(size, playlistId);
+  }
+  for (int i = 0; i < kSmallPlaylists; ++i)
+    QVERIFY(LibraryGenerator::createPlaylist(
+                QString("/bench/small/%1").arg(i), 0) > 0);
+
+  // 2. Trees on disk
+  for (int size : std::as_const(treeSizes))
+    QVERIFY(LibraryGenerator::createTree(treeRoot(size), size));
+}
+
+void BackendBench::cleanupTestCase() { DbWriter::instance()->flush(); }
+
+void BackendBench::queryPlans() {
+  // Release builds skip the check in openDB(); here it always runs
+  QVERIFY(SQliteDB::instance()->checkQueryPlans());
+}
+
+void BackendBench::scanTree_data() { addSizeRows(treeSizes); }
+
+void BackendBench::scanTree() {
+  QFETCH(int, videos);
+  int found = -1;
+  QBENCHMARK {
+    VideoScanner scanner;
+    QEventLoop loop;
+    connect(&scanner, &VideoScanner::finished, &loop,
+            [&](const VideoCollection &vdos) {
+              found = vdos.count;
+              loop.quit();
+            });
+    scanner.start(treeRoot(videos));
+    loop.exec();
+  }
+  QCOMPARE(found, videos);
+}
+
+void BackendBench::planColdRescan_data() { addSizeRows(treeSizes); }
+
+void BackendBench::planColdRescan() {
+  QFETCH(int, videos);
+  RescanPlan plan;
+  QBENCHMARK { plan = PlaylistRescanner::plan(treeRoot(videos), {}, {}, {}); }
+  QCOMPARE(plan.addedFiles.size(), qsizetype(videos));
+}
+
+void BackendBench::planWarmRescan_data() { addSizeRows(treeSizes); }
+
+void BackendBench::planWarmRescan() {
+  QFETCH(int, videos);
+  const QString root = treeRoot(videos);
+
+  // What the database would hold after the import
+  const RescanPlan cold = PlaylistRescanner::plan(root, {}, {}, {});
+  QHash<QString, DirFingerprint> cache;
+  for (const DirFingerprint &fp : cold.changedDirs)
+    cache.insert(fp.dirPath, fp);
+  const QSet<QString> known(cold.addedFiles.cbegin(), cold.addedFiles.cend());
+
+  RescanPlan plan;
+  QBENCHMARK { plan = PlaylistRescanner::plan(root, {}, cache, known); }
+  QCOMPARE(plan.listedDirs, 0); // one stat() per folder, no listing
+  QVERIFY(plan.addedFiles.isEmpty() && plan.removedFiles.isEmpty());
+}
+
+void BackendBench::pathMemory_data() { addSizeRows(dbSizes); }
+
+void BackendBench::pathMemory() {
+  QFETCH(int, videos);
+  const VideoCollection vdos = LibraryGenerator::paths("/bench/paths", videos);
+  QCOMPARE(vdos.fileList.size(), videos);
+
+  // Same list as one QString per video: array slot, header, UTF-16 data
+  qint64 flatBytes = 0;
+  for (int i = 0; i < vdos.fileList.size(); ++i)
+    flatBytes += sizeof(QString) + 16 + 2 * (vdos.fileList.path(i).size() + 1);
+  const qreal perVideo = qreal(vdos.fileList.memoryBytes()) / videos;
+
+  // What the table model holds per row once the playlist is paged in:
+  // its columns plus its own PathStore, what the GUI actually keeps
+  VideoTableModel model;
+  model.setPlaylist(playlistOfSize.value(videos));
+  while (model.canFetchMore(QModelIndex()))
+    model.fetchMore(QModelIndex());
+  QCOMPARE(model.rowCount(), videos);
+  const qreal perRow = qreal(model.memoryBytes()) / videos;
+
+  qInfo().nospace() << "PathStore " << perVideo << " bytes/video, model "
+                    << perRow << " bytes/row, QString "
+                    << qreal(flatBytes) / videos;
+  QTest::setBenchmarkResult(perRow, QTest::BytesAllocated);
+}
+
+void BackendBench::insertVideos_data() { addSizeRows(dbSizes); }
+
+void BackendBench::insertVideos() {
+  QFETCH(int, videos);
+  QVector<int> created;
+  QBENCHMARK {
+    created.append(LibraryGenerator::createPlaylist(
+        QString("/bench/insert/%1").arg(created.size()), videos));
+  }
+  // The fixtures of the read benchmarks stay the only big playlists
+  for (int playlistId : std::as_const(created)) {
+    QVERIFY(playlistId > 0);
+    QVERIFY(LibraryGenerator::removePlaylist(playlistId));
+  }
+}
+
+void BackendBench::playlistList() {
+  SQliteDB *db = SQliteDB::instance();
+  int count = 0;
+  QBENCHMARK {
+    // Same query and columns as MainWindow::updatePlaylistListCombo()
+    QSqlQuery query =
+        db->execPrepared("SELECT * FROM Playlist ORDER BY playlistId ASC");
+    count = 0;
+    while (query.next()) {
+      Playlist pl{};
+      pl.playlistId = query.value("playlistId").toInt();
+      pl.playlistTitle = query.value("playlistTitle").toString();
+      pl.playlistPath = query.value("playlistPath").toString();
+      pl.status = query.value("status").toString();
+      pl.totalVideoCount = query.value("totalVideoCount").toInt();
+      pl.watchedCount = query.value("watchedCount").toInt();
+      pl.totalTimeHour = query.value("totalTimeHour").toInt();
+      pl.totalDurationMs = query.value("totalDurationMs").toLongLong();
+      pl.creationDateTime = query.value("creationDateTime").toString();
+      pl.lastWatchedDateTime = query.value("lastWatchedDateTime").toString();
+      ++count;
+    }
+  }
+  QCOMPARE(count, int(dbSizes.size()) + kSmallPlaylists);
+}
+
+void BackendBench::firstPage_data() { addSizeRows(dbSizes); }
+
+void BackendBench::firstPage() {
+  QFETCH(int, videos);
+  VideoTableModel model;
+  QBENCHMARK {
+    model.setPlaylist(playlistOfSize.value(videos));
+    model.fetchMore(QModelIndex());
+  }
+  QCOMPARE(model.rowCount(), qMin(videos, VideoTableModel::kPageSize));
+}
+
+void BackendBench::pageThrough_data() { addSizeRows(dbSizes); }
+
+void BackendBench::pageThrough() {
+  QFETCH(int, videos);
+  VideoTableModel model;
+  QBENCHMARK {
+    model.setPlaylist(playlistOfSize.value(videos));
+    while (model.canFetchMore(QModelIndex()))
+      model.fetchMore(QModelIndex());
+  }
+  QCOMPARE(model.rowCount(), videos);
+}
+
+void BackendBench::search_data() {
+  QTest::addColumn<QString>("typed");
+  QTest::newRow("prefix") << "lect";
+  QTest::newRow("two words") << "linear alg";
+  QTest::newRow("number") << "lecture 12";
+  QTest::newRow("camel case") << "qtwid";
+  QTest::newRow("no match") << "zzzz";
+}
+
+void BackendBench::search() {
+  QFETCH(QString, typed);
+  QBENCHMARK { VideoSearch::search(typed); }
+}
+
+void BackendBench::searchCommonTerm() {
+  // Every generated file is a "Lecture N - ...": all rows of every sized
+  // playlist match and get a bm25 score. Run with --sizes ...,1000000 for
+  // the case the 10 ms target is about.
+  QVector<SearchHit> hits;
+  QBENCHMARK { hits = VideoSearch::search("lecture "); }
+  QCOMPARE(hits.size(), qsizetype(VideoSearch::kMaxHits));
+  QVERIFY(std::is_sorted(hits.cbegin(), hits.cend(),
+                         [](const SearchHit &a, const SearchHit &b) {
+                           return a.score < b.score;
+                         }));
+}
+
+void BackendBench::playerIpc() {
+  // 1. A video to play and the bench binary as the player
+  const int playlistId = LibraryGenerator::createPlaylist("/bench/player", 1);
+  QVERIFY(playlistId > 0);
+  Video vdo{};
+  {
+    QSqlQuery query = SQliteDB::instance()->execPrepared(
+        "SELECT videoID, videoPath FROM Video WHERE playlistID = ?",
+        {playlistId});
+    QVERIFY(query.next());
+    vdo.videoID = query.value(0).toInt();
+    vdo.playlistID = playlistId;
+    vdo.videoPath = query.value(1).toString();
+  }
+#ifdef Q_OS_WIN
+  const QString fakeMpv = work.filePath("mpv.exe");
+#else
+  const QString fakeMpv = work.filePath("mpv");
+#endif
+  QFile::remove(fakeMpv);
+  QVERIFY(QFile::copy(QCoreApplication::applicationFilePath(), fakeMpv));
+  QCOMPARE(PlayerController::kindOf(fakeMpv), PlayerController::Kind::Mpv);
+
+  const auto resumeTime = [&vdo]() {
+    QSqlQuery query = SQliteDB::instance()->execPrepared(
+        "SELECT resumeTime FROM Video WHERE videoID = ?", {vdo.videoID});
+    return query.next() ? query.value(0).toInt() : -1;
+  };
+
+  // 2. Every change the database sees while the player is connected
+  PlayerController player;
+  QSignalSpy watched(&player, &PlayerController::watchedReached);
+  QSignalSpy ended(&player, &PlayerController::sessionEnded);
+  QSignalSpy recorded(&player, &PlayerController::sessionRecorded);
+  int lastPosition = -1, positionAtWatched = -1, positionUpdates = 0;
+  connect(&player, &PlayerController::positionChanged, this,
+          [&](int, int seconds) {
+            lastPosition = seconds;
+            ++positionUpdates;
+          });
+  connect(&player, &PlayerController::watchedReached, this,
+          [&]() { positionAtWatched = lastPosition; });
+
+  QElapsedTimer clock;
+  QVector<qint64> writeTimes;
+  QVector<int> writeValues;
+  int stored = resumeTime();
+  QTimer poll;
+  poll.setInterval(50);
+  connect(&poll, &QTimer::timeout, this, [&]() {
+    const int now = resumeTime();
+    if (now != stored && player.isTracking()) {
+      writeTimes.append(clock.elapsed());
+      writeValues.append(now);
+    }
+    stored = now;
+  });
+
+  clock.start();
+  poll.start();
+  QVERIFY(player.play(fakeMpv, vdo, -1)); // duration from the player
+  QVERIFY(ended.wait(FakeMpv::kDurationSeconds * FakeMpv::kTickMs +
+                     FakeMpv::kWaitForClientMs));
+  poll.stop();
+  DbWriter::instance()->flush();
+
+  // 3. Positions written while playing, coalesced to one per interval
+  QVERIFY(positionUpdates > FakeMpv::kDurationSeconds / 2);
+  QVERIFY(!writeValues.isEmpty());
+  QVERIFY(writeValues.first() > 0);
+  for (int i = 1; i < writeTimes.size(); ++i)
+    QVERIFY2(writeTimes[i] - writeTimes[i - 1] >=
+                 PlayerController::kFlushIntervalMs - 250,
+             qPrintable(QString("writes %1 ms apart")
+                            .arg(writeTimes[i] - writeTimes[i - 1])));
+
+  // 4. Watched once, at 90 %; the next play starts over
+  QCOMPARE(watched.size(), 1);
+  QCOMPARE(watched.first().value(0).toInt(), playlistId);
+  QCOMPARE(watched.first().value(1).toInt(), vdo.videoID);
+  QCOMPARE(positionAtWatched, FakeMpv::kDurationSeconds *
+                                  PlayerController::kWatchedPercent / 100);
+  QCOMPARE(resumeTime(), 0);
+  QTRY_COMPARE(recorded.size(), 1); // the time played, in the history
+
+  QVERIFY(LibraryGenerator::removePlaylist(playlistId));
+}
+
+void BackendBench::snapshotFull() {
+  SnapshotInfo info;
+  QString error;
+  bool ok = false;
+  QBENCHMARK_ONCE {
+    ok = BackupStore::snapshot(SQliteDB::getDbPath(), &info, &error);
+  }
+  QVERIFY2(ok, qPrintable(error));
+  lastSnapshotId = info.id;
+}
+
+void BackendBench::snapshotIncremental() {
+  // A few hundred changed rows: only their pages become new chunks
+  const int playlistId = playlistOfSize.value(dbSizes.value(0), -1);
+  QVERIFY(playlistId > 0);
+  DbWriter::instance()
+      ->enqueue("UPDATE Video SET resumeTime = 42 WHERE videoID IN "
+                "(SELECT videoID FROM Video WHERE playlistID = ? LIMIT 300)",
+                {playlistId})
+      .waitForFinished();
+
+  SnapshotInfo info;
+  QString error;
+  bool ok = false;
+  QBENCHMARK_ONCE {
+    ok = BackupStore::snapshot(SQliteDB::getDbPath(), &info, &error);
+  }
+  QVERIFY2(ok, qPrintable(error));
+  QVERIFY(info.unchanged || info.newChunks < info.chunkCount);
+  lastSnapshotId = info.id;
+}
+
+void BackendBench::rebuildSnapshot() {
+  QVERIFY(!lastSnapshotId.isEmpty());
+  QString error;
+  bool ok = false;
+  QBENCHMARK_ONCE {
+    ok = BackupStore::rebuild(lastSnapshotId, work.filePath("rebuilt.sqlite"),
+                              &error);
+  }
+  QVERIFY2(ok, qPrintable(error));
+}
+
+void BackendBench::restoreSnapshot() {
+  // Rebuild, safety snapshot of the live file, swap, reopen and migrate
+  QVERIFY(!lastSnapshotId.isEmpty());
+  QString error;
+  bool ok = false;
+  QBENCHMARK_ONCE {
+    ok = SQliteDB::instance()->restoreSnapshot(lastSnapshotId, &error);
+  }
+  QVERIFY2(ok, qPrintable(error));
+}
@@ -0,0 +1,84 @@
+#ifndef BACKENDBENCH_H
+#define BACKENDBENCH_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTemporaryDir>
+#include <QVector>
+
+// Qt Test benchmarks of the backend, on libraries made by LibraryGenerator.
+// Every data-driven one runs once per size ("1k", "100k", ...):
+//  - dbSizes: playlists in the app database (writes, model, search)
+//  - treeSizes: folder trees on disk (scans, rescans)
+// Slots run in declaration order; the backup ones end with a hot restore
+// of the live database, so they come last.
+class BackendBench : public QObject {
+  Q_OBJECT
+
+public:
+  BackendBench(const QVector<int> &dbSizes, const QVector<int> &treeSizes,
+               QObject *parent = nullptr);
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  // Every hot query answered through an index (not timed)
+  void queryPlans();
+
+  // Folder walks: a new playlist (VideoScanner, what getAllVideosFromDir
+  // used to do) and rescans with nothing / everything cached
+  void scanTree_data();
+  void scanTree();
+  void planColdRescan_data();
+  void planColdRescan();
+  void planWarmRescan_data();
+  void planWarmRescan();
+
+  // Heap bytes per video of a scanned list (PathStore) and per loaded row
+  // of VideoTableModel (reported), not a time
+  void pathMemory_data();
+  void pathMemory();
+
+  // The video-insert path: Playlist row + chunked multi-row INSERTs
+  void insertVideos_data();
+  void insertVideos();
+
+  // Reads of the main window: updatePlaylistListCombo, populateVideoTable
+  // (reset + first page), scrolling to the end, search while typing
+  void playlistList();
+  void firstPage_data();
+  void firstPage();
+  void pageThrough_data();
+  void pageThrough();
+  void search_data();
+  void search();
+  // A whole word in every row: all matches ranked, the worst case
+  void searchCommonTerm();
+
+  // "Play this video" against a fake mpv on the JSON IPC socket: resume
+  // positions written at most once per flush interval, watched at 90%
+  // (not timed, about 10 s)
+  void playerIpc();
+
+  // Backup store: first and incremental snapshot, rebuild, hot restore
+  void snapshotFull();
+  void snapshotIncremental();
+  void rebuildSnapshot();
+  void restoreSnapshot();
+
+private:
+  static constexpr int kSmallPlaylists = 300; // besides the sized ones
+
+  QVector<int> dbSizes;
+  QVector<int> treeSizes;
+  QTemporaryDir work; // trees and rebuilt files
+  QHash<int, int> playlistOfSize;
+  QString lastSnapshotId;
+
+  QString treeRoot(int videos) const;
+  static void addSizeRows(const QVector<int> &sizes);
+};
+
+#endif // BACKENDBENCH_H
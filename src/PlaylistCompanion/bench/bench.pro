@@ -0,0 +1,38 @@
+# Backend benchmarks (Qt Test QBENCHMARK) on synthetic libraries.
+#
+#   qmake bench.pro && make
+#   PLC_BENCH_COMMIT=$(git rev-parse --short HEAD) \
+#       ./plc-bench --json plc-bench.json --sizes 1000,100000,1000000
+#
+#   --json <file>           report written there (default plc-bench.json)
+#   --sizes <n,...>         videos per database playlist (default 1000,100000)
+#   --tree-sizes <n,...>    videos per folder tree (default 1000,10000)
+#
+# playerIpc copies plc-bench to "mpv" in a temporary folder and plays through
+# it: started under that name the binary is a fake mpv (fakempv.h).
+#
+# Anything else is passed to Qt Test: function names, -iterations, -callgrind,
+# -tickcounter, ... The database lives in dbPlaylistCompanion/ next to the
+# binary and is recreated on every run; the app's own is never touched.
+
+QT       += core gui sql concurrent network testlib
+
+CONFIG += c++23 console
+CONFIG -= app_bundle
+
+TARGET = plc-bench
+
+include(../backend.pri)
+
+SOURCES += \
+    backendbench.cpp \
+    benchreport.cpp \
+    fakempv.cpp \
+    librarygenerator.cpp \
+    main.cpp
+
+HEADERS += \
+    backendbench.h \
+    benchreport.h \
+    fakempv.h \
+    librarygenerator.h
@@ -0,0 +1,62 @@
+#include "benchreport.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+
+bool BenchReport::write(const QString &xmlPath, const QString &jsonPath,
+                        const QJsonObject &context) {
+  QFile xml(xmlPath);
+  if (!xml.open(QIODevice::ReadOnly)) {
+    qWarning() << "[Bench] cannot read" << xmlPath << xml.errorString();
+    return false;
+  }
+
+  // 1. <TestFunction name="..."> holds <BenchmarkResult .../> per data tag
+  //    and <Incident type="fail" ...> for failed checks
+  QJsonArray results;
+  int failures = 0;
+  QString function;
+  QXmlStreamReader reader(&xml);
+  while (!reader.atEnd()) {
+    if (reader.readNext() != QXmlStreamReader::StartElement)
+      continue;
+    const QXmlStreamAttributes attrs = reader.attributes();
+    if (reader.name() == u"TestFunction") {
+      function = attrs.value("name").toString();
+    } else if (reader.name() == u"BenchmarkResult") {
+      results.append(QJsonObject{
+          {"function", function},
+          {"tag", attrs.value("tag").toString()},
+          {"metric", attrs.value("metric").toString()},
+          {"value", attrs.value("value").toDouble()},
+          {"iterations", attrs.value("iterations").toInt()}});
+    } else if (reader.name() == u"Incident") {
+      const QStringView type = attrs.value("type");
+      if (type == u"fail" || type == u"xpass")
+        ++failures;
+    }
+  }
+  if (reader.hasError()) {
+    qWarning() << "[Bench] bad XML log" << xmlPath << reader.errorString();
+    return false;
+  }
+
+  // 2. Context first, then the numbers
+  QJsonObject report = context;
+  report.insert("failures", failures);
+  report.insert("results", results);
+
+  QSaveFile out(jsonPath);
+  if (!out.open(QIODevice::WriteOnly) ||
+      out.write(QJsonDocument(report).toJson()) < 0 || !out.commit()) {
+    qWarning() << "[Bench] cannot write" << jsonPath << out.errorString();
+    return false;
+  }
+  benchdebug << results.size() << "results," << failures << "failures in"
+             << jsonPath;
+  return true;
+}
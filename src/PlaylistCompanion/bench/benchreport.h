@@ -0,0 +1,27 @@
+#ifndef BENCHREPORT_H
+#define BENCHREPORT_H
+
+#include <QJsonObject>
+#include <QString>
+
+#define benchdebug qDebug() << "[Bench] "
+
+// Qt Test has no JSON logger, so the run is logged as XML and turned into
+// one JSON document that CI can keep and diff between commits:
+//
+//   { <context>, "failures": 0,
+//     "results": [ { "function": "firstPage", "tag": "100k",
+//                    "metric": "WalltimeMilliseconds", "value": 0.41,
+//                    "iterations": 64 }, ... ] }
+//
+// "value" is per iteration, as Qt Test reports it.
+class BenchReport {
+
+public:
+  // context: suite, commit, sizes, ... copied to the top level.
+  // false (and a qWarning) if the XML can't be read or the JSON written.
+  static bool write(const QString &xmlPath, const QString &jsonPath,
+                    const QJsonObject &context);
+};
+
+#endif // BENCHREPORT_H
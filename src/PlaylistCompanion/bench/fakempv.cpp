@@ -0,0 +1,95 @@
+#include "fakempv.h"
+#include "benchreport.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+namespace {
+
+void send(QLocalSocket *client, const QJsonObject &message) {
+  client->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void propertyChange(QLocalSocket *client, int id, const QString &name,
+                    const QJsonValue &data) {
+  send(client, {{"event", "property-change"},
+                {"id", id},
+                {"name", name},
+                {"data", data}});
+}
+
+} // namespace
+
+bool FakeMpv::isInvokedAs(const QString &program) {
+  return QFileInfo(program).completeBaseName() == "mpv";
+}
+
+int FakeMpv::run(const QStringList &args) {
+  // 1. The same options PlayerController::arguments() passes to mpv
+  QString serverName;
+  int position = 0;
+  for (const QString &arg : args) {
+    if (arg.startsWith("--input-ipc-server="))
+      serverName = arg.section('=', 1);
+    else if (arg.startsWith("--start="))
+      position = arg.section('=', 1).toInt();
+  }
+  if (serverName.isEmpty()) {
+    qCritical() << "[FakeMpv] no --input-ipc-server";
+    return 2;
+  }
+
+  QLocalServer server;
+  QLocalServer::removeServer(serverName);
+  if (!server.listen(serverName)) {
+    qCritical() << "[FakeMpv] cannot listen on" << serverName << ":"
+                << server.errorString();
+    return 2;
+  }
+
+  // 2. Gone on its own when the test died before connecting
+  bool served = false;
+  QTimer::singleShot(kWaitForClientMs, &server, [&served]() {
+    if (!served)
+      QCoreApplication::exit(1);
+  });
+
+  // 3. One client: command replies, then playback until the end
+  QTimer tick;
+  tick.setInterval(kTickMs);
+  QObject::connect(&server, &QLocalServer::newConnection, &server, [&]() {
+    QLocalSocket *client = server.nextPendingConnection();
+    if (!client || served)
+      return;
+    served = true;
+
+    QObject::connect(client, &QLocalSocket::readyRead, client, [client]() {
+      while (client->canReadLine()) {
+        client->readLine();
+        send(client, {{"error", "success"}});
+      }
+    });
+    QObject::connect(client, &QLocalSocket::disconnected, client,
+                     []() { QCoreApplication::exit(0); });
+    QObject::connect(&tick, &QTimer::timeout, client, [client, &position]() {
+      if (position > kDurationSeconds) {
+        client->disconnectFromServer();
+        return;
+      }
+      propertyChange(client, 1, "time-pos", position++);
+    });
+
+    // mpv reports null while the file loads
+    propertyChange(client, 1, "time-pos", QJsonValue::Null);
+    propertyChange(client, 2, "duration", kDurationSeconds);
+    tick.start();
+  });
+
+  benchdebug << "fake mpv on" << serverName << "from" << position << "s";
+  return QCoreApplication::exec();
+}
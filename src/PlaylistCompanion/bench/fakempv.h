@@ -0,0 +1,26 @@
+#ifndef FAKEMPV_H
+#define FAKEMPV_H
+
+#include <QStringList>
+
+// Stands in for mpv in the IPC test: plc-bench started under the name "mpv"
+// serves --input-ipc-server like the real player. Once a client connects it
+// answers every command with success, reports the duration, then time-pos
+// from --start (0 without) one second of video per kTickMs, and closes
+// the socket at the end of the video, as mpv does when its window closes.
+class FakeMpv {
+
+public:
+  static constexpr int kDurationSeconds = 200;
+  static constexpr int kTickMs = 50; // the whole video in 10 s
+  static constexpr int kWaitForClientMs = 15000;
+
+  // Named like the player, so PlayerController speaks its protocol
+  static bool isInvokedAs(const QString &program);
+
+  // args: the player's command line without the program. Runs its own
+  // event loop; the exit code.
+  static int run(const QStringList &args);
+};
+
+#endif // FAKEMPV_H
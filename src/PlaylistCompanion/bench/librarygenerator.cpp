@@ -0,0 +1,117 @@
+#include "librarygenerator.h"
+#include "include/dbwriter.h"
+#include "include/videoingest.h"
+
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+namespace {
+
+const QStringList &topics() {
+  static const QStringList names = {
+      "Linear Algebra",  "Backpropagation", "QtWidgets Basics",
+      "SQLite Indexes",  "Eigenvalues",     "HTTPServer Design",
+      "Deep Learning",   "Graph Search",    "Memory Models",
+      "Signal Processing", "Compilers",     "Operating Systems",
+      "Introduction",    "Recap and Q&A",   "Hash Tables",
+      "Dynamic Programming", "Concurrency", "Type Theory"};
+  return names;
+}
+
+const QStringList &extensions() {
+  // Mostly mp4, like real course downloads
+  static const QStringList names = {"mp4", "mp4", "mp4", "mkv", "webm"};
+  return names;
+}
+
+} // namespace
+
+VideoCollection LibraryGenerator::paths(const QString &root, int count) {
+  VideoCollection vdos;
+  vdos.fileList = PathStore(root);
+  vdos.fileList.reserve(count);
+  const int perCourse = kVideosPerSection * kSectionsPerCourse;
+  for (int i = 0; i < count; ++i) {
+    const int course = i / perCourse;
+    const int section = (i / kVideosPerSection) % kSectionsPerCourse;
+    const int lecture = i % kVideosPerSection;
+    const QString courseDir =
+        QString("Course %1 - %2")
+            .arg(course + 1, 4, 10, QChar('0'))
+            .arg(topics()[course % topics().size()]);
+    vdos.fileList.add(
+        QString("%1/%2/Section %3/Lecture %4 - %5.%6")
+            .arg(root, courseDir)
+            .arg(section + 1, 2, 10, QChar('0'))
+            .arg(lecture + 1) // unpadded: natural sort has work to do
+            .arg(topics()[(course * 7 + lecture) % topics().size()])
+            .arg(extensions()[i % extensions().size()]));
+  }
+  vdos.count = int(vdos.fileList.size());
+  return vdos;
+}
+
+bool LibraryGenerator::createTree(const QString &root, int count) {
+  const VideoCollection vdos = paths(root, count);
+  QString lastDir;
+  for (int i = 0; i < vdos.fileList.size(); ++i) {
+    const QString path = vdos.fileList.path(i);
+    const QString dir = path.left(path.lastIndexOf('/'));
+    if (dir != lastDir) {
+      if (!QDir().mkpath(dir))
+        return false;
+      lastDir = dir;
+    }
+    QFile file(path);
+    if (!file.exists() && !file.open(QIODevice::WriteOnly))
+      return false;
+  }
+  return true;
+}
+
+int LibraryGenerator::createPlaylist(const QString &root, int count) {
+  Playlist pl{};
+  pl.playlistTitle = "Bench " + sizeTag(count);
+  pl.playlistPath = root;
+  pl.status = "Planned to Watch";
+  const VideoCollection vdos = paths(root, count);
+  return DbWriter::instance()
+      ->run([pl, vdos]() { return VideoIngest::createPlaylist(pl, vdos); })
+      .result();
+}
+
+bool LibraryGenerator::removePlaylist(int playlistId) {
+  // Foreign keys are off on the app's connections, so no cascade
+  return DbWriter::instance()
+      ->run([playlistId]() {
+        DbWriter *writer = DbWriter::instance();
+        QSqlDatabase &db = writer->database();
+        if (!db.transaction())
+          return false;
+        const bool ok =
+            writer->execPrepared("DELETE FROM Video WHERE playlistID = ?",
+                                 {playlistId})
+                .isActive() &&
+            writer->execPrepared(
+                      "DELETE FROM DirFingerprint WHERE playlistID = ?",
+                      {playlistId})
+                .isActive() &&
+            writer->execPrepared("DELETE FROM Playlist WHERE playlistId = ?",
+                                 {playlistId})
+                .isActive();
+        if (ok && db.commit())
+          return true;
+        db.rollback();
+        return false;
+      })
+      .result();
+}
+
+QString LibraryGenerator::sizeTag(int count) {
+  if (count >= 1000000 && count % 1000000 == 0)
+    return QString("%1M").arg(count / 1000000);
+  if (count >= 1000 && count % 1000 == 0)
+    return QString("%1k").arg(count / 1000);
+  return QString::number(count);
+}
@@ -0,0 +1,36 @@
+#ifndef LIBRARYGENERATOR_H
+#define LIBRARYGENERATOR_H
+
+#include <QString>
+#include <include/structures.h>
+
+// Synthetic course libraries for the benchmarks, shaped like real ones:
+//
+//   <root>/Course 0007 - Linear Algebra/Section 03/Lecture 12 - Eigenvalues.mp4
+//
+// so natural sort keys, the search splitting (words, numbers, CamelCase)
+// and per-folder fingerprints all see realistic names. The same size always
+// gives the same names.
+class LibraryGenerator {
+
+public:
+  static constexpr int kVideosPerSection = 20;
+  static constexpr int kSectionsPerCourse = 10;
+
+  // Paths of `count` videos under root; nothing on disk
+  static VideoCollection paths(const QString &root, int count);
+
+  // The same tree on disk, as empty files. false if one could not be made.
+  static bool createTree(const QString &root, int count);
+
+  // A playlist of `count` videos (paths() under root) in the app database,
+  // written through VideoIngest on the DbWriter. Its id, -1 on failure.
+  static int createPlaylist(const QString &root, int count);
+  // Its videos, folder fingerprints and the row itself
+  static bool removePlaylist(int playlistId);
+
+  // "1k", "100k", "1M": data tags of the benchmarks
+  static QString sizeTag(int count);
+};
+
+#endif // LIBRARYGENERATOR_H
@@ -0,0 +1,139 @@
+#include "backendbench.h"
+#include "benchreport.h"
+#include "fakempv.h"
+#include "librarygenerator.h"
+#include "include/backupstore.h"
+#include "include/db_sqlite.h"
+#include "include/dbwriter.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+
+// Written next to a database this program created; anything else in the
+// database folder is someone's real library and is left alone
+const char *const kMarker = ".plc-bench";
+
+QVector<int> parseSizes(const QString &list, bool *ok) {
+  QVector<int> sizes;
+  *ok = true;
+  for (const QString &part : list.split(',', Qt::SkipEmptyParts)) {
+    const int size = part.trimmed().toInt(ok);
+    if (!*ok || size < 0)
+      return {};
+    sizes.append(size);
+  }
+  *ok = !sizes.isEmpty();
+  return sizes;
+}
+
+QJsonArray toJson(const QVector<int> &sizes) {
+  QJsonArray array;
+  for (int size : sizes)
+    array.append(size);
+  return array;
+}
+
+// 1. A fresh database folder next to the binary, where SQliteDB looks
+bool prepareDbDir() {
+  QDir dir(QCoreApplication::applicationDirPath() + "/dbPlaylistCompanion");
+  if (dir.exists()) {
+    if (!dir.exists(kMarker)) {
+      qCritical() << "[Bench] refusing to touch" << dir.absolutePath()
+                  << "- it was not made by plc-bench";
+      return false;
+    }
+    if (!dir.removeRecursively()) {
+      qCritical() << "[Bench] cannot clear" << dir.absolutePath();
+      return false;
+    }
+  }
+  QFile marker(dir.filePath(kMarker));
+  return QDir().mkpath(dir.absolutePath()) &&
+         marker.open(QIODevice::WriteOnly);
+}
+
+} // namespace
+
+// plc-bench [--json <file>] [--sizes 1000,100000] [--tree-sizes 1000,10000]
+//           [Qt Test options and function names]
+int main(int argc, char *argv[]) {
+  // Copied to "mpv" by BackendBench::playerIpc(): the player end of the test
+  if (argc > 0 && FakeMpv::isInvokedAs(QString::fromLocal8Bit(argv[0]))) {
+    QCoreApplication app(argc, argv);
+    return FakeMpv::run(app.arguments().mid(1));
+  }
+
+  // The table model needs a GUI application, not a display
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QGuiApplication app(argc, argv);
+
+  // 1. Own options; the rest goes to Qt Test
+  QString jsonPath = "plc-bench.json";
+  QVector<int> dbSizes = {1000, 100000};
+  QVector<int> treeSizes = {1000, 10000};
+  QStringList testArgs = {app.arguments().value(0)};
+  const QStringList args = app.arguments().mid(1);
+  for (int i = 0; i < args.size(); ++i) {
+    const QString &arg = args[i];
+    if (arg != "--json" && arg != "--sizes" && arg != "--tree-sizes") {
+      testArgs.append(arg);
+      continue;
+    }
+    if (i + 1 >= args.size()) {
+      qCritical() << "[Bench]" << arg << "needs a value";
+      return 2;
+    }
+    const QString value = args[++i];
+    bool ok = true;
+    if (arg == "--json")
+      jsonPath = value;
+    else if (arg == "--sizes")
+      dbSizes = parseSizes(value, &ok);
+    else
+      treeSizes = parseSizes(value, &ok);
+    if (!ok) {
+      qCritical() << "[Bench] bad size list for" << arg << ":" << value;
+      return 2;
+    }
+  }
+
+  // 2. Database from scratch, so every run measures the same library
+  if (!prepareDbDir())
+    return 2;
+
+  // 3. Run, logging XML for the report and plain text for the console
+  QTemporaryDir logDir;
+  if (!logDir.isValid())
+    return 2;
+  const QString xmlPath = logDir.filePath("bench.xml");
+  testArgs << "-o" << xmlPath + ",xml" << "-o" << "-,txt";
+
+  int failed = 0;
+  {
+    BackendBench bench(dbSizes, treeSizes);
+    failed = QTest::qExec(&bench, testArgs);
+  }
+
+  // 4. JSON with enough context to compare two runs
+  QJsonObject context{
+      {"suite", "plc-bench"},
+      {"created", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+      {"qtVersion", qVersion()},
+      {"schemaVersion", SQliteDB::kSchemaVersion},
+      {"commit", qEnvironmentVariable("PLC_BENCH_COMMIT")},
+      {"sizes", toJson(dbSizes)},
+      {"treeSizes", toJson(treeSizes)}};
+  const bool written = BenchReport::write(xmlPath, jsonPath, context);
+
+  BackupStore::shutdown();
+  DbWriter::shutdown();
+  return failed || !written ? 1 : 0;
+}
@@ -1,49 +1,399 @@
--- Enable foreign key constraints (required for SQLite)
+-- Schema of db_PL.sqlite at version 13 (see db_migrations.cpp, which is what
+-- the app actually runs; keep both in line when adding a migration).
 PRAGMA foreign_keys = ON;
 
--- 1. Table: General
-CREATE TABLE General (
-    OS TEXT CHECK(OS IN ('Windows', 'Linux', 'Mac')),
-    lastUpdated TEXT DEFAULT CURRENT_TIMESTAMP,
-    defaultMediaPlayer TEXT DEFAULT '',
-    hasOpenedBefore INTEGER DEFAULT 0 CHECK(hasOpenedBefore IN (0, 1)) -- 0=notOpened, 1=Opened
-);
-
--- 2. Table: MediaPlayerPath
-CREATE TABLE MediaPlayerPath (
-    mediaPlayerName TEXT,
-    mediaPlayerPath TEXT
+----------------------------------------------------------
+-- 1. Table: MediaPlayerPath (Independent)
+----------------------------------------------------------
+-- Filled by PlayerDiscovery; source is where the executable was found
+CREATE TABLE IF NOT EXISTS MediaPlayerPath (
+    mediaPlayerName TEXT PRIMARY KEY,
+    mediaPlayerPath TEXT NOT NULL,
+    source TEXT NOT NULL DEFAULT 'known'
+        CHECK(source IN ('known', 'path', 'flatpak', 'snap'))
 );
 
--- 3. Table: Playlist
-CREATE TABLE Playlist (
+----------------------------------------------------------
+-- 2. Table: Playlist (Parent Table)
+----------------------------------------------------------
+CREATE TABLE IF NOT EXISTS Playlist (
     playlistId INTEGER PRIMARY KEY AUTOINCREMENT,
     playlistTitle TEXT NOT NULL CHECK(length(playlistTitle) > 0),
     playlistPath TEXT NOT NULL CHECK(length(playlistPath) > 0),
-    status TEXT DEFAULT 'Planned to Watch' CHECK(status IN ('Planned to Watch', 'Watching', 'Completed')),
-    totalVideoCount INTEGER,
-    watchedCount INTEGER,
-    totalTimeHour INTEGER,
+
+    status TEXT DEFAULT 'Planned to Watch'
+        CHECK(status IN ('Planned to Watch', 'Watching', 'Completed')),
+
+    totalVideoCount INTEGER DEFAULT 0 CHECK(totalVideoCount >= 0),
+    watchedCount INTEGER DEFAULT 0
+        CHECK(watchedCount >= 0 AND watchedCount <= totalVideoCount),
+
+    totalTimeHour INTEGER DEFAULT 0 CHECK(totalTimeHour >= 0),
+
     creationDateTime TEXT DEFAULT CURRENT_TIMESTAMP,
     updatingDateTime TEXT,
-    lastWatchedDateTime TEXT
+    lastWatchedDateTime TEXT,
+    totalDurationMs INTEGER NOT NULL DEFAULT 0,   -- sum of Video.durationMs > 0
+
+    watchFolder INTEGER NOT NULL DEFAULT 0 CHECK(watchFolder IN (0, 1)) -- 1 = live sync
 );
 
--- 4. Table: Video
-CREATE TABLE Video (
+----------------------------------------------------------
+-- 3. Table: Video (Depends on Playlist)
+----------------------------------------------------------
+CREATE TABLE IF NOT EXISTS Video (
     videoID INTEGER PRIMARY KEY AUTOINCREMENT,
-    playlistID INTEGER,
-    videoPath TEXT NOT NULL,
-    isWatched INTEGER DEFAULT 0 CHECK(isWatched IN (0, 1)), -- 0=False, 1=True
-    FOREIGN KEY (playlistID) REFERENCES Playlist(playlistId) ON DELETE CASCADE
+    playlistID INTEGER NOT NULL,
+    videoPath TEXT NOT NULL,  -- below Playlist.playlistPath, absolute if outside it
+    videoTitle TEXT NOT NULL DEFAULT '',
+    sortKey BLOB,  -- natural sort key, see naturalSortKey()
+    searchText TEXT NOT NULL DEFAULT '',  -- path split into words, see VideoSearch
+    resumeTime INTEGER DEFAULT 0 CHECK(resumeTime >= 0),
+    isWatched INTEGER DEFAULT 0 CHECK(isWatched IN (0, 1)),
+
+    -- From the container headers (MediaProbe); NULL = not probed yet
+    durationMs INTEGER,   -- -1 = could not be read
+    width INTEGER,
+    height INTEGER,
+    videoCodec TEXT,
+
+    -- What a rename keeps (see PlaylistRescanner::apply); NULL = not seen
+    fileSize INTEGER,
+    fileMtime INTEGER,  -- ms since the epoch
+
+    -- Prevent duplicates: Cannot have same video path twice in one playlist
+    UNIQUE(playlistID, videoPath),
+
+    FOREIGN KEY (playlistID)
+        REFERENCES Playlist(playlistId)
+        ON DELETE CASCADE
 );
 
--- 5. Table: Notes
-CREATE TABLE Notes (
+-- Keyset paging of one playlist in natural order (sortKey, then videoID,
+-- which every index entry carries as its rowid)
+CREATE INDEX IF NOT EXISTS idx_video_playlist_sortkey ON Video(playlistID, sortKey);
+-- Watched counts per playlist without touching the rows
+CREATE INDEX IF NOT EXISTS idx_video_playlist_watched ON Video(playlistID, isWatched);
+-- Files MetadataProber has not read yet
+CREATE INDEX IF NOT EXISTS idx_video_unprobed ON Video(playlistID) WHERE durationMs IS NULL;
+
+-- Playlist counters follow the Video rows (+-1 per insert / delete / toggle)
+CREATE TRIGGER IF NOT EXISTS trg_video_insert AFTER INSERT ON Video
+BEGIN
+    UPDATE Playlist SET totalVideoCount = totalVideoCount + 1,
+        watchedCount = watchedCount + IFNULL(NEW.isWatched, 0)
+    WHERE playlistId = NEW.playlistID;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_video_delete AFTER DELETE ON Video
+BEGIN
+    UPDATE Playlist SET totalVideoCount = totalVideoCount - 1,
+        watchedCount = watchedCount - IFNULL(OLD.isWatched, 0)
+    WHERE playlistId = OLD.playlistID;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_video_watched AFTER UPDATE OF isWatched ON Video
+WHEN IFNULL(NEW.isWatched, 0) <> IFNULL(OLD.isWatched, 0)
+BEGIN
+    UPDATE Playlist
+    SET watchedCount = watchedCount + IFNULL(NEW.isWatched, 0) - IFNULL(OLD.isWatched, 0)
+    WHERE playlistId = NEW.playlistID;
+END;
+
+-- Playlist.totalDurationMs follows Video.durationMs (NULL and -1 count as 0)
+CREATE TRIGGER IF NOT EXISTS trg_video_duration_insert AFTER INSERT ON Video
+WHEN NEW.durationMs > 0
+BEGIN
+    UPDATE Playlist SET totalDurationMs = totalDurationMs + NEW.durationMs
+    WHERE playlistId = NEW.playlistID;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_video_duration_delete AFTER DELETE ON Video
+WHEN OLD.durationMs > 0
+BEGIN
+    UPDATE Playlist SET totalDurationMs = totalDurationMs - OLD.durationMs
+    WHERE playlistId = OLD.playlistID;
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_video_duration_update AFTER UPDATE OF durationMs ON Video
+WHEN NEW.durationMs IS NOT OLD.durationMs
+BEGIN
+    UPDATE Playlist SET totalDurationMs = totalDurationMs
+        + MAX(IFNULL(NEW.durationMs, 0), 0) - MAX(IFNULL(OLD.durationMs, 0), 0)
+    WHERE playlistId = NEW.playlistID;
+END;
+
+----------------------------------------------------------
+-- 4. Table: Notes (Depends on Playlist and Video)
+----------------------------------------------------------
+CREATE TABLE IF NOT EXISTS Notes (
     noteID INTEGER PRIMARY KEY AUTOINCREMENT,
-    playlistId INTEGER,
-    videoID INTEGER NOT NULL DEFAULT -1,
-    vdoStartTime TEXT, -- Store as 'HH:MM:SS'
-    vdoEndTime TEXT,   -- Store as 'HH:MM:SS'
-    FOREIGN KEY (playlistId) REFERENCES Playlist(playlistId) ON DELETE CASCADE
+
+    playlistId INTEGER NOT NULL,
+    videoID INTEGER,   -- NULL allowed for general playlist notes
+
+    noteText TEXT,     -- Added this (Missing in your snippet?)
+
+    -- Text times stored as HH:MM:SS
+    vdoStartTime TEXT CHECK (
+        vdoStartTime IS NULL OR
+        vdoStartTime GLOB '[0-9][0-9]:[0-9][0-9]:[0-9][0-9]'
+    ),
+    vdoEndTime TEXT CHECK (
+        vdoEndTime IS NULL OR
+        vdoEndTime GLOB '[0-9][0-9]:[0-9][0-9]:[0-9][0-9]'
+    ),
+
+    FOREIGN KEY (playlistId)
+        REFERENCES Playlist(playlistId)
+        ON DELETE CASCADE,
+
+    FOREIGN KEY (videoID)
+        REFERENCES Video(videoID)
+        ON DELETE CASCADE
+);
+
+----------------------------------------------------------
+-- 5. Table: General (Depends on Playlist and Video)
+----------------------------------------------------------
+-- Moved to the end so it can reference tables created above
+CREATE TABLE IF NOT EXISTS General (
+    id INTEGER PRIMARY KEY CHECK(id = 1),   -- Ensures only 1 row
+    OS TEXT CHECK(OS IN ('Windows', 'Linux', 'Mac')),
+    lastUpdated TEXT DEFAULT CURRENT_TIMESTAMP,
+    defaultMediaPlayer TEXT DEFAULT '',
+
+    lastWatchedPlId INTEGER,
+    lastWatchedVdoId INTEGER,
+
+    -- Backup store retention (BackupStore::prune), automatic snapshots
+    backupKeepLast INTEGER NOT NULL DEFAULT 5,
+    backupKeepHourly INTEGER NOT NULL DEFAULT 24,
+    backupKeepDaily INTEGER NOT NULL DEFAULT 7,
+    backupKeepWeekly INTEGER NOT NULL DEFAULT 8,
+    autoBackupHours INTEGER NOT NULL DEFAULT 1,   -- 0 = off
+
+    -- PlayerDiscovery: stamp of the searched folders, when it last searched
+    playerStamp TEXT DEFAULT '',
+    playersScannedAt INTEGER,
+
+    -- CHANGED: ON DELETE SET NULL
+    -- If the playlist/video is deleted, just clear this field.
+    -- Do NOT delete the settings row.
+    FOREIGN KEY (lastWatchedPlId) REFERENCES Playlist(playlistId) ON DELETE SET NULL,
+    FOREIGN KEY (lastWatchedVdoId) REFERENCES Video(videoID) ON DELETE SET NULL
+);
+
+----------------------------------------------------------
+-- 6. Table: DirFingerprint (Depends on Playlist)
+----------------------------------------------------------
+-- One row per folder of a playlist. Rescans compare these against a fresh
+-- stat() and only list folders whose fingerprint changed.
+CREATE TABLE IF NOT EXISTS DirFingerprint (
+    playlistID INTEGER NOT NULL,
+    dirPath TEXT NOT NULL,
+    parentPath TEXT NOT NULL DEFAULT '',   -- '' for the playlist root
+    mtime INTEGER NOT NULL DEFAULT 0,
+    entryCount INTEGER NOT NULL DEFAULT 0,
+    inode INTEGER NOT NULL DEFAULT 0,
+
+    PRIMARY KEY (playlistID, dirPath),
+
+    FOREIGN KEY (playlistID)
+        REFERENCES Playlist(playlistId)
+        ON DELETE CASCADE
+);
+
+----------------------------------------------------------
+-- 7. Trigger: Playlist status follows its progress
+----------------------------------------------------------
+CREATE TRIGGER IF NOT EXISTS trg_playlist_status
+AFTER UPDATE OF totalVideoCount, watchedCount ON Playlist
+WHEN (CASE
+        WHEN NEW.totalVideoCount > 0 AND NEW.watchedCount = NEW.totalVideoCount THEN 'Completed'
+        WHEN NEW.watchedCount > 0 THEN 'Watching'
+        WHEN NEW.status = 'Completed' THEN 'Planned to Watch'
+        ELSE NEW.status
+      END) IS NOT NEW.status
+BEGIN
+    UPDATE Playlist SET status = CASE
+        WHEN NEW.totalVideoCount > 0 AND NEW.watchedCount = NEW.totalVideoCount THEN 'Completed'
+        WHEN NEW.watchedCount > 0 THEN 'Watching'
+        WHEN NEW.status = 'Completed' THEN 'Planned to Watch'
+        ELSE NEW.status
+      END
+    WHERE playlistId = NEW.playlistId;
+END;
+
+----------------------------------------------------------
+-- 8. Full-text search (see VideoSearch), external content: the FTS5
+--    tables hold the terms, triggers keep them in step with the rows
+----------------------------------------------------------
+CREATE VIRTUAL TABLE IF NOT EXISTS VideoSearch USING fts5(
+    videoTitle, searchText,
+    content = 'Video', content_rowid = 'videoID',
+    prefix = '2 3 4', tokenize = 'unicode61 remove_diacritics 2'
 );
+-- A hit in the title counts ten times one in the folders
+INSERT INTO VideoSearch(VideoSearch, rank) VALUES ('rank', 'bm25(10.0, 1.0)');
+
+CREATE VIRTUAL TABLE IF NOT EXISTS NoteSearch USING fts5(
+    noteText,
+    content = 'Notes', content_rowid = 'noteID',
+    prefix = '2 3 4', tokenize = 'unicode61 remove_diacritics 2'
+);
+
+CREATE TRIGGER IF NOT EXISTS trg_video_search_insert AFTER INSERT ON Video
+BEGIN
+    INSERT INTO VideoSearch(rowid, videoTitle, searchText)
+    VALUES (NEW.videoID, NEW.videoTitle, NEW.searchText);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_video_search_delete AFTER DELETE ON Video
+BEGIN
+    INSERT INTO VideoSearch(VideoSearch, rowid, videoTitle, searchText)
+    VALUES ('delete', OLD.videoID, OLD.videoTitle, OLD.searchText);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_video_search_update AFTER UPDATE OF videoTitle, searchText ON Video
+BEGIN
+    INSERT INTO VideoSearch(VideoSearch, rowid, videoTitle, searchText)
+    VALUES ('delete', OLD.videoID, OLD.videoTitle, OLD.searchText);
+    INSERT INTO VideoSearch(rowid, videoTitle, searchText)
+    VALUES (NEW.videoID, NEW.videoTitle, NEW.searchText);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_note_search_insert AFTER INSERT ON Notes
+BEGIN
+    INSERT INTO NoteSearch(rowid, noteText) VALUES (NEW.noteID, NEW.noteText);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_note_search_delete AFTER DELETE ON Notes
+BEGIN
+    INSERT INTO NoteSearch(NoteSearch, rowid, noteText)
+    VALUES ('delete', OLD.noteID, OLD.noteText);
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_note_search_update AFTER UPDATE OF noteText ON Notes
+BEGIN
+    INSERT INTO NoteSearch(NoteSearch, rowid, noteText)
+    VALUES ('delete', OLD.noteID, OLD.noteText);
+    INSERT INTO NoteSearch(rowid, noteText) VALUES (NEW.noteID, NEW.noteText);
+END;
+
+----------------------------------------------------------
+-- 9. Watch history (see WatchHistory): WatchEvent is append-only, one
+--    trigger folds each event into the per-day / per-week / per-playlist
+--    rollups and the streak, so statistics never read the history itself
+----------------------------------------------------------
+CREATE TABLE IF NOT EXISTS WatchEvent (
+    eventID INTEGER PRIMARY KEY,
+    at INTEGER NOT NULL DEFAULT (CAST(strftime('%s', 'now') AS INTEGER)), -- unix time
+    playlistID INTEGER NOT NULL, -- no foreign keys: history outlives its playlist
+    videoID INTEGER,
+    kind TEXT NOT NULL CHECK(kind IN ('watched', 'unwatched', 'session')),
+    seconds INTEGER NOT NULL DEFAULT 0 CHECK(seconds >= 0) -- played, for sessions
+);
+
+-- Local day / week (its Monday) at insert time
+CREATE TABLE IF NOT EXISTS WatchDaily (
+    day TEXT PRIMARY KEY,
+    secondsWatched INTEGER NOT NULL DEFAULT 0,
+    videosFinished INTEGER NOT NULL DEFAULT 0,
+    sessions INTEGER NOT NULL DEFAULT 0
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS WatchWeekly (
+    week TEXT PRIMARY KEY,
+    secondsWatched INTEGER NOT NULL DEFAULT 0,
+    videosFinished INTEGER NOT NULL DEFAULT 0,
+    sessions INTEGER NOT NULL DEFAULT 0
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS WatchPlaylistTotal (
+    playlistID INTEGER PRIMARY KEY,
+    secondsWatched INTEGER NOT NULL DEFAULT 0,
+    videosFinished INTEGER NOT NULL DEFAULT 0,
+    sessions INTEGER NOT NULL DEFAULT 0,
+    lastEventAt INTEGER
+);
+
+CREATE TABLE IF NOT EXISTS WatchStreak (
+    id INTEGER PRIMARY KEY CHECK(id = 1),
+    lastDay TEXT,
+    currentDays INTEGER NOT NULL DEFAULT 0,
+    longestDays INTEGER NOT NULL DEFAULT 0
+);
+INSERT OR IGNORE INTO WatchStreak(id) VALUES (1);
+
+CREATE TRIGGER IF NOT EXISTS trg_watchevent_readonly BEFORE UPDATE ON WatchEvent
+BEGIN
+    SELECT RAISE(ABORT, 'WatchEvent is append-only');
+END;
+
+CREATE TRIGGER IF NOT EXISTS trg_watchevent_rollup AFTER INSERT ON WatchEvent
+BEGIN
+    INSERT INTO WatchDaily(day, secondsWatched, videosFinished, sessions)
+    VALUES (date(NEW.at, 'unixepoch', 'localtime'), NEW.seconds,
+            MAX(0, (NEW.kind = 'watched') - (NEW.kind = 'unwatched')),
+            NEW.kind = 'session')
+    ON CONFLICT(day) DO UPDATE SET
+        secondsWatched = secondsWatched + NEW.seconds,
+        videosFinished = MAX(0, videosFinished
+            + (NEW.kind = 'watched') - (NEW.kind = 'unwatched')),
+        sessions = sessions + (NEW.kind = 'session');
+
+    INSERT INTO WatchWeekly(week, secondsWatched, videosFinished, sessions)
+    VALUES (date(NEW.at, 'unixepoch', 'localtime', 'weekday 0', '-6 days'),
+            NEW.seconds,
+            MAX(0, (NEW.kind = 'watched') - (NEW.kind = 'unwatched')),
+            NEW.kind = 'session')
+    ON CONFLICT(week) DO UPDATE SET
+        secondsWatched = secondsWatched + NEW.seconds,
+        videosFinished = MAX(0, videosFinished
+            + (NEW.kind = 'watched') - (NEW.kind = 'unwatched')),
+        sessions = sessions + (NEW.kind = 'session');
+
+    INSERT INTO WatchPlaylistTotal(playlistID, secondsWatched, videosFinished,
+                                   sessions, lastEventAt)
+    VALUES (NEW.playlistID, NEW.seconds,
+            MAX(0, (NEW.kind = 'watched') - (NEW.kind = 'unwatched')),
+            NEW.kind = 'session', NEW.at)
+    ON CONFLICT(playlistID) DO UPDATE SET
+        secondsWatched = secondsWatched + NEW.seconds,
+        videosFinished = MAX(0, videosFinished
+            + (NEW.kind = 'watched') - (NEW.kind = 'unwatched')),
+        sessions = sessions + (NEW.kind = 'session'),
+        lastEventAt = MAX(lastEventAt, NEW.at);
+
+    -- A day counts once something was finished or played
+    UPDATE WatchStreak SET
+        currentDays = CASE
+            WHEN lastDay = date(NEW.at, 'unixepoch', 'localtime') THEN currentDays
+            WHEN lastDay = date(NEW.at, 'unixepoch', 'localtime', '-1 day')
+                THEN currentDays + 1
+            ELSE 1 END,
+        longestDays = MAX(longestDays, CASE
+            WHEN lastDay = date(NEW.at, 'unixepoch', 'localtime') THEN currentDays
+            WHEN lastDay = date(NEW.at, 'unixepoch', 'localtime', '-1 day')
+                THEN currentDays + 1
+            ELSE 1 END),
+        lastDay = date(NEW.at, 'unixepoch', 'localtime')
+    WHERE id = 1
+      AND (NEW.kind = 'watched' OR NEW.seconds > 0)
+      AND (lastDay IS NULL OR lastDay <= date(NEW.at, 'unixepoch', 'localtime'));
+
+    UPDATE Playlist SET lastWatchedDateTime = datetime(NEW.at, 'unixepoch')
+    WHERE playlistId = NEW.playlistID AND NEW.kind <> 'unwatched';
+END;
+
+-- Every way of (un)marking a video goes through Video.isWatched
+CREATE TRIGGER IF NOT EXISTS trg_video_watched_event AFTER UPDATE OF isWatched ON Video
+WHEN IFNULL(NEW.isWatched, 0) <> IFNULL(OLD.isWatched, 0)
+BEGIN
+    INSERT INTO WatchEvent(playlistID, videoID, kind)
+    VALUES (NEW.playlistID, NEW.videoID,
+            CASE WHEN NEW.isWatched = 1 THEN 'watched' ELSE 'unwatched' END);
+END;
+
+PRAGMA user_version = 13;
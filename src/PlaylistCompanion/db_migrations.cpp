@@ -0,0 +1,724 @@
+#include "include/db_sqlite.h"
+#include "include/naturalsortkey.h"
+#include "include/pathstore.h"
+#include "include/videoingest.h"
+#include "include/videosearch.h"
+
+#include <QRegularExpression>
+#include <iterator>
+
+// Schema history. PRAGMA user_version holds the last step applied; every
+// step runs in its own transaction together with the version bump, so a
+// failed step leaves the file at the previous version. Steps only ever get
+// appended - never edit one that has shipped, add a new one instead.
+//
+// dbPlaylistCompanion/schema.sql is the same schema for reading /
+// creating a file by hand; keep it in line with the latest version.
+
+namespace {
+
+// Queries that run per page / per toggle / per rescan. Each must be
+// answered through an index (or the rowid), never a full scan or sort.
+struct HotQuery {
+    const char *sql;
+    QVariantList binds;
+};
+
+const QVector<HotQuery> &hotQueries() {
+    static const QVector<HotQuery> queries = {
+        {"SELECT videoID, videoPath, isWatched, durationMs, sortKey "
+         "FROM Video WHERE playlistID = ? "
+         "ORDER BY sortKey, videoID LIMIT ?",
+         {1, 256}},
+        {"SELECT videoID, videoPath, isWatched, durationMs, sortKey "
+         "FROM Video WHERE playlistID = ? AND (sortKey, videoID) > (?, ?) "
+         "ORDER BY sortKey, videoID LIMIT ?",
+         {1, QByteArray("\x02" "a"), 1, 256}},
+        {"SELECT videoPath FROM Video WHERE playlistID = ?", {1}},
+        {"SELECT videoID, isWatched FROM Video WHERE playlistID = ? "
+         "AND videoPath = ?",
+         {1, "/"}},
+        {"SELECT COUNT(*) FROM Video WHERE playlistID = ? AND isWatched = 1",
+         {1}},
+        {"SELECT dirPath, parentPath, mtime, entryCount, inode "
+         "FROM DirFingerprint WHERE playlistID = ?",
+         {1}},
+        {"SELECT totalVideoCount, watchedCount, status, totalDurationMs, "
+         "lastWatchedDateTime FROM Playlist WHERE playlistId = ?",
+         {1}},
+        {"UPDATE Video SET isWatched = ? WHERE videoID = ?", {1, 1}},
+        {"UPDATE Video SET resumeTime = ? WHERE videoID = ?", {1, 1}},
+        {"DELETE FROM Video WHERE playlistID = ?", {1}},
+        {"DELETE FROM DirFingerprint WHERE playlistID = ?", {1}},
+        {"SELECT videoID, videoPath FROM Video "
+         "WHERE playlistID = ? AND durationMs IS NULL",
+         {1}},
+        {"SELECT day, secondsWatched, videosFinished, sessions "
+         "FROM WatchDaily WHERE day >= ? ORDER BY day",
+         {"2000-01-01"}},
+        {"SELECT week, secondsWatched, videosFinished, sessions "
+         "FROM WatchWeekly WHERE week >= ? ORDER BY week",
+         {"2000-01-01"}},
+    };
+    return queries;
+}
+
+} // namespace
+
+int SQliteDB::schemaVersion(QSqlDatabase &connection) {
+    QSqlQuery query(connection);
+    if (!query.exec("PRAGMA user_version") || !query.next())
+        return -1;
+    return query.value(0).toInt();
+}
+
+bool SQliteDB::migrate() {
+    struct Migration {
+        int version;
+        const char *description;
+        bool (SQliteDB::*apply)();
+    };
+    static const Migration migrations[] = {
+        {1, "base tables", &SQliteDB::migrateBaseTables},
+        {2, "folder fingerprints, live watching", &SQliteDB::migrateFolderCache},
+        {3, "video title, sort key, resume time", &SQliteDB::migrateVideoColumns},
+        {4, "trigger-maintained playlist counters",
+         &SQliteDB::migrateCounterTriggers},
+        {5, "indexes for the hot queries", &SQliteDB::migrateIndexes},
+        {6, "backup retention settings", &SQliteDB::migrateBackupSettings},
+        {7, "video duration and format, playlist total duration",
+         &SQliteDB::migrateVideoMetadata},
+        {8, "natural sort order in SQL", &SQliteDB::migrateSortKeys},
+        {9, "full-text search of videos and notes",
+         &SQliteDB::migrateSearchIndex},
+        {10, "watch history and its rollups", &SQliteDB::migrateWatchHistory},
+        {11, "media player discovery cache", &SQliteDB::migratePlayerCache},
+        {12, "video paths relative to their playlist",
+         &SQliteDB::migrateRelativePaths},
+        {13, "file size and mtime, renames in one folder",
+         &SQliteDB::migrateFileIdentity},
+    };
+    static_assert(std::size(migrations) == kSchemaVersion,
+                  "kSchemaVersion must match the last migration");
+
+    const int current = schemaVersion(db);
+    if (current < 0) {
+        qCritical() << "[sqLiteDB] Could not read schema version";
+        return false;
+    }
+    if (current > kSchemaVersion) {
+        // Written by a newer build: leave it alone, it is a superset
+        qWarning() << "[sqLiteDB] Schema version" << current
+                   << "is newer than this build (" << kSchemaVersion << ")";
+        return true;
+    }
+
+    for (const Migration &step : migrations) {
+        if (step.version <= current)
+            continue;
+
+        dbdebug << "migrating to schema" << step.version << "-"
+                << step.description;
+        if (migrationProgress)
+            migrationProgress(step.version, step.description);
+        if (!db.transaction())
+            return false;
+        QSqlQuery bump(db);
+        if (!(this->*step.apply)() ||
+            !bump.exec(QString("PRAGMA user_version = %1").arg(step.version))) {
+            qCritical() << "[sqLiteDB] Migration" << step.version
+                        << "failed:" << db.lastError().text();
+            db.rollback();
+            return false;
+        }
+        if (!db.commit())
+            return false;
+    }
+    return true;
+}
+
+bool SQliteDB::execAll(const QStringList &statements) {
+    for (const QString &statement : statements) {
+        QSqlQuery query(db);
+        if (!query.exec(statement)) {
+            qCritical() << "[sqLiteDB] Schema statement failed:" << statement
+                        << "; Error:" << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// 1. The tables as the first releases shipped them (no-op on those files,
+// creates a usable database when the file is missing)
+bool SQliteDB::migrateBaseTables() {
+    return execAll({
+        "CREATE TABLE IF NOT EXISTS MediaPlayerPath ("
+        "  mediaPlayerName TEXT PRIMARY KEY,"
+        "  mediaPlayerPath TEXT NOT NULL"
+        ");",
+
+        "CREATE TABLE IF NOT EXISTS Playlist ("
+        "  playlistId INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "  playlistTitle TEXT NOT NULL CHECK(length(playlistTitle) > 0),"
+        "  playlistPath TEXT NOT NULL CHECK(length(playlistPath) > 0),"
+        "  status TEXT DEFAULT 'Planned to Watch'"
+        "    CHECK(status IN ('Planned to Watch', 'Watching', 'Completed')),"
+        "  totalVideoCount INTEGER DEFAULT 0 CHECK(totalVideoCount >= 0),"
+        "  watchedCount INTEGER DEFAULT 0"
+        "    CHECK(watchedCount >= 0 AND watchedCount <= totalVideoCount),"
+        "  totalTimeHour INTEGER DEFAULT 0 CHECK(totalTimeHour >= 0),"
+        "  creationDateTime TEXT DEFAULT CURRENT_TIMESTAMP,"
+        "  updatingDateTime TEXT,"
+        "  lastWatchedDateTime TEXT"
+        ");",
+
+        "CREATE TABLE IF NOT EXISTS Video ("
+        "  videoID INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "  playlistID INTEGER NOT NULL,"
+        "  videoPath TEXT NOT NULL,"
+        "  isWatched INTEGER DEFAULT 0 CHECK(isWatched IN (0, 1)),"
+        "  UNIQUE(playlistID, videoPath),"
+        "  FOREIGN KEY (playlistID) REFERENCES Playlist(playlistId)"
+        "    ON DELETE CASCADE"
+        ");",
+
+        "CREATE TABLE IF NOT EXISTS Notes ("
+        "  noteID INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "  playlistId INTEGER NOT NULL,"
+        "  videoID INTEGER,"
+        "  noteText TEXT,"
+        "  vdoStartTime TEXT CHECK (vdoStartTime IS NULL OR"
+        "    vdoStartTime GLOB '[0-9][0-9]:[0-9][0-9]:[0-9][0-9]'),"
+        "  vdoEndTime TEXT CHECK (vdoEndTime IS NULL OR"
+        "    vdoEndTime GLOB '[0-9][0-9]:[0-9][0-9]:[0-9][0-9]'),"
+        "  FOREIGN KEY (playlistId) REFERENCES Playlist(playlistId)"
+        "    ON DELETE CASCADE,"
+        "  FOREIGN KEY (videoID) REFERENCES Video(videoID) ON DELETE CASCADE"
+        ");",
+
+        "CREATE TABLE IF NOT EXISTS General ("
+        "  id INTEGER PRIMARY KEY CHECK(id = 1),"
+        "  OS TEXT CHECK(OS IN ('Windows', 'Linux', 'Mac')),"
+        "  lastUpdated TEXT DEFAULT CURRENT_TIMESTAMP,"
+        "  defaultMediaPlayer TEXT DEFAULT '',"
+        "  lastWatchedPlId INTEGER,"
+        "  lastWatchedVdoId INTEGER,"
+        "  FOREIGN KEY (lastWatchedPlId) REFERENCES Playlist(playlistId)"
+        "    ON DELETE SET NULL,"
+        "  FOREIGN KEY (lastWatchedVdoId) REFERENCES Video(videoID)"
+        "    ON DELETE SET NULL"
+        ");",
+    });
+}
+
+// 2. Per-directory fingerprints for incremental rescans, opt-in watching
+bool SQliteDB::migrateFolderCache() {
+    return execAll({
+               "CREATE TABLE IF NOT EXISTS DirFingerprint ("
+               "  playlistID INTEGER NOT NULL,"
+               "  dirPath TEXT NOT NULL,"
+               "  parentPath TEXT NOT NULL DEFAULT '',"
+               "  mtime INTEGER NOT NULL DEFAULT 0,"
+               "  entryCount INTEGER NOT NULL DEFAULT 0,"
+               "  inode INTEGER NOT NULL DEFAULT 0,"
+               "  PRIMARY KEY (playlistID, dirPath),"
+               "  FOREIGN KEY (playlistID) REFERENCES Playlist(playlistId)"
+               "    ON DELETE CASCADE"
+               ");",
+           }) &&
+           addColumnIfMissing("Playlist", "watchFolder",
+                              "INTEGER NOT NULL DEFAULT 0");
+}
+
+// 3. Precomputed at ingest: display title and natural sort key. resumeTime
+// was in the design schema but missing from shipped files.
+bool SQliteDB::migrateVideoColumns() {
+    return addColumnIfMissing("Video", "videoTitle",
+                              "TEXT NOT NULL DEFAULT ''") &&
+           addColumnIfMissing("Video", "sortKey", "BLOB") &&
+           addColumnIfMissing("Video", "resumeTime",
+                              "INTEGER DEFAULT 0 CHECK(resumeTime >= 0)");
+}
+
+// 4. Playlist.totalVideoCount / watchedCount / status follow the Video
+// rows. Every Video insert, delete and isWatched change adjusts its
+// playlist by +-1 in the same transaction, so reading progress is one row.
+bool SQliteDB::migrateCounterTriggers() {
+    const QString statusCase =
+        "CASE"
+        "  WHEN NEW.totalVideoCount > 0"
+        "   AND NEW.watchedCount = NEW.totalVideoCount THEN 'Completed'"
+        "  WHEN NEW.watchedCount > 0 THEN 'Watching'"
+        "  WHEN NEW.status = 'Completed' THEN 'Planned to Watch'"
+        "  ELSE NEW.status "
+        "END";
+
+    return execAll({
+        "CREATE TRIGGER IF NOT EXISTS trg_video_insert AFTER INSERT ON Video "
+        "BEGIN"
+        "  UPDATE Playlist SET totalVideoCount = totalVideoCount + 1,"
+        "    watchedCount = watchedCount + IFNULL(NEW.isWatched, 0)"
+        "  WHERE playlistId = NEW.playlistID; "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_video_delete AFTER DELETE ON Video "
+        "BEGIN"
+        "  UPDATE Playlist SET totalVideoCount = totalVideoCount - 1,"
+        "    watchedCount = watchedCount - IFNULL(OLD.isWatched, 0)"
+        "  WHERE playlistId = OLD.playlistID; "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_video_watched "
+        "AFTER UPDATE OF isWatched ON Video "
+        "WHEN IFNULL(NEW.isWatched, 0) <> IFNULL(OLD.isWatched, 0) "
+        "BEGIN"
+        "  UPDATE Playlist SET watchedCount = watchedCount"
+        "    + IFNULL(NEW.isWatched, 0) - IFNULL(OLD.isWatched, 0)"
+        "  WHERE playlistId = NEW.playlistID; "
+        "END;",
+
+        // Status follows progress: all watched -> Completed, some -> Watching
+        "CREATE TRIGGER IF NOT EXISTS trg_playlist_status "
+        "AFTER UPDATE OF totalVideoCount, watchedCount ON Playlist "
+        "WHEN (" + statusCase + ") IS NOT NEW.status "
+        "BEGIN"
+        "  UPDATE Playlist SET status = " + statusCase +
+        "  WHERE playlistId = NEW.playlistId; "
+        "END;",
+
+        // One full recount to correct the hand-typed values of older files
+        "UPDATE Playlist SET"
+        "  totalVideoCount = (SELECT COUNT(*) FROM Video"
+        "    WHERE Video.playlistID = Playlist.playlistId),"
+        "  watchedCount = (SELECT COUNT(*) FROM Video"
+        "    WHERE Video.playlistID = Playlist.playlistId"
+        "    AND Video.isWatched = 1);",
+    });
+}
+
+// 5. UNIQUE(playlistID, videoPath) already serves path lookups; these two
+// serve paging in videoID order and watched counts without touching rows.
+bool SQliteDB::migrateIndexes() {
+    return execAll({
+        "CREATE INDEX IF NOT EXISTS idx_video_playlist_id "
+        "ON Video(playlistID, videoID);",
+        "CREATE INDEX IF NOT EXISTS idx_video_playlist_watched "
+        "ON Video(playlistID, isWatched);",
+    });
+}
+
+// 6. Retention of the backup store (see BackupStore::prune) and the
+// interval of automatic snapshots, 0 = off
+bool SQliteDB::migrateBackupSettings() {
+    return addColumnIfMissing("General", "backupKeepLast",
+                              "INTEGER NOT NULL DEFAULT 5") &&
+           addColumnIfMissing("General", "backupKeepHourly",
+                              "INTEGER NOT NULL DEFAULT 24") &&
+           addColumnIfMissing("General", "backupKeepDaily",
+                              "INTEGER NOT NULL DEFAULT 7") &&
+           addColumnIfMissing("General", "backupKeepWeekly",
+                              "INTEGER NOT NULL DEFAULT 8") &&
+           addColumnIfMissing("General", "autoBackupHours",
+                              "INTEGER NOT NULL DEFAULT 1");
+}
+
+// 7. What MediaProbe read from the container headers. durationMs is NULL
+// until a file was probed and -1 when it could not be read. The playlist
+// total follows the Video rows like the counters of step 4.
+bool SQliteDB::migrateVideoMetadata() {
+    return addColumnIfMissing("Video", "durationMs", "INTEGER") &&
+           addColumnIfMissing("Video", "width", "INTEGER") &&
+           addColumnIfMissing("Video", "height", "INTEGER") &&
+           addColumnIfMissing("Video", "videoCodec", "TEXT") &&
+           addColumnIfMissing("Playlist", "totalDurationMs",
+                              "INTEGER NOT NULL DEFAULT 0") &&
+           execAll({
+               "CREATE TRIGGER IF NOT EXISTS trg_video_duration_insert "
+               "AFTER INSERT ON Video WHEN NEW.durationMs > 0 "
+               "BEGIN"
+               "  UPDATE Playlist SET totalDurationMs = totalDurationMs"
+               "    + NEW.durationMs"
+               "  WHERE playlistId = NEW.playlistID; "
+               "END;",
+
+               "CREATE TRIGGER IF NOT EXISTS trg_video_duration_delete "
+               "AFTER DELETE ON Video WHEN OLD.durationMs > 0 "
+               "BEGIN"
+               "  UPDATE Playlist SET totalDurationMs = totalDurationMs"
+               "    - OLD.durationMs"
+               "  WHERE playlistId = OLD.playlistID; "
+               "END;",
+
+               // NULL (not probed) and -1 (unreadable) both count as 0
+               "CREATE TRIGGER IF NOT EXISTS trg_video_duration_update "
+               "AFTER UPDATE OF durationMs ON Video "
+               "WHEN NEW.durationMs IS NOT OLD.durationMs "
+               "BEGIN"
+               "  UPDATE Playlist SET totalDurationMs = totalDurationMs"
+               "    + MAX(IFNULL(NEW.durationMs, 0), 0)"
+               "    - MAX(IFNULL(OLD.durationMs, 0), 0)"
+               "  WHERE playlistId = NEW.playlistID; "
+               "END;",
+
+               // What MetadataProber still has to do, per playlist
+               "CREATE INDEX IF NOT EXISTS idx_video_unprobed "
+               "ON Video(playlistID) WHERE durationMs IS NULL;",
+
+               "UPDATE Playlist SET totalDurationMs = (SELECT"
+               "  IFNULL(SUM(durationMs), 0) FROM Video"
+               "  WHERE Video.playlistID = Playlist.playlistId"
+               "  AND durationMs > 0);",
+           });
+}
+
+// 8. The video list is ordered by sortKey (see naturalSortKey) in SQL.
+// Rows written before step 3 have none yet; the key is computed here, not
+// by a collation, so it is the same bytes whatever the locale or ICU
+// version. The videoID index only served the old ORDER BY videoID paging.
+bool SQliteDB::migrateSortKeys() {
+    QSqlQuery missing(db);
+    if (!missing.exec("SELECT videoID, videoPath FROM Video "
+                      "WHERE sortKey IS NULL"))
+        return false;
+    QVector<QPair<int, QString>> rows;
+    while (missing.next())
+        rows.append({missing.value(0).toInt(), missing.value(1).toString()});
+    missing.finish();
+
+    QSqlQuery update(db);
+    update.prepare("UPDATE Video SET sortKey = ? WHERE videoID = ?");
+    for (const auto &row : std::as_const(rows)) {
+        update.bindValue(0, naturalSortKey(row.second));
+        update.bindValue(1, row.first);
+        if (!update.exec())
+            return false;
+    }
+    if (!rows.isEmpty())
+        dbdebug << "sort keys computed for" << rows.size() << "videos";
+
+    return execAll({
+        "CREATE INDEX IF NOT EXISTS idx_video_playlist_sortkey "
+        "ON Video(playlistID, sortKey);",
+        "DROP INDEX IF EXISTS idx_video_playlist_id;",
+    });
+}
+
+// 9. FTS5 indexes over Video (title, searchText) and Notes (noteText),
+// external content: they hold the terms, the rows stay where they are.
+// searchText is the path split by VideoSearch::indexText(), computed here
+// for the rows that exist; titles missing from pre-step-3 rows as well.
+bool SQliteDB::migrateSearchIndex() {
+    if (!addColumnIfMissing("Video", "searchText", "TEXT NOT NULL DEFAULT ''"))
+        return false;
+
+    QSqlQuery missing(db);
+    if (!missing.exec("SELECT videoID, videoPath FROM Video "
+                      "WHERE searchText = ''"))
+        return false;
+    QVector<QPair<int, QString>> rows;
+    while (missing.next())
+        rows.append({missing.value(0).toInt(), missing.value(1).toString()});
+    missing.finish();
+
+    QSqlQuery update(db);
+    update.prepare("UPDATE Video SET searchText = ?, videoTitle = "
+                   "CASE WHEN videoTitle = '' THEN ? ELSE videoTitle END "
+                   "WHERE videoID = ?");
+    for (const auto &row : std::as_const(rows)) {
+        update.bindValue(0, VideoSearch::indexText(row.second));
+        update.bindValue(1, VideoIngest::titleOf(row.second));
+        update.bindValue(2, row.first);
+        if (!update.exec())
+            return false;
+    }
+
+    // unicode61 folds case and accents; prefix indexes make "lec*" as
+    // cheap as a whole word while typing
+    const QString options = "prefix = '2 3 4', "
+                            "tokenize = 'unicode61 remove_diacritics 2'";
+    return execAll({
+        "CREATE VIRTUAL TABLE IF NOT EXISTS VideoSearch USING fts5("
+        "  videoTitle, searchText,"
+        "  content = 'Video', content_rowid = 'videoID', " + options + ");",
+        "CREATE VIRTUAL TABLE IF NOT EXISTS NoteSearch USING fts5("
+        "  noteText,"
+        "  content = 'Notes', content_rowid = 'noteID', " + options + ");",
+        // A hit in the title counts ten times one in the folders
+        "INSERT INTO VideoSearch(VideoSearch, rank) "
+        "VALUES ('rank', 'bm25(10.0, 1.0)');",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_video_search_insert "
+        "AFTER INSERT ON Video "
+        "BEGIN"
+        "  INSERT INTO VideoSearch(rowid, videoTitle, searchText)"
+        "  VALUES (NEW.videoID, NEW.videoTitle, NEW.searchText); "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_video_search_delete "
+        "AFTER DELETE ON Video "
+        "BEGIN"
+        "  INSERT INTO VideoSearch(VideoSearch, rowid, videoTitle, searchText)"
+        "  VALUES ('delete', OLD.videoID, OLD.videoTitle, OLD.searchText); "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_video_search_update "
+        "AFTER UPDATE OF videoTitle, searchText ON Video "
+        "BEGIN"
+        "  INSERT INTO VideoSearch(VideoSearch, rowid, videoTitle, searchText)"
+        "  VALUES ('delete', OLD.videoID, OLD.videoTitle, OLD.searchText);"
+        "  INSERT INTO VideoSearch(rowid, videoTitle, searchText)"
+        "  VALUES (NEW.videoID, NEW.videoTitle, NEW.searchText); "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_note_search_insert "
+        "AFTER INSERT ON Notes "
+        "BEGIN"
+        "  INSERT INTO NoteSearch(rowid, noteText)"
+        "  VALUES (NEW.noteID, NEW.noteText); "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_note_search_delete "
+        "AFTER DELETE ON Notes "
+        "BEGIN"
+        "  INSERT INTO NoteSearch(NoteSearch, rowid, noteText)"
+        "  VALUES ('delete', OLD.noteID, OLD.noteText); "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_note_search_update "
+        "AFTER UPDATE OF noteText ON Notes "
+        "BEGIN"
+        "  INSERT INTO NoteSearch(NoteSearch, rowid, noteText)"
+        "  VALUES ('delete', OLD.noteID, OLD.noteText);"
+        "  INSERT INTO NoteSearch(rowid, noteText)"
+        "  VALUES (NEW.noteID, NEW.noteText); "
+        "END;",
+
+        // Index what is there already
+        "INSERT INTO VideoSearch(VideoSearch) VALUES ('rebuild');",
+        "INSERT INTO NoteSearch(NoteSearch) VALUES ('rebuild');",
+    });
+}
+
+// 10. Watch history. WatchEvent is append-only: a row per watched /
+// unwatched toggle (from the Video trigger, so every way of marking is
+// covered) and per player session with the seconds actually played. One
+// trigger folds each event into the rollups as it arrives, so statistics
+// read a row per day / week / playlist however long the history gets.
+// Days and weeks (starting Monday) are local time at insert. Events have
+// no foreign keys: history outlives removed playlists and videos.
+bool SQliteDB::migrateWatchHistory() {
+    // +1 / -1 / 0 videos finished, never below zero
+    const QString finished =
+        "(NEW.kind = 'watched') - (NEW.kind = 'unwatched')";
+    const QString day = "date(NEW.at, 'unixepoch', 'localtime')";
+    const QString streakDays =
+        "CASE"
+        "  WHEN lastDay = " + day + " THEN currentDays"
+        "  WHEN lastDay = date(NEW.at, 'unixepoch', 'localtime', '-1 day')"
+        "    THEN currentDays + 1"
+        "  ELSE 1 "
+        "END";
+    const auto rollup = [&](const QString &table, const QString &key,
+                            const QString &bucket) {
+        return "INSERT INTO " + table + "(" + key +
+               ", secondsWatched, videosFinished, sessions)"
+               "  VALUES (" + bucket + ", NEW.seconds, MAX(0, " + finished +
+               "), NEW.kind = 'session')"
+               "  ON CONFLICT(" + key + ") DO UPDATE SET"
+               "    secondsWatched = secondsWatched + NEW.seconds,"
+               "    videosFinished = MAX(0, videosFinished + " + finished + "),"
+               "    sessions = sessions + (NEW.kind = 'session');";
+    };
+
+    return execAll({
+        "CREATE TABLE IF NOT EXISTS WatchEvent ("
+        "  eventID INTEGER PRIMARY KEY,"
+        "  at INTEGER NOT NULL"
+        "    DEFAULT (CAST(strftime('%s', 'now') AS INTEGER)),"
+        "  playlistID INTEGER NOT NULL,"
+        "  videoID INTEGER,"
+        "  kind TEXT NOT NULL"
+        "    CHECK(kind IN ('watched', 'unwatched', 'session')),"
+        "  seconds INTEGER NOT NULL DEFAULT 0 CHECK(seconds >= 0)"
+        ");",
+        "CREATE TABLE IF NOT EXISTS WatchDaily ("
+        "  day TEXT PRIMARY KEY,"
+        "  secondsWatched INTEGER NOT NULL DEFAULT 0,"
+        "  videosFinished INTEGER NOT NULL DEFAULT 0,"
+        "  sessions INTEGER NOT NULL DEFAULT 0"
+        ") WITHOUT ROWID;",
+        "CREATE TABLE IF NOT EXISTS WatchWeekly ("
+        "  week TEXT PRIMARY KEY,"
+        "  secondsWatched INTEGER NOT NULL DEFAULT 0,"
+        "  videosFinished INTEGER NOT NULL DEFAULT 0,"
+        "  sessions INTEGER NOT NULL DEFAULT 0"
+        ") WITHOUT ROWID;",
+        "CREATE TABLE IF NOT EXISTS WatchPlaylistTotal ("
+        "  playlistID INTEGER PRIMARY KEY,"
+        "  secondsWatched INTEGER NOT NULL DEFAULT 0,"
+        "  videosFinished INTEGER NOT NULL DEFAULT 0,"
+        "  sessions INTEGER NOT NULL DEFAULT 0,"
+        "  lastEventAt INTEGER"
+        ");",
+        "CREATE TABLE IF NOT EXISTS WatchStreak ("
+        "  id INTEGER PRIMARY KEY CHECK(id = 1),"
+        "  lastDay TEXT,"
+        "  currentDays INTEGER NOT NULL DEFAULT 0,"
+        "  longestDays INTEGER NOT NULL DEFAULT 0"
+        ");",
+        "INSERT OR IGNORE INTO WatchStreak(id) VALUES (1);",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_watchevent_readonly "
+        "BEFORE UPDATE ON WatchEvent "
+        "BEGIN"
+        "  SELECT RAISE(ABORT, 'WatchEvent is append-only'); "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_watchevent_rollup "
+        "AFTER INSERT ON WatchEvent "
+        "BEGIN " +
+            rollup("WatchDaily", "day", day) +
+            rollup("WatchWeekly", "week",
+                   "date(NEW.at, 'unixepoch', 'localtime', 'weekday 0', "
+                   "'-6 days')") +
+        "  INSERT INTO WatchPlaylistTotal(playlistID, secondsWatched,"
+        "    videosFinished, sessions, lastEventAt)"
+        "  VALUES (NEW.playlistID, NEW.seconds, MAX(0, " + finished + "),"
+        "    NEW.kind = 'session', NEW.at)"
+        "  ON CONFLICT(playlistID) DO UPDATE SET"
+        "    secondsWatched = secondsWatched + NEW.seconds,"
+        "    videosFinished = MAX(0, videosFinished + " + finished + "),"
+        "    sessions = sessions + (NEW.kind = 'session'),"
+        "    lastEventAt = MAX(lastEventAt, NEW.at);"
+        // A day counts once something was finished or played; events
+        // arrive in time order, an older one leaves the streak alone
+        "  UPDATE WatchStreak SET"
+        "    currentDays = " + streakDays + ","
+        "    longestDays = MAX(longestDays, " + streakDays + "),"
+        "    lastDay = " + day +
+        "  WHERE id = 1 AND (NEW.kind = 'watched' OR NEW.seconds > 0)"
+        "    AND (lastDay IS NULL OR lastDay <= " + day + ");"
+        // Same UTC text as creationDateTime (CURRENT_TIMESTAMP)
+        "  UPDATE Playlist SET lastWatchedDateTime = datetime(NEW.at, 'unixepoch')"
+        "  WHERE playlistId = NEW.playlistID AND NEW.kind <> 'unwatched'; "
+        "END;",
+
+        "CREATE TRIGGER IF NOT EXISTS trg_video_watched_event "
+        "AFTER UPDATE OF isWatched ON Video "
+        "WHEN IFNULL(NEW.isWatched, 0) <> IFNULL(OLD.isWatched, 0) "
+        "BEGIN"
+        "  INSERT INTO WatchEvent(playlistID, videoID, kind)"
+        "  VALUES (NEW.playlistID, NEW.videoID,"
+        "    CASE WHEN NEW.isWatched = 1 THEN 'watched' ELSE 'unwatched' END); "
+        "END;",
+    });
+}
+
+// SQLite has no "ADD COLUMN IF NOT EXISTS"
+bool SQliteDB::addColumnIfMissing(const QString &table, const QString &column,
+                                  const QString &definition) {
+    QSqlQuery info(db);
+    if (!info.exec("PRAGMA table_info(" + table + ")"))
+        return false;
+    while (info.next()) {
+        if (info.value("name").toString() == column)
+            return true;
+    }
+
+    QSqlQuery alter(db);
+    if (!alter.exec("ALTER TABLE " + table + " ADD COLUMN " + column + " " +
+                    definition)) {
+        qCritical() << "[sqLiteDB] Adding column failed:" << table << column
+                    << "; Error:" << alter.lastError().text();
+        return false;
+    }
+    dbdebug << "added column" << table + "." + column;
+    return true;
+}
+
+bool SQliteDB::checkQueryPlans() {
+    // "SCAN Video" is a full table scan; "SCAN Video USING INDEX ..." and
+    // "SEARCH ..." are fine. A temp b-tree means a sort of the whole result.
+    static const QRegularExpression fullScan(
+        "^SCAN (TABLE )?\\w+( AS \\w+)?$");
+
+    bool allIndexed = true;
+    for (const HotQuery &hot : hotQueries()) {
+        QSqlQuery plan(db);
+        plan.prepare(QString("EXPLAIN QUERY PLAN ") + hot.sql);
+        for (int i = 0; i < hot.binds.size(); ++i)
+            plan.bindValue(i, hot.binds[i]);
+        if (!plan.exec()) {
+            qCritical() << "[sqLiteDB] EXPLAIN failed:" << hot.sql
+                        << plan.lastError().text();
+            allIndexed = false;
+            continue;
+        }
+        while (plan.next()) {
+            const QString detail = plan.value("detail").toString();
+            if (fullScan.match(detail).hasMatch() ||
+                detail.startsWith("USE TEMP B-TREE")) {
+                qCritical() << "[sqLiteDB] Query plan regression:" << detail
+                            << "|" << hot.sql;
+                allIndexed = false;
+            }
+        }
+    }
+    return allIndexed;
+}
+
+// 11. What PlayerDiscovery found, and the stamp of the folders it searched
+// (PATH, flatpak exports, snap). Settings only reads these rows; the folders
+// are stat()ed again in the background and searched when the stamp moved.
+bool SQliteDB::migratePlayerCache() {
+    return addColumnIfMissing("MediaPlayerPath", "source",
+                              "TEXT NOT NULL DEFAULT 'known' CHECK(source IN "
+                              "('known', 'path', 'flatpak', 'snap'))") &&
+           addColumnIfMissing("General", "playerStamp", "TEXT DEFAULT ''") &&
+           addColumnIfMissing("General", "playersScannedAt", "INTEGER");
+}
+
+// 12. Video.videoPath below Playlist.playlistPath ("Section 1/Intro.mp4"),
+// so the folder is stored once per playlist instead of once per video.
+// Readers put it back together with PathStore::absoluteOf(); rows outside
+// their playlist folder keep the absolute path. Done with PathStore, not
+// substr(), so it is the same split the app makes when writing rows.
+// sortKey and searchText stay as they are: both come from the whole path.
+bool SQliteDB::migrateRelativePaths() {
+    QSqlQuery rows(db);
+    if (!rows.exec("SELECT v.videoID, v.videoPath, p.playlistPath "
+                   "FROM Video v "
+                   "JOIN Playlist p ON p.playlistId = v.playlistID"))
+        return false;
+    QVector<QPair<int, QString>> changed;
+    while (rows.next()) {
+        const QString path = rows.value(1).toString();
+        const QString relative =
+            PathStore::relativeTo(rows.value(2).toString(), path);
+        if (relative != path)
+            changed.append({rows.value(0).toInt(), relative});
+    }
+    rows.finish();
+
+    QSqlQuery update(db);
+    update.prepare("UPDATE Video SET videoPath = ? WHERE videoID = ?");
+    for (const auto &row : std::as_const(changed)) {
+        update.bindValue(0, row.second);
+        update.bindValue(1, row.first);
+        if (!update.exec())
+            return false;
+    }
+    if (!changed.isEmpty())
+        dbdebug << "paths made relative for" << changed.size() << "videos";
+    return true;
+}
+
+// 13. Size and mtime of each video file, so a rescan can tell a file
+// renamed in its folder from a delete plus an unrelated copy. Not filled
+// here (the drive may be offline, and it is a stat per file): new rows get
+// them at ingest, old ones whenever a rescan lists their folder.
+bool SQliteDB::migrateFileIdentity() {
+    return addColumnIfMissing("Video", "fileSize", "INTEGER") &&
+           addColumnIfMissing("Video", "fileMtime", "INTEGER");
+}
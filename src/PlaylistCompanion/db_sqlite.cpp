@@ -1,4 +1,45 @@
 #include "include/db_sqlite.h"
+#include "include/backupstore.h"
+#include "include/dbbackup.h"
+#include "include/dbevents.h"
+#include "include/dbwriter.h"
+#include "include/tracing.h"
+
+#include <QElapsedTimer>
+#include <QThreadStorage>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+constexpr int kMainCacheKiB = 16 * 1024;
+constexpr int kReadCacheKiB = 4 * 1024;
+constexpr qint64 kMmapBytes = 256LL * 1024 * 1024;
+
+// One read-only connection per thread. QThreadStorage deletes it on the
+// owning thread when that thread exits, which is where Qt wants the
+// connection to be closed.
+struct ReadConnection {
+    QString name;
+    QHash<QString, QSqlQuery> statements;
+    std::atomic_int *counter = nullptr;
+
+    ~ReadConnection() {
+        statements.clear(); // statements before their connection
+        {
+            QSqlDatabase connection = QSqlDatabase::database(name, false);
+            connection.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+        if (counter)
+            (*counter)--;
+    }
+};
+
+QThreadStorage<ReadConnection *> readConnections;
+
+} // namespace
 
 SQliteDB *SQliteDB::dbInstance = nullptr;
 QString SQliteDB::appPath = "";
@@ -11,6 +52,20 @@ QString SQliteDB::getAppDirPath() { return appDirPath; }
 QString SQliteDB::getDbPath() { return dbPath; }
 QString SQliteDB::getDbDirPath() { return dbDirPath; }
 
+void SQliteDB::initPaths() {
+    if (!dbPath.isEmpty())
+        return;
+    SQliteDB::appPath = QCoreApplication::applicationFilePath();
+    SQliteDB::appDirPath = QCoreApplication::applicationDirPath();
+    SQliteDB::dbDirPath = SQliteDB::appDirPath +
+#ifdef __linux__
+        "/dbPlaylistCompanion/";
+#elif _WIN32
+        "\\dbPlaylistCompanion\\";
+#endif
+    SQliteDB::dbPath = SQliteDB::dbDirPath + "db_PL.sqlite";
+}
+
 // Get the singleton instance
 SQliteDB *SQliteDB::instance() {
     if (!dbInstance) {
@@ -18,15 +73,8 @@ SQliteDB *SQliteDB::instance() {
         SQliteDB::dbInstance = new SQliteDB();
 
         // generate paths
-        SQliteDB::appPath = QCoreApplication::applicationFilePath();
-        SQliteDB::appDirPath = QCoreApplication::applicationDirPath();
-        SQliteDB::dbDirPath = SQliteDB::appDirPath +
-#ifdef __linux__
-            "/dbPlaylistCompanion/";
-#elif _WIN32
-            "\\dbPlaylistCompanion\\";
-#endif
-        SQliteDB::dbPath = SQliteDB::dbDirPath + "db_PL.sqlite";
+        initPaths();
+        applyPendingRestore();
 
         // open db
         dbInstance->openDB(dbInstance->dbPath);
@@ -34,6 +82,28 @@ SQliteDB *SQliteDB::instance() {
     return SQliteDB::dbInstance;
 }
 
+bool SQliteDB::upgradeDatabase(const MigrationProgress &progress) {
+    PLC_TRACE_SPAN(span, "db.upgrade");
+    initPaths();
+    applyPendingRestore();
+    bool ok = false;
+    {
+        // Same openDB() as the main connection, on another name and thread
+        SQliteDB upgrader;
+        upgrader.connectionName = "db_upgrade";
+        upgrader.migrationProgress = progress;
+        ok = upgrader.openDB(dbPath);
+#ifndef QT_NO_DEBUG
+        // An index lost in a migration shows up in the log, not as a slow
+        // UI later. Only a warning; plc-bench fails on it.
+        if (ok && !upgrader.checkQueryPlans())
+            qWarning() << "[sqLiteDB] A hot query scans a whole table, see above";
+#endif
+    } // closed here, before the connection is removed
+    QSqlDatabase::removeDatabase("db_upgrade");
+    return ok;
+}
+
 // Open the database
 bool SQliteDB::openDB(const QString &dbPath) {
     if (db.isOpen())
@@ -44,38 +114,215 @@ bool SQliteDB::openDB(const QString &dbPath) {
     // QList listOfDrivers = QSqlDatabase::drivers();
     // qDebug() << listOfDrivers;
 
-    const QString connectionName = "db_connection";
     if (QSqlDatabase::contains(connectionName)) {
         db = QSqlDatabase::database(connectionName);
     } else {
         db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
         db.setDatabaseName(dbPath);
+        // DbWriter commits on its own connection; wait instead of failing
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
     }
 
     if (!db.open()) {
         qCritical() << "[sqLiteDB] Failed to open DB: " << db.lastError().text();
         return false;
     }
+    mainThread = QThread::currentThread();
+
+    // WAL: readers never block the writer and the writer never blocks them.
+    // Stored in the file, so every later connection gets it too.
+    QSqlQuery journal(db);
+    if (!journal.exec("PRAGMA journal_mode=WAL") || !journal.next() ||
+        journal.value(0).toString().compare("wal", Qt::CaseInsensitive) != 0)
+        qWarning() << "[sqLiteDB] WAL not available, staying in rollback mode";
+    journal.finish();
 
+    // Backups go through the linked SQLite; refused if Qt uses another one
+    DbBackup::checkDriver(db);
+
+    return configureConnection(db, kMainCacheKiB) && migrate();
+}
+
+bool SQliteDB::configureConnection(QSqlDatabase &connection, int cacheKiB) {
+    const QStringList pragmas = {
+        // Safe with WAL: a power cut may lose the last commits, never
+        // corrupts the file. Saves an fsync per transaction.
+        "PRAGMA synchronous=NORMAL",
+        QString("PRAGMA mmap_size=%1").arg(kMmapBytes),
+        QString("PRAGMA cache_size=-%1").arg(cacheKiB), // negative: KiB
+        "PRAGMA temp_store=MEMORY",
+    };
+
+    for (const QString &pragma : pragmas) {
+        QSqlQuery query(connection);
+        if (!query.exec(pragma)) {
+            qCritical() << "[sqLiteDB] Pragma failed:" << pragma
+                        << "; Error:" << query.lastError().text();
+            return false;
+        }
+    }
     return true;
 }
 
+QSqlDatabase SQliteDB::readDatabase() {
+    if (QThread::currentThread() == mainThread)
+        return db;
+
+    // A restore copies into the same file, so a connection never goes
+    // stale: it sees the restored pages like any other commit
+    if (!readConnections.hasLocalData()) {
+        auto *connection = new ReadConnection;
+        connection->name =
+            QString("db_read_%1").arg(quintptr(QThread::currentThreadId()));
+        readConnections.setLocalData(connection);
+
+        QSqlDatabase readDb =
+            QSqlDatabase::addDatabase("QSQLITE", connection->name);
+        readDb.setDatabaseName(dbPath);
+        readDb.setConnectOptions(
+            "QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+        if (!readDb.open() || !configureConnection(readDb, kReadCacheKiB)) {
+            qCritical() << "[sqLiteDB] Failed to open read connection:"
+                        << readDb.lastError().text();
+        } else {
+            connection->counter = &readConnectionCount;
+            dbdebug << "read connection opened:" << connection->name << "("
+                    << ++readConnectionCount << "open )";
+        }
+    }
+    return QSqlDatabase::database(readConnections.localData()->name, false);
+}
+
+QSqlQuery SQliteDB::execRead(const QString &sql, const QVariantList &binds) {
+    if (QThread::currentThread() == mainThread)
+        return execPrepared(sql, binds);
+
+    PLC_TRACE_SPAN(span, "sql.read");
+    PLC_TRACE_DETAIL(span, sql);
+
+    // Thread-local connection and cache, so no locking
+    QSqlDatabase readDb = readDatabase();
+    QHash<QString, QSqlQuery> &statements =
+        readConnections.localData()->statements;
+
+    auto it = statements.find(sql);
+    if (it == statements.end()) {
+        QSqlQuery query(readDb);
+        query.setForwardOnly(true);
+        if (!query.prepare(sql)) {
+            qCritical() << "[sqLiteDB] Prepare failed:" << sql
+                << "; Error:" << query.lastError().text();
+            return query;
+        }
+        it = statements.insert(sql, query);
+    } else {
+        it->finish();
+    }
+
+    QSqlQuery query = *it;
+    for (int i = 0; i < binds.size(); ++i)
+        query.bindValue(i, binds[i]);
+    if (!query.exec()) {
+        qCritical() << "[sqLiteDB] Query failed:" << sql << binds
+            << "; Error:" << query.lastError().text();
+    }
+    PLC_TRACE_ROWS(span, query.numRowsAffected());
+    return query;
+}
+
 // Execute a query and return QSqlQuery object
 QSqlQuery SQliteDB::execQuery(const QString &queryStr) {
+    PLC_TRACE_SPAN(span, "sql.exec");
+    PLC_TRACE_DETAIL(span, queryStr);
     QMutexLocker locker(&queryMutex);
     QSqlQuery query(db);
     if (!query.exec(queryStr)) {
         qCritical() << "[sqLiteDB] Query failed:" << queryStr
             << "; Error:" << query.lastError().text();
     }
+    PLC_TRACE_ROWS(span, query.numRowsAffected());
     return query;
 }
 
+// Execute a bound statement through the statement cache
+QSqlQuery SQliteDB::execPrepared(const QString &sql, const QVariantList &binds) {
+    // exec() runs the first step: for a SELECT the span is the time to the
+    // first row; rows are counted for writes only (SQLite has no size())
+    PLC_TRACE_SPAN(span, "sql.prepared");
+    PLC_TRACE_DETAIL(span, sql);
+    QMutexLocker locker(&queryMutex);
+    QSqlQuery query = cachedStatement(sql);
+    for (int i = 0; i < binds.size(); ++i)
+        query.bindValue(i, binds[i]);
+    if (!query.exec()) {
+        qCritical() << "[sqLiteDB] Query failed:" << sql << binds
+            << "; Error:" << query.lastError().text();
+    }
+    PLC_TRACE_ROWS(span, query.numRowsAffected());
+    return query;
+}
+
+QSqlQuery SQliteDB::cachedStatement(const QString &sql) {
+    StatementStats &stats = statementCounters[sql];
+    stats.sql = sql;
+
+    // 1. Hit: move to the front, reset a result the last caller left open
+    auto it = statementCache.find(sql);
+    if (it != statementCache.end()) {
+        stats.hits++;
+        if (statementLru.first() != sql) {
+            statementLru.removeOne(sql);
+            statementLru.prepend(sql);
+        }
+        it->finish();
+        return *it;
+    }
+
+    // 2. Miss: compile, evict the least recently used one if full
+    stats.misses++;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.prepare(sql)) {
+        qCritical() << "[sqLiteDB] Prepare failed:" << sql
+            << "; Error:" << query.lastError().text();
+        return query; // not cached, exec() reports the error again
+    }
+    if (statementCache.size() >= kStatementCacheSize)
+        statementCache.remove(statementLru.takeLast());
+    statementCache.insert(sql, query);
+    statementLru.prepend(sql);
+    return query;
+}
+
+void SQliteDB::clearStatementCache() {
+    statementCache.clear();
+    statementLru.clear();
+}
+
+QVector<SQliteDB::StatementStats> SQliteDB::statementStats() const {
+    QVector<StatementStats> result(statementCounters.cbegin(),
+                                   statementCounters.cend());
+    std::sort(result.begin(), result.end(),
+              [](const StatementStats &a, const StatementStats &b) {
+                  return a.hits + a.misses > b.hits + b.misses;
+              });
+    return result;
+}
+
+void SQliteDB::logStatementStats() const {
+    for (const StatementStats &stats : statementStats()) {
+        dbdebug << "statement cache: hits" << stats.hits << "misses"
+                << stats.misses << "|" << stats.sql;
+    }
+}
+
 // Check if DB is open
 bool SQliteDB::isOpen() const { return db.isOpen(); }
 
 // Close the database connection
 void SQliteDB::closeDB() {
+    // Prepared statements must go before their connection
+    clearStatementCache();
     if (db.isOpen())
         db.close();
 }
@@ -84,18 +331,187 @@ void SQliteDB::closeDB() {
 QSqlDatabase &SQliteDB::database() { return db; }
 
 QString SQliteDB::backupDBfile() {
-    QString newlyCreatedBackup =
-        dbDirPath + "backup_" +
-        QDateTime::currentDateTime().toString("yyyy-MM-dd_HH-mm-ss") +
-        ".sqlite";
-    copyFile(dbPath, newlyCreatedBackup);
-    dbdebug << "db backup created at :" << newlyCreatedBackup;
-    return newlyCreatedBackup;
-}
-
-void SQliteDB::restoreDBfile(QString targetFilePath) {
-    backupDBfile();
-    copyFile(targetFilePath, dbInstance->dbPath);
+    // Snapshot in the backup store, see BackupStore / DbBackup
+    SnapshotInfo snapshot;
+    QString error;
+    if (!BackupStore::snapshot(dbPath, &snapshot, &error)) {
+        qCritical() << "[sqLiteDB] Backup failed:" << error;
+        return QString();
+    }
+    dbdebug << "db backup created, snapshot:" << snapshot.id;
+    return snapshot.id;
+}
+
+bool SQliteDB::restoreDBfile(const QString &sourcePath, QString *error) {
+    // 1. Stage a consistent, verified copy next to the live file (same
+    // filesystem, so nothing goes half-read over the network)
+    const QString staged = dbPath + ".restore";
+    const BackupResult copied = DbBackup::copy(sourcePath, staged);
+    if (!copied.ok) {
+        if (error)
+            *error = copied.error;
+        qCritical() << "[sqLiteDB] Can not stage" << sourcePath << ":"
+                    << copied.error;
+        return false;
+    }
+    return swapInDBfile(staged, error);
+}
+
+bool SQliteDB::restoreSnapshot(const QString &snapshotId, QString *error) {
+    // rebuild() verifies chunks and integrity, so it can stage directly
+    const QString staged = dbPath + ".restore";
+    if (!BackupStore::rebuild(snapshotId, staged, error)) {
+        qCritical() << "[sqLiteDB] Can not rebuild snapshot" << snapshotId;
+        return false;
+    }
+    return swapInDBfile(staged, error);
+}
+
+int SQliteDB::generation() const { return fileGeneration.load(); }
+
+bool SQliteDB::checkStagedFile(const QString &stagedPath, QString *error) {
+    const QString connectionName = "db_restore_check";
+    bool ok = false;
+    {
+        QSqlDatabase staged =
+            QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        staged.setDatabaseName(stagedPath);
+        staged.setConnectOptions("QSQLITE_OPEN_READONLY");
+        const int version = staged.open() ? schemaVersion(staged) : -1;
+        QSqlQuery tables(staged);
+        const bool hasTables =
+            version >= 0 &&
+            tables.exec("SELECT COUNT(*) FROM sqlite_master WHERE type = "
+                        "'table' AND name IN ('Playlist', 'Video')") &&
+            tables.next() && tables.value(0).toInt() == 2;
+        tables.finish();
+
+        // Older versions are migrated by openDB(); newer ones are unknown
+        if (!hasTables)
+            *error = "Not a Playlist Companion database.";
+        else if (version > kSchemaVersion)
+            *error = QString("Schema version %1 is newer than this build "
+                             "(%2).").arg(version).arg(kSchemaVersion);
+        else
+            ok = true;
+        staged.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return ok;
+}
+
+bool SQliteDB::swapInDBfile(const QString &stagedPath, QString *error) {
+    Q_ASSERT(QThread::currentThread() == mainThread);
+    QString reason;
+    const auto fail = [&](const QString &why) {
+        qCritical() << "[sqLiteDB] Restore failed:" << why;
+        if (error)
+            *error = why;
+        QFile::remove(stagedPath);
+        return false;
+    };
+
+    // 1. Validate before anything is touched
+    if (!checkStagedFile(stagedPath, &reason))
+        return fail(reason);
+
+    // 2. The copy below hands the main connection's handle to the SQLite
+    // linked for backups. A Qt with its own SQLite can not take that: the
+    // file is swapped on the next start instead, before anything opens it.
+    if (!DbBackup::sameLibrary(db, &reason))
+        return deferSwap(stagedPath, reason, error);
+
+    // 3. Background work (prober, folder sync, rescans, search) finishes or
+    // drops what it has in flight while the writer still runs, so nothing
+    // is left waiting on it once it is parked. Parking commits the queue.
+    QElapsedTimer timer;
+    timer.start();
+    emit DbEvents::instance()->aboutToReplaceDatabase();
+    DbWriter *writer = DbWriter::instance();
+    writer->suspend();
+
+    // 4. Only now the current data goes into the backup store: every write
+    // made before the restore is in it, none can land after it
+    if (backupDBfile().isEmpty()) {
+        writer->resume();
+        return fail("Could not back up the current database.");
+    }
+    fileGeneration++;
+
+    // 5. Copy the staged pages into the live file through the main
+    // connection, in one write transaction. No file is renamed or deleted:
+    // the read connections keep their handles on the same file and see the
+    // restored data like any other commit.
+    clearStatementCache();
+    const bool copied = DbBackup::restoreInto(stagedPath, db, &reason);
+
+    // 6. Migrate before the writer reconnects; after a failed copy the old
+    // data is still there untouched
+    const bool migrated = copied && migrate();
+    writer->resume();
+    if (!copied)
+        return fail(reason);
+    QFile::remove(stagedPath);
+    if (!migrated)
+        return fail("The restored database could not be migrated.");
+
+    dbdebug << "database restored in" << timer.elapsed() << "ms";
+    emit DbEvents::instance()->databaseReplaced();
+    return true;
+}
+
+QString SQliteDB::pendingRestorePath() { return dbPath + ".pending"; }
+
+bool SQliteDB::hasPendingRestore() { return QFile::exists(pendingRestorePath()); }
+
+bool SQliteDB::deferSwap(const QString &stagedPath, const QString &why,
+                         QString *error) {
+    const QString pending = pendingRestorePath();
+    QFile::remove(pending);
+    if (!QFile::rename(stagedPath, pending)) {
+        QFile::remove(stagedPath);
+        qCritical() << "[sqLiteDB] Restore failed:" << why;
+        if (error)
+            *error = why;
+        return false;
+    }
+    qWarning() << "[sqLiteDB] Hot restore refused," << why
+               << "The backup is swapped in on the next start.";
+    if (error)
+        *error = why + "\n\nThe backup is restored the next time Playlist "
+                       "Companion starts.";
+    return false;
+}
+
+void SQliteDB::applyPendingRestore() {
+    const QString pending = pendingRestorePath();
+    if (!QFile::exists(pending))
+        return;
+    dbdebug << "swapping in the restore staged on the last run";
+
+    // 1. No connection is open yet, so the backup API may read the live
+    // file (and its -wal) here; the old data goes into the store first
+    if (QFile::exists(dbPath)) {
+        SnapshotInfo snapshot;
+        QString error;
+        if (!BackupStore::snapshot(dbPath, &snapshot, &error)) {
+            // Stays pending: tried again on the next start
+            qCritical() << "[sqLiteDB] Pending restore not applied, backup "
+                           "failed:" << error;
+            return;
+        }
+    }
+
+    // 2. The -wal and -shm belong to the old file; then the rename
+    QFile::remove(dbPath + "-wal");
+    QFile::remove(dbPath + "-shm");
+    std::error_code renameError;
+    std::filesystem::rename(std::filesystem::path(pending.toStdU16String()),
+                            std::filesystem::path(dbPath.toStdU16String()),
+                            renameError);
+    if (renameError)
+        qCritical() << "[sqLiteDB] Pending restore not applied:"
+                    << QString::fromStdString(renameError.message());
 }
 
 SQliteDB::SQliteDB() {}
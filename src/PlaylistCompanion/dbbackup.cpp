@@ -0,0 +1,247 @@
+#include "include/dbbackup.h"
+#include "include/tracing.h"
+#include "include/db_sqlite.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QThread>
+#include <sqlite3.h>
+
+namespace {
+
+// Owns one raw connection opened by this file
+struct Connection {
+  sqlite3 *handle = nullptr;
+  ~Connection() { sqlite3_close_v2(handle); }
+};
+
+bool openConnection(Connection &conn, const QString &path, int flags,
+                    QString *error) {
+  const int rc = sqlite3_open_v2(path.toUtf8().constData(), &conn.handle,
+                                 flags | SQLITE_OPEN_NOMUTEX, nullptr);
+  if (rc != SQLITE_OK) {
+    if (error)
+      *error = QString("Can not open %1: %2")
+                   .arg(path, QString::fromUtf8(sqlite3_errstr(rc)));
+    return false;
+  }
+  sqlite3_busy_timeout(conn.handle, 5000);
+  return true;
+}
+
+} // namespace
+
+std::atomic_bool DbBackup::driverMismatch{false};
+
+BackupResult DbBackup::copy(const QString &srcPath, const QString &destPath,
+                            const std::function<void(int, int)> &progress,
+                            const std::atomic_bool *cancelFlag) {
+  PLC_TRACE_SPAN(span, "backup.copy");
+  QElapsedTimer timer;
+  timer.start();
+  BackupResult result;
+  const QString partPath = destPath + ".part";
+
+  // 0. Not through a second SQLite while Qt's driver has the file open
+  if (driverMismatch && QFileInfo(srcPath) == QFileInfo(SQliteDB::getDbPath())) {
+    result.error = "Online backup disabled: Qt's SQLite driver is not the "
+                   "SQLite library linked for backups.";
+    qCritical() << "[DbBackup]" << result.error;
+    return result;
+  }
+  QFile::remove(partPath);
+
+  {
+    // 1. Own connections: the source read-only, the copy as a new file
+    Connection src, dest;
+    if (!openConnection(src, srcPath, SQLITE_OPEN_READONLY, &result.error) ||
+        !openConnection(dest, partPath,
+                        SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE,
+                        &result.error))
+      return result;
+
+    sqlite3_backup *backup =
+        sqlite3_backup_init(dest.handle, "main", src.handle, "main");
+    if (!backup) {
+      result.error = QString::fromUtf8(sqlite3_errmsg(dest.handle));
+      return result;
+    }
+
+    // 2. A few pages at a time. A commit by another connection restarts the
+    // copy; after kMaxRestarts the rest goes in one step (-1), which holds
+    // only a WAL read snapshot and does not block the writer either.
+    int pagesPerStep = kPagesPerStep;
+    int restarts = 0;
+    int lastRemaining = -1;
+    int rc = SQLITE_OK;
+    while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+      if (cancelFlag && *cancelFlag) {
+        rc = SQLITE_INTERRUPT;
+        break;
+      }
+      rc = sqlite3_backup_step(backup, pagesPerStep);
+
+      const int remaining = sqlite3_backup_remaining(backup);
+      const int total = sqlite3_backup_pagecount(backup);
+      if (lastRemaining >= 0 && remaining > lastRemaining &&
+          ++restarts >= kMaxRestarts && pagesPerStep > 0) {
+        backupdebug << "source keeps changing, copying the rest at once";
+        pagesPerStep = -1;
+      }
+      lastRemaining = remaining;
+      if (progress)
+        progress(total - remaining, total);
+
+      if (rc == SQLITE_OK)
+        QThread::msleep(kYieldMs);
+      else if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+        QThread::msleep(kBusyRetryMs);
+    }
+    result.pages = sqlite3_backup_pagecount(backup);
+    sqlite3_backup_finish(backup);
+
+    if (rc != SQLITE_DONE) {
+      result.error = rc == SQLITE_INTERRUPT
+                         ? QString("Backup cancelled.")
+                         : QString::fromUtf8(sqlite3_errstr(rc));
+    } else if (sqlite3_exec(dest.handle, "PRAGMA journal_mode=DELETE",
+                            nullptr, nullptr, nullptr) != SQLITE_OK) {
+      // The copy carries the WAL flag of the source; a backup should be
+      // one self-contained file (openDB switches it back to WAL)
+      result.error = QString::fromUtf8(sqlite3_errmsg(dest.handle));
+    }
+  }
+
+  // 3. Only a copy that passes integrity_check replaces destPath
+  if (result.error.isEmpty() && verify(partPath, &result.error)) {
+    QFile::remove(destPath);
+    if (QFile::rename(partPath, destPath)) {
+      result.ok = true;
+      result.path = destPath;
+    } else {
+      result.error = "Can not move the backup into place: " + destPath;
+    }
+  }
+  if (!result.ok)
+    QFile::remove(partPath);
+
+  result.elapsedMs = timer.elapsed();
+  return result;
+}
+
+bool DbBackup::verify(const QString &path, QString *error) {
+  Connection conn;
+  if (!openConnection(conn, path, SQLITE_OPEN_READONLY, error))
+    return false;
+
+  // One row "ok", otherwise one row per problem found
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(conn.handle, "PRAGMA integrity_check", -1, &stmt,
+                         nullptr) != SQLITE_OK) {
+    if (error)
+      *error = QString::fromUtf8(sqlite3_errmsg(conn.handle));
+    return false;
+  }
+  QStringList problems;
+  int rc;
+  while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    const QString row = QString::fromUtf8(
+        reinterpret_cast<const char *>(sqlite3_column_text(stmt, 0)));
+    if (row != "ok")
+      problems.append(row);
+  }
+  sqlite3_finalize(stmt);
+
+  if (rc != SQLITE_DONE)
+    problems.append(QString::fromUtf8(sqlite3_errstr(rc)));
+  if (!problems.isEmpty()) {
+    if (error)
+      *error = "Integrity check failed: " + problems.join("; ");
+    return false;
+  }
+  return true;
+}
+
+bool DbBackup::restoreInto(const QString &srcPath, QSqlDatabase &dest,
+                           QString *error) {
+  PLC_TRACE_SPAN(span, "backup.restore");
+  const auto fail = [error](const QString &why) {
+    if (error)
+      *error = why;
+    return false;
+  };
+
+  // 1. The raw handle under the Qt connection, only if it belongs to the
+  // library linked here
+  QString libraryError;
+  if (!sameLibrary(dest, &libraryError))
+    return fail(libraryError);
+  const QVariant handle = dest.driver()->handle();
+  if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0)
+    return fail("Not an SQLite connection.");
+  sqlite3 *destHandle = *static_cast<sqlite3 *const *>(handle.constData());
+  if (!destHandle)
+    return fail("The database is not open.");
+
+  Connection src;
+  QString openError;
+  if (!openConnection(src, srcPath, SQLITE_OPEN_READONLY, &openError))
+    return fail(openError);
+
+  sqlite3_backup *backup =
+      sqlite3_backup_init(destHandle, "main", src.handle, "main");
+  if (!backup)
+    return fail(QString::fromUtf8(sqlite3_errmsg(destHandle)));
+
+  // 2. All pages in one step: readers never see half a restore. A reader
+  // of the live file only delays the commit; retry that for a while.
+  int rc = SQLITE_OK;
+  for (int retries = 0; retries <= kMaxBusyRetries; ++retries) {
+    rc = sqlite3_backup_step(backup, -1);
+    if (rc != SQLITE_BUSY && rc != SQLITE_LOCKED)
+      break;
+    QThread::msleep(kBusyRetryMs);
+  }
+  const int pages = sqlite3_backup_pagecount(backup);
+  sqlite3_backup_finish(backup);
+
+  if (rc != SQLITE_DONE) {
+    // SQLITE_READONLY here means a page size the WAL file can not take
+    return fail(QString("Can not copy %1 into the database: %2")
+                    .arg(srcPath, QString::fromUtf8(sqlite3_errstr(rc))));
+  }
+  backupdebug << "restored" << pages << "pages from" << srcPath;
+  return true;
+}
+
+bool DbBackup::sameLibrary(QSqlDatabase &connection, QString *error) {
+  const QString linked = QString::fromLatin1(sqlite3_sourceid());
+  QSqlQuery query(connection);
+  const QString driver = query.exec("SELECT sqlite_source_id()") && query.next()
+                             ? query.value(0).toString()
+                             : QString();
+  query.finish();
+  if (driver == linked)
+    return true;
+  if (error)
+    *error = QString("Qt's SQLite driver uses another SQLite library (%1) "
+                     "than the one linked for backups (%2).")
+                 .arg(driver.isEmpty() ? QString("unknown") : driver.left(19),
+                      linked.left(19));
+  return false;
+}
+
+void DbBackup::checkDriver(QSqlDatabase &connection) {
+  QString error;
+  if (sameLibrary(connection, &error)) {
+    driverMismatch = false;
+    return;
+  }
+  driverMismatch = true;
+  qCritical() << "[DbBackup]" << error
+              << "Backups of the live database are disabled; build Qt with "
+                 "-system-sqlite or link the SQLite its plugin uses.";
+}
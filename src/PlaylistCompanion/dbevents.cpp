@@ -0,0 +1,11 @@
+#include "include/dbevents.h"
+
+DbEvents *DbEvents::eventsInstance = nullptr;
+
+DbEvents *DbEvents::instance() {
+  if (!eventsInstance)
+    eventsInstance = new DbEvents();
+  return eventsInstance;
+}
+
+DbEvents::DbEvents(QObject *parent) : QObject(parent) {}
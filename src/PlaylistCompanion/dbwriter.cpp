@@ -0,0 +1,275 @@
+#include "include/dbwriter.h"
+#include "include/db_sqlite.h"
+#include "include/tracing.h"
+
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QtSql/QSqlError>
+#include <vector>
+
+DbWriter *DbWriter::writerInstance = nullptr;
+
+DbWriter *DbWriter::instance() {
+  if (!writerInstance) {
+    // Paths and schema come from the main connection
+    SQliteDB::instance();
+    writerInstance = new DbWriter();
+  }
+  return writerInstance;
+}
+
+void DbWriter::shutdown() {
+  if (!writerInstance)
+    return;
+  delete writerInstance;
+  writerInstance = nullptr;
+}
+
+DbWriter::DbWriter() {
+  thread = QThread::create([this]() { loop(); });
+  thread->setObjectName("DbWriter");
+  thread->start();
+}
+
+DbWriter::~DbWriter() {
+  // 1. Everything already queued still gets written
+  flush();
+
+  // 2. Stop the loop and wait for the connection to close
+  {
+    QMutexLocker locker(&queueMutex);
+    stopping = true;
+  }
+  queueChanged.wakeAll();
+  thread->wait();
+  delete thread;
+  writerdebug << "stopped";
+}
+
+QFuture<WriteResult> DbWriter::enqueue(const QString &sql,
+                                       const QVariantList &binds) {
+  auto promise = std::make_shared<QPromise<WriteResult>>();
+  QFuture<WriteResult> future = promise->future();
+  promise->start();
+  post(Command{sql, binds, promise, {}});
+  return future;
+}
+
+void DbWriter::post(Command command) {
+  {
+    QMutexLocker locker(&queueMutex);
+    if (!stopping) {
+      if (command.job)
+        queuedJobs++;
+      queue.push_back(std::move(command));
+      command = Command{};
+    }
+  }
+  queueChanged.wakeAll();
+
+  // Posted after shutdown: fail instead of hanging the caller
+  if (command.promise) {
+    qCritical() << "[DbWriter] write after shutdown dropped:" << command.sql;
+    command.promise->addResult(WriteResult{false, {}, 0, "writer stopped"});
+    command.promise->finish();
+  } else if (command.job) {
+    qCritical() << "[DbWriter] job after shutdown dropped";
+  }
+}
+
+void DbWriter::flush() {
+  if (isWriterThread())
+    return; // a job can not wait for itself
+  run([]() { return true; }).waitForFinished();
+}
+
+void DbWriter::suspend() {
+  Q_ASSERT(!isWriterThread());
+  {
+    QMutexLocker locker(&suspendMutex);
+    suspended = true;
+  }
+
+  // A job runs after everything queued before it, alone on the thread
+  run([this]() {
+    if (connectionOpen)
+      closeConnection();
+    QMutexLocker locker(&suspendMutex);
+    parked = true;
+    suspendChanged.wakeAll();
+    while (suspended)
+      suspendChanged.wait(&suspendMutex);
+    parked = false;
+    locker.unlock();
+
+    connectionOpen = openConnection();
+    return connectionOpen;
+  });
+
+  QMutexLocker locker(&suspendMutex);
+  while (!parked)
+    suspendChanged.wait(&suspendMutex);
+  writerdebug << "suspended, connection closed";
+}
+
+void DbWriter::resume() {
+  QMutexLocker locker(&suspendMutex);
+  suspended = false;
+  suspendChanged.wakeAll();
+}
+
+bool DbWriter::isWriterThread() const {
+  return QThread::currentThread() == thread;
+}
+
+QSqlDatabase &DbWriter::database() {
+  Q_ASSERT(isWriterThread());
+  return db;
+}
+
+QSqlQuery DbWriter::execPrepared(const QString &sql,
+                                 const QVariantList &binds) {
+  Q_ASSERT(isWriterThread());
+  PLC_TRACE_SPAN(span, "sql.write");
+  PLC_TRACE_DETAIL(span, sql);
+
+  auto it = statements.find(sql);
+  if (it == statements.end()) {
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.prepare(sql)) {
+      qCritical() << "[DbWriter] Prepare failed:" << sql
+                  << "; Error:" << query.lastError().text();
+      return query;
+    }
+    it = statements.insert(sql, query);
+  } else {
+    it->finish();
+  }
+
+  QSqlQuery query = *it;
+  for (int i = 0; i < binds.size(); ++i)
+    query.bindValue(i, binds[i]);
+  if (!query.exec()) {
+    qCritical() << "[DbWriter] Query failed:" << sql << binds
+                << "; Error:" << query.lastError().text();
+  }
+  PLC_TRACE_ROWS(span, query.numRowsAffected());
+  return query;
+}
+
+bool DbWriter::openConnection() {
+  // QSqlDatabase handles belong to the thread that created them
+  const QString connectionName = "db_writer";
+  db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+  db.setDatabaseName(SQliteDB::getDbPath());
+  // Readers on other connections may hold the file for a moment
+  db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+  if (!db.open() || !SQliteDB::configureConnection(db, kCacheKiB)) {
+    qCritical() << "[DbWriter] Failed to open DB:" << db.lastError().text();
+    return false;
+  }
+  writerdebug << "started";
+  return true;
+}
+
+void DbWriter::closeConnection() {
+  // Prepared statements must go before their connection
+  statements.clear();
+  const QString connectionName = db.connectionName();
+  db.close();
+  db = QSqlDatabase();
+  QSqlDatabase::removeDatabase(connectionName);
+}
+
+void DbWriter::loop() {
+  connectionOpen = openConnection();
+
+  forever {
+    std::deque<Command> group;
+    {
+      QMutexLocker locker(&queueMutex);
+      while (queue.empty() && !stopping)
+        queueChanged.wait(&queueMutex);
+      if (queue.empty() && stopping)
+        break;
+
+      // 1. A burst of statements: wait briefly so they share one commit
+      QDeadlineTimer window(kGroupWindowMs);
+      while (!stopping && queuedJobs == 0 &&
+             int(queue.size()) < kMaxGroupSize && !window.hasExpired())
+        queueChanged.wait(&queueMutex, window);
+
+      // 2. Either one job, or the statements up to the next job
+      if (queue.front().job) {
+        queuedJobs--;
+        group.push_back(std::move(queue.front()));
+        queue.pop_front();
+      } else {
+        while (!queue.empty() && !queue.front().job &&
+               int(group.size()) < kMaxGroupSize) {
+          group.push_back(std::move(queue.front()));
+          queue.pop_front();
+        }
+      }
+    }
+
+    if (group.front().job) {
+      group.front().job();
+    } else if (connectionOpen) {
+      commitGroup(group);
+    } else {
+      for (Command &command : group) {
+        command.promise->addResult(
+            WriteResult{false, {}, 0, "database not open"});
+        command.promise->finish();
+      }
+    }
+  }
+
+  if (connectionOpen)
+    closeConnection();
+}
+
+void DbWriter::commitGroup(std::deque<Command> &group) {
+  QElapsedTimer timer;
+  timer.start();
+
+  // A failing statement only undoes itself in SQLite, the others in the
+  // group still commit. Only a failed COMMIT fails the whole group.
+  std::vector<WriteResult> results;
+  results.reserve(group.size());
+  const bool inTransaction = db.transaction();
+
+  for (const Command &command : group) {
+    WriteResult result;
+    QSqlQuery query = execPrepared(command.sql, command.binds);
+    result.ok = query.isActive();
+    if (result.ok) {
+      result.lastInsertId = query.lastInsertId();
+      result.rowsAffected = query.numRowsAffected();
+    } else {
+      result.error = query.lastError().text();
+    }
+    query.finish();
+    results.push_back(result);
+  }
+
+  if (inTransaction && !db.commit()) {
+    const QString error = db.lastError().text();
+    qCritical() << "[DbWriter] Commit failed:" << error;
+    db.rollback();
+    for (WriteResult &result : results)
+      result = WriteResult{false, {}, 0, error};
+  }
+
+  // 3. Resolve after the commit, so callers never read uncommitted state
+  for (size_t i = 0; i < group.size(); ++i) {
+    group[i].promise->addResult(results[i]);
+    group[i].promise->finish();
+  }
+
+  if (group.size() > 1)
+    writerdebug << group.size() << "statements committed in"
+                << timer.elapsed() << "ms";
+}
@@ -0,0 +1,209 @@
+#include "include/folderwatcher.h"
+#include "include/db_sqlite.h"
+#include "include/dbevents.h"
+#include "include/dbwriter.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+// Quiet period after the last event before the folders are rescanned
+constexpr int kQuietMs = 1500;
+// Upper bound while a long copy job keeps producing events
+constexpr int kMaxDelayMs = 10000;
+} // namespace
+
+FolderWatcher::FolderWatcher(QObject *parent) : QObject(parent) {
+  quietTimer.setSingleShot(true);
+  quietTimer.setInterval(kQuietMs);
+  maxDelayTimer.setSingleShot(true);
+  maxDelayTimer.setInterval(kMaxDelayMs);
+
+  connect(&fsWatcher, &QFileSystemWatcher::directoryChanged, this,
+          &FolderWatcher::onDirectoryChanged);
+  connect(&quietTimer, &QTimer::timeout, this, &FolderWatcher::flush);
+  connect(&maxDelayTimer, &QTimer::timeout, this, &FolderWatcher::flush);
+  connect(&planWatcher, &QFutureWatcher<RescanPlan>::finished, this,
+          &FolderWatcher::onPlanReady);
+  // The walk reads the old file; let it end before the writer is parked.
+  // onPlanReady() sees the new generation and rescans against the restore.
+  connect(DbEvents::instance(), &DbEvents::aboutToReplaceDatabase, this,
+          [this]() { planWatcher.waitForFinished(); });
+}
+
+void FolderWatcher::watch(int playlistId, const QString &rootPath) {
+  if (playlists.contains(playlistId))
+    return;
+
+  WatchedPlaylist &pl = playlists[playlistId];
+  pl.rootPath = rootPath;
+
+  // Watch every folder we already know about. A playlist imported before
+  // fingerprints existed only has its root; the first flush walks the tree
+  // once and registers the rest.
+  const QStringList known =
+      PlaylistRescanner::loadFingerprints(playlistId).keys();
+  if (known.isEmpty()) {
+    addDirs(pl, playlistId, {rootPath});
+    pl.pendingDirs.insert(rootPath);
+    quietTimer.start();
+  } else {
+    addDirs(pl, playlistId, known);
+  }
+  watchdebug << "watching playlist" << playlistId << "(" << pl.dirs.size()
+             << "folders )";
+}
+
+void FolderWatcher::unwatch(int playlistId) {
+  auto it = playlists.find(playlistId);
+  if (it == playlists.end())
+    return;
+  removeDirs(*it, QStringList(it->dirs.cbegin(), it->dirs.cend()));
+  playlists.erase(it);
+}
+
+bool FolderWatcher::isWatching(int playlistId) const {
+  return playlists.contains(playlistId);
+}
+
+QList<int> FolderWatcher::watchedPlaylists() const { return playlists.keys(); }
+
+void FolderWatcher::onDirectoryChanged(const QString &dir) {
+  const int playlistId = dirOwner.value(dir, -1);
+  auto it = playlists.find(playlistId);
+  if (it == playlists.end())
+    return;
+
+  it->pendingDirs.insert(dir);
+  quietTimer.start();
+  if (!maxDelayTimer.isActive())
+    maxDelayTimer.start();
+}
+
+void FolderWatcher::flush() {
+  // One rescan at a time (walk + write); onPlanReady() calls back in
+  if (flushingPlaylistId != -1)
+    return;
+
+  for (auto it = playlists.begin(); it != playlists.end(); ++it) {
+    if (it->pendingDirs.isEmpty())
+      continue;
+
+    quietTimer.stop();
+    maxDelayTimer.stop();
+
+    const QStringList dirs(it->pendingDirs.cbegin(), it->pendingDirs.cend());
+    it->pendingDirs.clear();
+    flushingPlaylistId = it.key();
+    flushingDirs = dirs;
+    flushingGeneration = SQliteDB::instance()->generation();
+
+    const QString rootPath = it->rootPath;
+    const int playlistId = it.key();
+
+    // Cache load and walk both on the worker (own read connection)
+    planWatcher.setFuture(QtConcurrent::run([playlistId, rootPath, dirs]() {
+      return PlaylistRescanner::plan(
+          rootPath, dirs, PlaylistRescanner::loadFingerprints(playlistId),
+          PlaylistRescanner::loadVideoPaths(playlistId, rootPath));
+    }));
+    return;
+  }
+}
+
+void FolderWatcher::onPlanReady() {
+  const int playlistId = flushingPlaylistId;
+  const RescanPlan plan = planWatcher.result();
+
+  if (isStale()) {
+    requeueFlushingDirs();
+    return;
+  }
+  if (!playlists.contains(playlistId) || plan.rootMissing) {
+    flushingPlaylistId = -1;
+    flush(); // events that arrived during the rescan
+    return;
+  }
+
+  DbWriter::instance()
+      ->run([playlistId, plan]() {
+        VideoDelta delta;
+        if (!PlaylistRescanner::apply(playlistId, plan, &delta))
+          delta.playlistId = -1;
+        return delta;
+      })
+      .then(this, [this, playlistId, plan](const VideoDelta &delta) {
+        // Committed just before a restore replaced it: ids are of the old
+        // data, sync the same folders again
+        if (isStale()) {
+          requeueFlushingDirs();
+          return;
+        }
+        flushingPlaylistId = -1;
+        auto it = playlists.find(playlistId); // may be unwatched meanwhile
+        if (delta.playlistId >= 0 && it != playlists.end()) {
+          QStringList newDirs;
+          for (const DirFingerprint &fp : plan.changedDirs)
+            newDirs.append(fp.dirPath);
+          addDirs(*it, playlistId, newDirs);
+          removeDirs(*it, plan.removedDirs);
+
+          watchdebug << "playlist" << playlistId << "synced: +"
+                     << delta.added.size() << "/ -" << delta.removedIds.size()
+                     << "/ ~" << delta.renamed.size();
+          if (!delta.isEmpty())
+            emit videosChanged(delta);
+        }
+
+        // Events that arrived during the rescan
+        flush();
+      });
+}
+
+bool FolderWatcher::isStale() const {
+  return flushingGeneration != SQliteDB::instance()->generation();
+}
+
+void FolderWatcher::requeueFlushingDirs() {
+  auto it = playlists.find(flushingPlaylistId);
+  if (it != playlists.end()) {
+    for (const QString &dir : std::as_const(flushingDirs))
+      it->pendingDirs.insert(dir);
+  }
+  flushingPlaylistId = -1;
+  flushingDirs.clear();
+  flush();
+}
+
+void FolderWatcher::addDirs(WatchedPlaylist &pl, int playlistId,
+                            const QStringList &dirs) {
+  QStringList fresh;
+  for (const QString &dir : dirs) {
+    if (!pl.dirs.contains(dir))
+      fresh.append(dir);
+  }
+  if (fresh.isEmpty())
+    return;
+
+  const QStringList failed = fsWatcher.addPaths(fresh);
+  if (!failed.isEmpty())
+    watchdebug << failed.size() << "folders could not be watched"
+               << "(inotify watch limit?)";
+  for (const QString &dir : std::as_const(fresh)) {
+    if (failed.contains(dir))
+      continue;
+    pl.dirs.insert(dir);
+    dirOwner.insert(dir, playlistId);
+  }
+}
+
+void FolderWatcher::removeDirs(WatchedPlaylist &pl, const QStringList &dirs) {
+  QStringList watched;
+  for (const QString &dir : dirs) {
+    if (pl.dirs.remove(dir)) {
+      watched.append(dir);
+      dirOwner.remove(dir);
+    }
+  }
+  if (!watched.isEmpty())
+    fsWatcher.removePaths(watched);
+}
@@ -0,0 +1,480 @@
+#include "include/headlesscli.h"
+#include "include/backupstore.h"
+#include "include/db_sqlite.h"
+#include "include/dbwriter.h"
+#include "include/playlistrescanner.h"
+#include "include/videoingest.h"
+#include "include/videoscanner.h"
+#include "include/watchhistory.h"
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QPair>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+const QStringList &commands() {
+  static const QStringList names = {"import", "rescan", "backup", "stats",
+                                    "vacuum"};
+  return names;
+}
+
+struct ImportResult {
+  int playlistId = -1;
+  IngestStats stats;
+};
+
+struct TimedPlan {
+  RescanPlan plan;
+  qint64 elapsedMs = 0;
+};
+
+struct RescanWrite {
+  bool ok = false;
+  VideoDelta delta;
+  qint64 elapsedMs = 0;
+};
+
+struct VacuumStep {
+  QString name;
+  bool ok = false;
+  qint64 elapsedMs = 0;
+  QString error;
+};
+
+} // namespace
+
+bool HeadlessCli::wants(int argc, char *argv[]) {
+  return argc > 1 && commands().contains(QString::fromLocal8Bit(argv[1]));
+}
+
+HeadlessCli::HeadlessCli(QObject *parent) : QObject(parent) {}
+
+int HeadlessCli::run(const QStringList &arguments) {
+  // 1. Arguments; --help and unknown options end the process here
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Playlist Companion without a window: bulk import and maintenance.\n"
+      "Prints one JSON object per line.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("command", commands().join(", "));
+  parser.addPositionalArgument(
+      "args", "import: folders; rescan: playlist ids", "[args...]");
+  const QCommandLineOption allOption("all", "rescan: every playlist");
+  const QCommandLineOption watchOption(
+      "watch", "import: keep the new playlists in sync with their folders");
+  const QCommandLineOption jobsOption(
+      {"j", "jobs"}, "Folders / playlists processed at once.", "n",
+      QString::number(QThread::idealThreadCount()));
+  const QCommandLineOption verboseOption("verbose", "Debug output on stderr");
+  parser.addOptions({allOption, watchOption, jobsOption, verboseOption});
+  parser.process(arguments);
+
+  const QStringList positional = parser.positionalArguments();
+  const QString command = positional.value(0);
+  const QStringList args = positional.mid(1);
+  const bool all = parser.isSet(allOption);
+  bool jobsOk = false;
+  jobs = parser.value(jobsOption).toInt(&jobsOk);
+  if (!jobsOk || jobs < 1 || (command == "import" && args.isEmpty()) ||
+      (command == "rescan" && args.isEmpty() != all))
+    parser.showHelp(2); // rescan takes either --all or ids
+
+  // stdout is for the records; stderr only gets warnings and errors
+  if (!parser.isSet(verboseOption))
+    QLoggingCategory::setFilterRules("*.debug=false");
+
+  // 2. Open (and migrate) the same file the GUI uses
+  if (!SQliteDB::instance()->isOpen()) {
+    qCritical() << "[HeadlessCli] Could not open" << SQliteDB::getDbPath();
+    return 2;
+  }
+
+  // 3. The command, then its summary once every write is committed
+  QElapsedTimer timer;
+  timer.start();
+  QJsonObject summary;
+  if (command == "import")
+    summary = importFolders(args, parser.isSet(watchOption));
+  else if (command == "rescan")
+    summary = rescan(args, all);
+  else if (command == "backup")
+    summary = backup();
+  else if (command == "stats")
+    summary = stats();
+  else
+    summary = vacuum();
+  DbWriter::instance()->flush();
+
+  summary["command"] = command;
+  summary["summary"] = true;
+  summary["jobs"] = jobs;
+  summary["elapsedMs"] = timer.elapsed();
+  print(summary);
+  return summary.value("failed").toInt() > 0 ? 1 : 0;
+}
+
+QJsonObject HeadlessCli::importFolders(const QStringList &dirs,
+                                       bool watchFolder) {
+  int failed = 0;
+  int skipped = 0;
+  int imported = 0;
+  qint64 videos = 0;
+
+  // 1. Missing folders and folders that already are a playlist are
+  // reported, not imported (rescan those)
+  QStringList queue;
+  for (const QString &dir : dirs) {
+    const QString path = QDir::cleanPath(QFileInfo(dir).absoluteFilePath());
+    QJsonObject record{{"command", "import"}, {"path", path}};
+    if (!QFileInfo(path).isDir()) {
+      record["status"] = "missing";
+      print(record);
+      ++failed;
+      continue;
+    }
+    QSqlQuery known = SQliteDB::instance()->execRead(
+        "SELECT playlistId FROM Playlist WHERE playlistPath = ?", {path});
+    if (known.next()) {
+      record["status"] = "exists";
+      record["playlistId"] = known.value(0).toInt();
+      print(record);
+      ++skipped;
+      continue;
+    }
+    if (!queue.contains(path))
+      queue.append(path);
+  }
+
+  // 2. Up to `jobs` folders are walked at once (each on its own scanner
+  // pool); a finished one is written on the DbWriter while the next walks
+  int scanning = 0;
+  int writing = 0;
+  QEventLoop loop;
+  std::function<void()> startScans = [&]() {
+    while (scanning < jobs && !queue.isEmpty()) {
+      const QString path = queue.takeFirst();
+      auto *scanner = new VideoScanner(this);
+      QElapsedTimer scanTimer;
+      scanTimer.start();
+      ++scanning;
+
+      connect(scanner, &VideoScanner::finished, this,
+              [&, scanner, path, scanTimer](const VideoCollection &vdos) {
+                const qint64 scanMs = scanTimer.elapsed();
+                scanner->deleteLater();
+                --scanning;
+                ++writing;
+                startScans();
+
+                Playlist pl{};
+                pl.playlistTitle = QDir(path).dirName();
+                if (pl.playlistTitle.isEmpty())
+                  pl.playlistTitle = path; // a drive root
+                pl.playlistPath = path;
+                pl.status = "Planned to Watch";
+                pl.watchFolder = watchFolder ? 1 : 0;
+
+                DbWriter::instance()
+                    ->run([pl, vdos]() {
+                      ImportResult result;
+                      result.playlistId =
+                          VideoIngest::createPlaylist(pl, vdos, &result.stats);
+                      return result;
+                    })
+                    .then(this, [&, path, scanMs,
+                                 found = vdos.count](const ImportResult &r) {
+                      const bool ok = r.playlistId > 0 && r.stats.ok;
+                      print({{"command", "import"},
+                             {"path", path},
+                             {"status", ok ? "imported" : "failed"},
+                             {"playlistId", r.playlistId},
+                             {"videos", found},
+                             {"rows", r.stats.rows},
+                             {"scanMs", scanMs},
+                             {"ingestMs", r.stats.elapsedMs},
+                             {"rowsPerSecond", qRound(r.stats.rowsPerSecond)}});
+                      if (ok) {
+                        ++imported;
+                        videos += r.stats.rows;
+                      } else {
+                        ++failed;
+                      }
+                      if (--writing == 0 && scanning == 0 && queue.isEmpty())
+                        loop.quit();
+                    });
+              });
+      scanner->start(path);
+    }
+  };
+  startScans();
+  if (scanning > 0)
+    loop.exec();
+
+  return {{"imported", imported},
+          {"skipped", skipped},
+          {"failed", failed},
+          {"videos", videos}};
+}
+
+QJsonObject HeadlessCli::rescan(const QStringList &ids, bool all) {
+  int failed = 0;
+
+  // 1. Which playlists
+  QSet<int> wanted;
+  for (const QString &id : ids) {
+    bool ok = false;
+    const int playlistId = id.toInt(&ok);
+    if (ok && playlistId > 0) {
+      wanted.insert(playlistId);
+    } else {
+      print({{"command", "rescan"}, {"id", id}, {"status", "invalid"}});
+      ++failed;
+    }
+  }
+  QVector<QPair<int, QString>> targets;
+  QSqlQuery query = SQliteDB::instance()->execRead(
+      "SELECT playlistId, playlistPath FROM Playlist ORDER BY playlistId");
+  while (query.next()) {
+    const int playlistId = query.value(0).toInt();
+    if (all || wanted.remove(playlistId))
+      targets.append({playlistId, query.value(1).toString()});
+  }
+  for (int playlistId : std::as_const(wanted)) {
+    print({{"command", "rescan"},
+           {"playlistId", playlistId},
+           {"status", "unknown"}});
+    ++failed;
+  }
+
+  // 2. Plans on `jobs` threads, each with its own read connection
+  QThreadPool pool;
+  pool.setMaxThreadCount(jobs);
+  QVector<QFuture<TimedPlan>> plans;
+  for (const auto &target : std::as_const(targets)) {
+    plans.append(QtConcurrent::run(&pool, [target]() {
+      QElapsedTimer planTimer;
+      planTimer.start();
+      TimedPlan timed;
+      timed.plan = PlaylistRescanner::plan(
+          target.second, {}, PlaylistRescanner::loadFingerprints(target.first),
+          PlaylistRescanner::loadVideoPaths(target.first, target.second));
+      timed.elapsedMs = planTimer.elapsed();
+      return timed;
+    }));
+  }
+
+  // 3. Each plan is queued for writing as soon as it is ready, while the
+  // later ones are still walking; then the results, in playlist order
+  QVector<TimedPlan> planned;
+  QVector<QFuture<RescanWrite>> writes;
+  for (qsizetype i = 0; i < targets.size(); ++i) {
+    planned.append(plans[i].result());
+    const int playlistId = targets[i].first;
+    const RescanPlan plan = planned.last().plan;
+    if (plan.rootMissing) {
+      writes.append(QFuture<RescanWrite>());
+      continue;
+    }
+    writes.append(DbWriter::instance()->run([playlistId, plan]() {
+      QElapsedTimer writeTimer;
+      writeTimer.start();
+      RescanWrite write;
+      write.ok = PlaylistRescanner::apply(playlistId, plan, &write.delta);
+      write.elapsedMs = writeTimer.elapsed();
+      return write;
+    }));
+  }
+
+  int added = 0;
+  int removed = 0;
+  for (qsizetype i = 0; i < targets.size(); ++i) {
+    const RescanPlan &plan = planned[i].plan;
+    QJsonObject record{{"command", "rescan"},
+                       {"playlistId", targets[i].first},
+                       {"path", targets[i].second},
+                       {"statCount", plan.statCount},
+                       {"listedDirs", plan.listedDirs},
+                       {"planMs", planned[i].elapsedMs}};
+    if (plan.rootMissing) {
+      record["status"] = "unreachable";
+      ++failed;
+    } else {
+      const RescanWrite write = writes[i].result();
+      record["status"] = write.ok ? "ok" : "failed";
+      record["added"] = int(write.delta.added.size());
+      record["removed"] = int(write.delta.removedIds.size());
+      record["renamed"] = int(write.delta.renamed.size());
+      record["writeMs"] = write.elapsedMs;
+      if (write.ok) {
+        added += int(write.delta.added.size());
+        removed += int(write.delta.removedIds.size());
+      } else {
+        ++failed;
+      }
+    }
+    print(record);
+  }
+
+  return {{"playlists", int(targets.size())},
+          {"added", added},
+          {"removed", removed},
+          {"failed", failed}};
+}
+
+QJsonObject HeadlessCli::backup() {
+  QElapsedTimer timer;
+  timer.start();
+  SnapshotInfo info;
+  QString error;
+  const bool ok = BackupStore::snapshot(SQliteDB::getDbPath(), &info, &error);
+  const qint64 snapshotMs = timer.restart();
+  const int pruned = ok ? BackupStore::prune(BackupStore::loadPolicy()) : 0;
+
+  print({{"command", "backup"},
+         {"status", ok ? "ok" : "failed"},
+         {"error", error},
+         {"snapshot", info.id},
+         {"bytes", info.size},
+         {"chunks", info.chunkCount},
+         {"newChunks", info.newChunks},
+         {"storedBytes", info.storedBytes},
+         {"unchanged", info.unchanged},
+         {"snapshotMs", snapshotMs},
+         {"pruned", pruned},
+         {"pruneMs", timer.elapsed()}});
+  return {{"failed", ok ? 0 : 1}};
+}
+
+QJsonObject HeadlessCli::stats() {
+  QElapsedTimer timer;
+  timer.start();
+
+  // 1. Library: the trigger-maintained counters of the Playlist rows
+  QSqlQuery library = SQliteDB::instance()->execRead(
+      "SELECT COUNT(*), IFNULL(SUM(totalVideoCount), 0), "
+      "IFNULL(SUM(watchedCount), 0), IFNULL(SUM(totalDurationMs), 0) "
+      "FROM Playlist");
+  QJsonObject record{{"command", "stats"}};
+  if (library.next()) {
+    record["playlists"] = library.value(0).toInt();
+    record["videos"] = library.value(1).toLongLong();
+    record["watched"] = library.value(2).toLongLong();
+    record["durationMs"] = library.value(3).toLongLong();
+  }
+  library.finish();
+  record["databaseBytes"] = databaseBytes();
+
+  // 2. Watch history, from its rollups
+  const WatchStats watch = WatchHistory::load();
+  QJsonArray days;
+  for (const WatchPeriod &day : watch.days)
+    days.append(QJsonObject{{"day", day.start.toString(Qt::ISODate)},
+                            {"seconds", day.secondsWatched},
+                            {"finished", day.videosFinished},
+                            {"sessions", day.sessions}});
+  QJsonArray weeks;
+  for (const WatchPeriod &week : watch.weeks)
+    weeks.append(QJsonObject{{"week", week.start.toString(Qt::ISODate)},
+                             {"seconds", week.secondsWatched},
+                             {"finished", week.videosFinished},
+                             {"sessions", week.sessions}});
+  QJsonArray playlists;
+  for (const PlaylistWatchTotal &total : watch.playlists)
+    playlists.append(QJsonObject{{"playlistId", total.playlistId},
+                                 {"title", total.playlistTitle},
+                                 {"seconds", total.secondsWatched},
+                                 {"finished", total.videosFinished},
+                                 {"sessions", total.sessions}});
+  record["days"] = days;
+  record["weeks"] = weeks;
+  record["watchedPlaylists"] = playlists;
+  record["currentStreak"] = watch.currentStreak;
+  record["longestStreak"] = watch.longestStreak;
+  record["queryMs"] = timer.elapsed();
+  print(record);
+  return {{"failed", 0}};
+}
+
+QJsonObject HeadlessCli::vacuum() {
+  const qint64 bytesBefore = databaseBytes();
+
+  // On the writer connection, after everything queued: VACUUM can not run
+  // inside a transaction and must be the only writer
+  const QVector<VacuumStep> steps =
+      DbWriter::instance()
+          ->run([]() {
+            const QVector<QPair<QString, QStringList>> plan = {
+                {"checkpoint", {"PRAGMA wal_checkpoint(TRUNCATE)"}},
+                // One segment per FTS5 index instead of one per merge level
+                {"fts-optimize",
+                 {"INSERT INTO VideoSearch(VideoSearch) VALUES ('optimize')",
+                  "INSERT INTO NoteSearch(NoteSearch) VALUES ('optimize')"}},
+                {"vacuum", {"VACUUM"}},
+                {"optimize", {"PRAGMA optimize"}},
+                {"checkpoint", {"PRAGMA wal_checkpoint(TRUNCATE)"}},
+            };
+            QVector<VacuumStep> done;
+            for (const auto &[name, statements] : plan) {
+              VacuumStep step;
+              step.name = name;
+              step.ok = true;
+              QElapsedTimer stepTimer;
+              stepTimer.start();
+              for (const QString &sql : statements) {
+                QSqlQuery query(DbWriter::instance()->database());
+                if (!query.exec(sql)) {
+                  step.ok = false;
+                  step.error = query.lastError().text();
+                  break;
+                }
+              }
+              step.elapsedMs = stepTimer.elapsed();
+              done.append(step);
+            }
+            return done;
+          })
+          .result();
+
+  int failed = 0;
+  for (const VacuumStep &step : steps) {
+    QJsonObject record{{"command", "vacuum"},
+                       {"step", step.name},
+                       {"status", step.ok ? "ok" : "failed"},
+                       {"ms", step.elapsedMs}};
+    if (!step.ok) {
+      record["error"] = step.error;
+      ++failed;
+    }
+    print(record);
+  }
+  return {{"failed", failed},
+          {"bytesBefore", bytesBefore},
+          {"bytesAfter", databaseBytes()}};
+}
+
+void HeadlessCli::print(const QJsonObject &record) {
+  // JSON Lines, flushed so a pipe sees each record as it happens
+  const QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+  std::fwrite(line.constData(), 1, size_t(line.size()), stdout);
+  std::fputc('\n', stdout);
+  std::fflush(stdout);
+}
+
+qint64 HeadlessCli::databaseBytes() {
+  const QString path = SQliteDB::getDbPath();
+  return QFileInfo(path).size() + QFileInfo(path + "-wal").size();
+}
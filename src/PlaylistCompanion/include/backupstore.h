@@ -0,0 +1,124 @@
+#ifndef BACKUPSTORE_H
+#define BACKUPSTORE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDebug>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QRecursiveMutex>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+#define storedebug qDebug() << "[BackupStore] "
+
+// How many snapshots prune() keeps. The newest keepLast always stay; on top
+// of that the newest snapshot of each of the last keepHourly hours,
+// keepDaily days and keepWeekly weeks (grandfather-father-son).
+struct RetentionPolicy {
+  int keepLast = 5;
+  int keepHourly = 24;
+  int keepDaily = 7;
+  int keepWeekly = 8;
+  int autoBackupHours = 1; // 0 = no automatic snapshots
+};
+
+// One manifest of the store
+struct SnapshotInfo {
+  QString id; // manifest file name without ".json"
+  QDateTime created;
+  int schemaVersion = 0; // PRAGMA user_version of the copy
+  qint64 size = 0;       // bytes of the database file
+  int chunkCount = 0;
+  int newChunks = 0;       // chunks this snapshot had to store
+  qint64 storedBytes = 0;  // compressed bytes of those chunks
+  bool unchanged = false;  // same content as the newest one, not written
+};
+
+// Snapshot store under <db dir>/backups/. A snapshot is a verified online
+// copy (DbBackup::copy) cut into fixed 64 KiB chunks. Chunks are stored
+// once, named by their SHA-256 and compressed (zstd, zlib without it);
+// a JSON manifest per snapshot lists them in order. Pages that did not
+// change since the last snapshot cost nothing, so frequent snapshots only
+// grow the store by what was written in between.
+//
+//   backups/manifests/<id>.json
+//   backups/chunks/<2 hex>/<sha256>.zst
+//
+// The static functions block and may run on any thread. All but
+// listSnapshots() serialise on one mutex, so pruning never deletes a chunk
+// a snapshot is still writing.
+class BackupStore : public QObject {
+  Q_OBJECT
+
+public:
+  // GUI-thread singleton; owns the automatic backup timer
+  static BackupStore *instance();
+  // Wait for a running snapshot; call on exit, before DbWriter::shutdown()
+  static void shutdown();
+
+  static QString storePath();
+
+  // Snapshot of the database file srcPath (a live database is fine).
+  // progress(copiedPages, totalPages) comes from the copy step.
+  static bool snapshot(const QString &srcPath, SnapshotInfo *info,
+                       QString *error = nullptr,
+                       const std::function<void(int, int)> &progress = {},
+                       const QDateTime &created = QDateTime::currentDateTime());
+  // Newest first
+  static QVector<SnapshotInfo> listSnapshots();
+  // Reassemble snapshot id into destPath; every chunk is hash-checked and
+  // the result has to pass integrity_check
+  static bool rebuild(const QString &id, const QString &destPath,
+                      QString *error = nullptr);
+  // Drop manifests outside the policy, then chunks no manifest uses.
+  // Returns the number of snapshots removed.
+  static int prune(const RetentionPolicy &policy);
+  // backup_<timestamp>.sqlite files of older versions become snapshots
+  static int importLegacyBackups();
+
+  static RetentionPolicy loadPolicy(); // General row, defaults if missing
+
+  // Snapshot + prune on a worker. false if one is running.
+  bool start();
+  bool isRunning() const;
+  // Hourly (or every `hours`) start(); 0 stops the timer
+  void setAutoBackupInterval(int hours);
+
+signals:
+  void progress(int copiedPages, int totalPages);
+  void finished(bool ok, const SnapshotInfo &info, const QString &error);
+
+private:
+  explicit BackupStore(QObject *parent = nullptr);
+  ~BackupStore();
+
+  struct JobResult {
+    bool ok = false;
+    SnapshotInfo info;
+    QString error;
+  };
+
+  static BackupStore *storeInstance;
+  static QRecursiveMutex storeMutex; // the statics call each other
+  static constexpr int kChunkSize = 64 * 1024; // >= any SQLite page size
+  static constexpr int kZstdLevel = 3;
+
+  QFutureWatcher<JobResult> watcher;
+  QTimer autoTimer;
+  int autoBackupHours = 0;
+
+  void onJobDone();
+  static QString chunkPath(const QString &hash, const QString &codec);
+  static QByteArray compress(const QByteArray &raw, const QString &codec);
+  static QByteArray decompress(const QByteArray &packed, const QString &codec,
+                               bool *ok);
+  static bool readManifest(const QString &id, SnapshotInfo *info,
+                           QStringList *chunks, QString *codec,
+                           QByteArray *fileHash);
+};
+
+#endif // BACKUPSTORE_H
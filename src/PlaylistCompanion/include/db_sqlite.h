@@ -6,20 +6,33 @@
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
+#include <QList>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QProcess>
 #include <QString>
+#include <QThread>
 #include <QVariant>
+#include <QVector>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
+#include <atomic>
+#include <functional>
 
 #define dbdebug qDebug() << "[sqLiteDB] "
 
 class SQliteDB {
 
 public:
+  // Hit / miss counters of one cached statement (kept after eviction)
+  struct StatementStats {
+    QString sql;
+    quint64 hits = 0;
+    quint64 misses = 0;
+  };
+
   static SQliteDB *dbInstance;
   static QString getAppPath();
   static QString getAppDirPath();
@@ -29,16 +42,58 @@ public:
   // Get the singleton instance
   static SQliteDB *instance();
 
+  // Called before each pending migration step, on the migrating thread
+  using MigrationProgress =
+      std::function<void(int version, const QString &description)>;
+  // Open the file on the calling thread with a connection of its own, run
+  // the pending migrations, check the query plans (debug builds) and close
+  // it again. For a worker before the first instance(): the main
+  // connection then opens an up-to-date file and migrate() has nothing to
+  // do. false if the file can not be opened or a migration failed.
+  static bool upgradeDatabase(const MigrationProgress &progress = {});
+
   // Delete copy and assignment
   SQliteDB(const SQliteDB &) = delete;
   SQliteDB &operator=(const SQliteDB &) = delete;
 
-  // Open the database
+  // Schema version this build migrates to (PRAGMA user_version)
+  static constexpr int kSchemaVersion = 13;
+  static int schemaVersion(QSqlDatabase &connection);
+
+  // Open the database, then migrate it to kSchemaVersion
   bool openDB(const QString &dbPath);
 
+  // EXPLAIN QUERY PLAN of every hot query; false if one of them scans a
+  // whole table instead of using an index. Logged by upgradeDatabase() in
+  // debug builds; the queryPlans benchmark fails on it.
+  bool checkQueryPlans();
+
   // Execute a query and return QSqlQuery object
   QSqlQuery execQuery(const QString &queryStr);
 
+  // Per-connection tuning shared by every connection (main, writer, reads).
+  // journal_mode=WAL is persistent in the file and set once by openDB().
+  static bool configureConnection(QSqlDatabase &connection, int cacheKiB);
+
+  // Read-only connection of the calling thread, opened on first use and
+  // closed when the thread exits. WAL lets these read while DbWriter
+  // commits. On the thread that opened the DB this is the main connection.
+  QSqlDatabase readDatabase();
+
+  // execPrepared() on readDatabase(), with a statement cache per thread.
+  // Safe from any thread; same rules for reading the result.
+  QSqlQuery execRead(const QString &sql, const QVariantList &binds = {});
+
+  // Execute a statement with positional '?' parameters. The prepared
+  // statement is kept in an LRU cache keyed by the SQL text, so hot queries
+  // are compiled once per connection. The returned query shares its result
+  // with the cache: read it before running the same SQL again, and call
+  // finish() when you stop reading early.
+  QSqlQuery execPrepared(const QString &sql, const QVariantList &binds = {});
+
+  QVector<StatementStats> statementStats() const;
+  void logStatementStats() const;
+
   // Check if DB is open
   bool isOpen() const;
 
@@ -48,21 +103,74 @@ public:
   // Get raw QSqlDatabase for advanced operations
   QSqlDatabase &database();
 
+  // Blocking snapshot into the backup store; its id, empty on failure
   QString backupDBfile();
 
-  void restoreDBfile(QString targetFilePath);
+  // Hot restore, no restart: stage a copy of sourcePath next to the live
+  // file, check its schema, snapshot the current data, stop background
+  // work (DbEvents::aboutToReplaceDatabase()), park the writer, copy the
+  // staged pages into the live file with the backup API and migrate them.
+  // Emits DbEvents::databaseReplaced() so everything that cached rows
+  // reloads. GUI thread only; the old data stays in place on failure.
+  bool restoreDBfile(const QString &sourcePath, QString *error = nullptr);
+  // Same for a snapshot of the backup store
+  bool restoreSnapshot(const QString &snapshotId, QString *error = nullptr);
+  // A restore refused while the file is open (the Qt driver runs its own
+  // SQLite, see DbBackup::sameLibrary) waits next to the live file and is
+  // swapped in by the next start, before the first connection opens
+  static bool hasPendingRestore();
+  // Bumped by every restore; work that started on an older generation
+  // must not write its results
+  int generation() const;
 
 private:
   SQliteDB();
   ~SQliteDB();
 
   QSqlDatabase db;
+  QString connectionName = "db_connection";
+  QThread *mainThread = nullptr; // thread that owns db
+  MigrationProgress migrationProgress;
+  std::atomic_int readConnectionCount{0};
+  std::atomic_int fileGeneration{0};
   static QString appPath;
   static QString appDirPath;
   static QString dbPath;
   static QString dbDirPath;
+  static void initPaths(); // next to the executable, once
+
+  static constexpr int kStatementCacheSize = 32;
+  QHash<QString, QSqlQuery> statementCache;
+  QList<QString> statementLru; // front = most recently used
+  QHash<QString, StatementStats> statementCounters;
+  QSqlQuery cachedStatement(const QString &sql);
+  void clearStatementCache();
 
   bool copyFile(QString src, QString dest);
+  bool checkStagedFile(const QString &stagedPath, QString *error);
+  bool swapInDBfile(const QString &stagedPath, QString *error);
+  bool deferSwap(const QString &stagedPath, const QString &why,
+                 QString *error);
+  static QString pendingRestorePath();
+  static void applyPendingRestore();
+  // --- Migrations (db_migrations.cpp), one transaction per version ---
+  bool migrate();
+  bool execAll(const QStringList &statements);
+  bool migrateBaseTables();      // 1
+  bool migrateFolderCache();     // 2
+  bool migrateVideoColumns();    // 3
+  bool migrateCounterTriggers(); // 4
+  bool migrateIndexes();         // 5
+  bool migrateBackupSettings();  // 6
+  bool migrateVideoMetadata();   // 7
+  bool migrateSortKeys();        // 8
+  bool migrateSearchIndex();     // 9
+  bool migrateWatchHistory();    // 10
+  bool migratePlayerCache();     // 11
+  bool migrateRelativePaths();   // 12
+  bool migrateFileIdentity();    // 13
+  bool addColumnIfMissing(const QString &table, const QString &column,
+                          const QString &definition);
   QMutex queryMutex;
 };
 
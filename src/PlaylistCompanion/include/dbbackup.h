@@ -0,0 +1,67 @@
+#ifndef DBBACKUP_H
+#define DBBACKUP_H
+
+#include <QDebug>
+#include <QSqlDatabase>
+#include <QString>
+#include <atomic>
+#include <functional>
+
+#define backupdebug qDebug() << "[DbBackup] "
+
+struct BackupResult {
+  bool ok = false;
+  QString path; // final backup file, only set when ok
+  QString error;
+  int pages = 0;
+  qint64 elapsedMs = 0;
+};
+
+// Online backup of the live database through the SQLite backup API
+// (sqlite3_backup_step), not a file copy. Pages are copied in small batches
+// from a read snapshot, so DbWriter keeps committing while it runs. The
+// copy is written next to the target as "<dest>.part", checked with PRAGMA
+// integrity_check and only then renamed into place. Runs on the caller's
+// thread; BackupStore puts it on a worker.
+class DbBackup {
+
+public:
+  // Blocking copy, safe on any thread. progress(copiedPages, totalPages) is
+  // called after every batch, on the calling thread.
+  static BackupResult copy(
+      const QString &srcPath, const QString &destPath,
+      const std::function<void(int, int)> &progress = {},
+      const std::atomic_bool *cancelFlag = nullptr);
+
+  // PRAGMA integrity_check on a closed database file
+  static bool verify(const QString &path, QString *error = nullptr);
+
+  // The other direction: copy every page of srcPath into the open database
+  // dest, in one write transaction, the way a hot restore needs it. The
+  // file under dest stays the same, so other connections to it stay valid
+  // and read the new pages after their next transaction. Blocks while
+  // another connection writes; stop writers first. Refused unless
+  // sameLibrary(dest).
+  static bool restoreInto(const QString &srcPath, QSqlDatabase &dest,
+                          QString *error = nullptr);
+
+  // Whether the Qt driver of connection runs the SQLite library this file
+  // is linked against (same sqlite_source_id()). Qt builds with a bundled
+  // SQLite (official installers, Windows) do not: their handles must not
+  // go to the C API here.
+  static bool sameLibrary(QSqlDatabase &connection, QString *error = nullptr);
+  // sameLibrary() on the app's connection, run by SQliteDB::openDB(). After
+  // a mismatch copy() refuses the live database file: a second SQLite in
+  // one process does not see the other's POSIX locks and can corrupt it.
+  static void checkDriver(QSqlDatabase &connection);
+
+private:
+  static constexpr int kPagesPerStep = 64; // 256 KiB at 4 KiB pages
+  static constexpr int kYieldMs = 2;       // let the writer in between
+  static constexpr int kBusyRetryMs = 50;
+  static constexpr int kMaxRestarts = 3;
+  static constexpr int kMaxBusyRetries = 100; // 5 s, like the busy timeout
+  static std::atomic_bool driverMismatch;
+};
+
+#endif // DBBACKUP_H
@@ -0,0 +1,29 @@
+#ifndef DBEVENTS_H
+#define DBEVENTS_H
+
+#include <QObject>
+
+// Database-wide notifications for everything that caches what it read
+// (MainWindow's playlists, table models, ...). Lives on the GUI thread.
+class DbEvents : public QObject {
+  Q_OBJECT
+
+public:
+  static DbEvents *instance();
+
+signals:
+  // A hot restore is about to overwrite the database, emitted on the GUI
+  // thread before the writer is parked. Stop background work that reads
+  // or writes it and wait for it here; results that arrive later belong to
+  // the old data (see SQliteDB::generation()).
+  void aboutToReplaceDatabase();
+  // The database now holds the restored data (hot restore). Every row, id
+  // and count read before is stale; reload from SQLite.
+  void databaseReplaced();
+
+private:
+  explicit DbEvents(QObject *parent = nullptr);
+  static DbEvents *eventsInstance;
+};
+
+#endif // DBEVENTS_H
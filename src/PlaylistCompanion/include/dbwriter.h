@@ -0,0 +1,121 @@
+#ifndef DBWRITER_H
+#define DBWRITER_H
+
+#include <QDebug>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QPromise>
+#include <QString>
+#include <QThread>
+#include <QVariant>
+#include <QWaitCondition>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+#define writerdebug qDebug() << "[DbWriter] "
+
+// Outcome of one queued statement, available once its group is committed
+struct WriteResult {
+  bool ok = false;
+  QVariant lastInsertId;
+  int rowsAffected = 0;
+  QString error;
+};
+
+// Owner of all writes. One thread with its own connection works through a
+// FIFO queue, so fsync latency never blocks the GUI thread:
+//  - enqueue(sql, binds): statements queued close together are committed in
+//    one transaction; the future resolves after that commit.
+//  - run(job): a function executed alone on the writer thread (after the
+//    statements before it are committed). It may open its own transactions
+//    through database() / execPrepared().
+// Because the queue is FIFO, a resolved future means every write queued
+// before it is committed as well, so reading after it is safe.
+class DbWriter {
+
+public:
+  static DbWriter *instance();
+  // Flush and stop the thread (no-op if it never started). Call on exit.
+  static void shutdown();
+
+  DbWriter(const DbWriter &) = delete;
+  DbWriter &operator=(const DbWriter &) = delete;
+
+  QFuture<WriteResult> enqueue(const QString &sql,
+                               const QVariantList &binds = {});
+
+  template <typename Job>
+  QFuture<std::invoke_result_t<Job>> run(Job job) {
+    using T = std::invoke_result_t<Job>;
+    static_assert(!std::is_void_v<T>, "writer jobs must return a value");
+    auto promise = std::make_shared<QPromise<T>>();
+    QFuture<T> future = promise->future();
+    promise->start();
+    post(Command{{}, {}, {}, [promise, job]() mutable {
+                   promise->addResult(job());
+                   promise->finish();
+                 }});
+    return future;
+  }
+
+  // Blocks until everything queued so far is committed
+  void flush();
+
+  // Commit what is queued, close the connection and park the thread until
+  // resume(). Writes queued meanwhile wait and commit on resume(). Used
+  // while a hot restore copies into the file; anything that waits on a
+  // write must be stopped before (DbEvents::aboutToReplaceDatabase()).
+  void suspend();
+  void resume();
+
+  // --- Only from jobs running on the writer thread ---
+  QSqlDatabase &database();
+  // Same contract as SQliteDB::execPrepared, on the writer connection
+  QSqlQuery execPrepared(const QString &sql, const QVariantList &binds = {});
+  bool isWriterThread() const;
+
+private:
+  DbWriter();
+  ~DbWriter();
+
+  struct Command {
+    QString sql;
+    QVariantList binds;
+    std::shared_ptr<QPromise<WriteResult>> promise;
+    std::function<void()> job; // set for run(), empty for statements
+  };
+
+  static DbWriter *writerInstance;
+  static constexpr int kMaxGroupSize = 256;
+  static constexpr int kGroupWindowMs = 5; // gather a burst of writes
+  static constexpr int kCacheKiB = 8 * 1024;
+
+  QThread *thread = nullptr;
+  QSqlDatabase db;
+  bool connectionOpen = false; // writer thread only
+  QHash<QString, QSqlQuery> statements; // writer thread only
+
+  QMutex queueMutex;
+  QWaitCondition queueChanged;
+  std::deque<Command> queue; // guarded by queueMutex
+  int queuedJobs = 0;        // guarded by queueMutex
+  bool stopping = false;     // guarded by queueMutex
+
+  QMutex suspendMutex;
+  QWaitCondition suspendChanged;
+  bool suspended = false; // guarded by suspendMutex
+  bool parked = false;    // guarded by suspendMutex
+
+  void post(Command command);
+  void loop(); // writer thread
+  bool openConnection();
+  void closeConnection();
+  void commitGroup(std::deque<Command> &group);
+};
+
+#endif // DBWRITER_H
@@ -0,0 +1,61 @@
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <include/playlistrescanner.h>
+#include <include/structures.h>
+
+#define watchdebug qDebug() << "[FolderWatcher] "
+
+// Keeps the Video rows of opted-in playlists in sync with their folders.
+// Every known folder is watched (inotify on Linux via QFileSystemWatcher).
+// Change events are debounced, so a big copy job turns into one rescan of
+// the touched folders and one transaction instead of thousands of writes.
+class FolderWatcher : public QObject {
+  Q_OBJECT
+
+public:
+  explicit FolderWatcher(QObject *parent = nullptr);
+
+  void watch(int playlistId, const QString &rootPath);
+  void unwatch(int playlistId);
+  bool isWatching(int playlistId) const;
+  QList<int> watchedPlaylists() const;
+
+signals:
+  void videosChanged(const VideoDelta &delta);
+
+private:
+  struct WatchedPlaylist {
+    QString rootPath;
+    QSet<QString> dirs;        // folders registered with fsWatcher
+    QSet<QString> pendingDirs; // changed since the last flush
+  };
+
+  QFileSystemWatcher fsWatcher;
+  QHash<int, WatchedPlaylist> playlists;
+  QHash<QString, int> dirOwner; // folder -> playlistId
+
+  QTimer quietTimer;    // restarted by every event
+  QTimer maxDelayTimer; // caps the delay while events keep coming
+
+  QFutureWatcher<RescanPlan> planWatcher;
+  int flushingPlaylistId = -1;
+  QStringList flushingDirs;
+  int flushingGeneration = 0; // SQliteDB::generation() at flush()
+
+  void onDirectoryChanged(const QString &dir);
+  void flush();
+  void onPlanReady();
+  bool isStale() const; // a restore replaced the data being synced
+  void requeueFlushingDirs();
+  void addDirs(WatchedPlaylist &pl, int playlistId, const QStringList &dirs);
+  void removeDirs(WatchedPlaylist &pl, const QStringList &dirs);
+};
+
+#endif // FOLDERWATCHER_H
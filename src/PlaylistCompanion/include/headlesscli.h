@@ -0,0 +1,51 @@
+#ifndef HEADLESSCLI_H
+#define HEADLESSCLI_H
+
+#include <QDebug>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#define clidebug qDebug() << "[HeadlessCli] "
+
+// "PlaylistCompanion <command> ..." runs without any window, on the same
+// scanner / ingest / rescan / backup layers as the GUI:
+//
+//   import <dir...> [--watch]  a new playlist per folder
+//   rescan --all | <id...>     incremental rescan of playlists
+//   backup                     snapshot into the backup store, then prune
+//   stats                      library totals and watch statistics
+//   vacuum                     checkpoint, merge the FTS indexes, VACUUM
+//
+// Up to --jobs folders are scanned (playlists planned) at once while the
+// results before them are written. stdout gets one JSON object per line:
+// a record per folder / playlist / step, then a summary with the timings.
+// Logs stay on stderr, debug output only with --verbose.
+class HeadlessCli : public QObject {
+  Q_OBJECT
+
+public:
+  // argv[1] is a command: main() builds a QCoreApplication, no QApplication
+  static bool wants(int argc, char *argv[]);
+
+  explicit HeadlessCli(QObject *parent = nullptr);
+
+  // Exit code: 0 all done, 1 something failed, 2 usage / no database
+  int run(const QStringList &arguments);
+
+private:
+  int jobs = 1;
+
+  // Each returns the fields of its summary line, "failed" included
+  QJsonObject importFolders(const QStringList &dirs, bool watchFolder);
+  QJsonObject rescan(const QStringList &ids, bool all);
+  QJsonObject backup();
+  QJsonObject stats();
+  QJsonObject vacuum();
+
+  static void print(const QJsonObject &record);
+  static qint64 databaseBytes(); // file + WAL
+};
+
+#endif // HEADLESSCLI_H
@@ -0,0 +1,64 @@
+#ifndef MEDIAPROBE_H
+#define MEDIAPROBE_H
+
+#include <QByteArray>
+#include <QDebug>
+#include <QFile>
+#include <QString>
+
+#define probedebug qDebug() << "[MediaProbe] "
+
+// What the container headers say about one file
+struct MediaInfo {
+  bool ok = false;        // container recognised and a duration found
+  qint64 durationMs = -1; // -1: unknown
+  int width = 0;          // 0: unknown (e.g. MPEG-TS, needs the bitstream)
+  int height = 0;
+  QString videoCodec; // fourcc / CodecID / stream type, as the file names it
+  QString container;  // "mp4", "matroska", "webm", "avi", "mpegts"
+  qint64 bytesRead = 0;
+};
+
+// Duration, resolution and codec from container headers only - no decoder,
+// no demuxing of the payload. Reads are small and positioned:
+//  - MP4/MOV: box headers down to moov/mvhd, tkhd, hdlr, stsd; mdat is
+//    skipped by its size, so a trailing moov costs one seek
+//  - Matroska/WebM: EBML up to Info and Tracks (via SeekHead if needed)
+//  - AVI: RIFF hdrl/avih and the strl of the video stream
+//  - MPEG-TS: PAT/PMT for the codec, first and last PCR for the duration
+// Stateless and thread-safe; meant to run on a pool.
+class MediaProbe {
+
+public:
+  static MediaInfo probe(const QString &path);
+  // Encoded bytes (JPEG / PNG) of embedded cover art: MP4 ilst "covr",
+  // a Matroska image attachment (one named "cover*" preferred). Empty if
+  // there is none.
+  static QByteArray coverArt(const QString &path);
+
+private:
+  // Positioned reads on one open file, counting what was read
+  class Reader {
+  public:
+    explicit Reader(const QString &path);
+    bool isOpen() const;
+    qint64 size() const;
+    QByteArray readAt(qint64 pos, qint64 length);
+    qint64 bytesRead() const;
+
+  private:
+    QFile file;
+    qint64 fileSize = 0;
+    qint64 totalRead = 0;
+  };
+
+  static bool probeMp4(Reader &reader, MediaInfo &info);
+  static bool probeMatroska(Reader &reader, MediaInfo &info);
+  static bool probeAvi(Reader &reader, MediaInfo &info);
+  static bool probeMpegTs(Reader &reader, MediaInfo &info, int packetSize,
+                          int packetOffset);
+  static QByteArray coverMp4(Reader &reader);
+  static QByteArray coverMatroska(Reader &reader);
+};
+
+#endif // MEDIAPROBE_H
@@ -0,0 +1,66 @@
+#ifndef METADATAPROBER_H
+#define METADATAPROBER_H
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include <include/mediaprobe.h>
+
+#define proberdebug qDebug() << "[MetadataProber] "
+
+// Fills Video.durationMs / width / height / videoCodec for files that were
+// never probed (durationMs IS NULL). Playlists are worked through one at a
+// time; the files of one are read by MediaProbe on a pool of I/O threads
+// and stored in batches, one DbWriter transaction each. The triggers keep
+// Playlist.totalDurationMs exact as the batches commit.
+class MetadataProber : public QObject {
+  Q_OBJECT
+
+public:
+  explicit MetadataProber(QObject *parent = nullptr);
+  ~MetadataProber();
+
+  // Queue a playlist; no-op if it is queued already. Cheap when everything
+  // is probed (one indexed lookup).
+  void enqueue(int playlistId);
+  bool isRunning() const;
+  void cancel(); // stops after the batch in flight
+
+signals:
+  // After each committed batch, on the owning thread
+  void durationsStored(int playlistId, const QHash<int, qint64> &durations);
+  void progress(int playlistId, int probed, int total);
+  void finished(int playlistId, int probed, qint64 elapsedMs);
+
+private:
+  struct Batch {
+    QVector<int> ids;
+    QVector<MediaInfo> infos;
+  };
+
+  static constexpr int kBatchSize = 500;
+  static constexpr int kProbeThreads = 4; // seeks, not CPU
+
+  QThreadPool probePool;
+  QFutureWatcher<int> watcher;
+  QList<int> pending;
+  int runningPlaylistId = -1;
+  QElapsedTimer runTimer;
+  std::atomic_bool cancelRequested{false};
+
+  void startNext();
+  void onPlaylistDone();
+  // Worker side: load, probe, hand batches to the writer
+  int probePlaylist(int playlistId, int generation);
+  QFuture<bool> storeBatch(int playlistId, int generation,
+                           const Batch &batch, int probed, int total);
+};
+
+#endif // METADATAPROBER_H
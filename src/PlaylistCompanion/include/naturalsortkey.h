@@ -0,0 +1,18 @@
+#ifndef NATURALSORTKEY_H
+#define NATURALSORTKEY_H
+
+#include <QByteArray>
+#include <QString>
+
+// Binary sort key for a file path. Comparing two keys with memcmp (or as
+// SQLite BLOBs) gives a case-insensitive, numeric-aware order:
+// "Lecture 2" < "Lecture 10", and the contents of a folder stay together.
+//
+// Layout, per path component:
+//   text run  -> 0x02, case folded UTF-8 bytes
+//   digit run -> 0x01, number of significant digits, the digits
+//   '/'       -> 0x00
+// Every marker sorts below any text byte, so a shorter name sorts first.
+QByteArray naturalSortKey(const QString &path);
+
+#endif // NATURALSORTKEY_H
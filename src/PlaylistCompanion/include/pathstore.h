@@ -0,0 +1,82 @@
+#ifndef PATHSTORE_H
+#define PATHSTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Video paths of one playlist, packed. Folders are interned once as a tree
+// of nodes (parent + last segment), file names go one after the other into
+// a single UTF-8 buffer, and a path is a 12 byte leaf pointing at both. A
+// path is rebuilt as a QString only when asked for, e.g. for painted rows.
+//
+// Handles are indexes in insertion order (or the order set by reorder())
+// and stay valid until clear(); nothing is ever removed on its own.
+// Paths outside root() are kept too, with their folder as one node.
+// Not thread-safe: one owner, or a lock around it (see VideoScanner).
+class PathStore {
+
+public:
+  using Handle = quint32;
+
+  explicit PathStore(const QString &root = QString());
+
+  const QString &root() const { return rootPath; }
+
+  // Absolute, or relative to root() as stored in Video.videoPath
+  Handle add(const QString &path);
+  void reserve(int count);
+  void clear(); // keeps root()
+
+  int size() const { return int(leaves.size()); }
+  bool isEmpty() const { return leaves.isEmpty(); }
+
+  QString path(Handle handle) const;         // absolute
+  QString relativePath(Handle handle) const; // absolute if outside root()
+  QString fileName(Handle handle) const;
+
+  // Handle order[i] becomes handle i; order must be a permutation of all
+  // handles. Only the leaves move, names and folders stay where they are.
+  void reorder(const QVector<Handle> &order);
+
+  // Heap bytes held, give or take the containers' own headers
+  qsizetype memoryBytes() const;
+
+  // What Video.videoPath holds: path relative to root, or path itself when
+  // it is not inside root
+  static QString relativeTo(const QString &root, const QString &path);
+  // The other way round; stored paths that are absolute come back as is
+  static QString absoluteOf(const QString &root, const QString &stored);
+
+private:
+  static constexpr quint32 kNoParent = 0xFFFFFFFF;
+
+  // A name in `names`; for a folder only its last segment, except for the
+  // folder of a path outside root, which is kept whole (parent kNoParent)
+  struct Leaf {
+    quint32 dir;
+    quint32 offset;
+    quint32 length;
+  };
+  struct DirNode {
+    quint32 parent;
+    quint32 offset;
+    quint32 length;
+  };
+
+  QString rootPath;
+  QByteArray names;
+  QVector<Leaf> leaves;
+  QVector<DirNode> dirs;            // dirs[0] is root() itself
+  QHash<QString, quint32> dirIndex; // folder key -> node
+  QString lastDirKey;               // files of one folder arrive together
+  quint32 lastDir = 0;
+
+  quint32 internDir(const QString &dirKey);
+  quint32 appendName(const QString &name);
+  QString nameAt(quint32 offset, quint32 length) const;
+  QString dirKeyOf(quint32 dir) const;
+};
+
+#endif // PATHSTORE_H
@@ -0,0 +1,97 @@
+#ifndef PLAYERCONTROLLER_H
+#define PLAYERCONTROLLER_H
+
+#include <QDebug>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <include/structures.h>
+
+class QLocalSocket;
+class QTcpSocket;
+
+#define playerdebug qDebug() << "[PlayerController] "
+
+// Plays a video in the default media player, started detached so it
+// outlives the app, at the position it was left at. mpv (JSON IPC socket)
+// and VLC (RC interface on a local TCP port) report where playback is:
+//  - Video.resumeTime is written at most every kFlushIntervalMs, when it
+//    moved, and once more when the player closes or the app quits
+//  - past kWatchedPercent of the duration watchedReached() is emitted once
+//  - the seconds actually played (seeks left out) go to the watch history
+//    as one session when the player closes or the app quits
+// Other players are only started.
+// Which protocol is spoken follows the executable's name, so a script
+// called "mpv" that answers on the socket can stand in for the player.
+class PlayerController : public QObject {
+  Q_OBJECT
+
+public:
+  enum class Kind { Other, Mpv, Vlc };
+
+  static constexpr int kFlushIntervalMs = 5000;
+  static constexpr int kWatchedPercent = 90;
+  static constexpr int kConnectRetryMs = 200;
+  static constexpr int kConnectAttempts = 50; // the player gets 10 s
+  static constexpr int kPollMs = 1000;        // VLC does not push positions
+  static constexpr int kMaxUnanswered = 8;
+  static constexpr int kMaxPlayStep = 5; // s; a longer jump is a seek
+
+  explicit PlayerController(QObject *parent = nullptr);
+  ~PlayerController();
+
+  static Kind kindOf(const QString &playerPath);
+
+  // Ends the session before (its position is kept). vdo needs videoID,
+  // playlistID, videoPath and resumeTime; durationMs <= 0 if unknown.
+  bool play(const QString &playerPath, const Video &vdo, qint64 durationMs);
+  bool isTracking() const; // connected to the player
+  int videoId() const;     // -1 without a session
+
+  // Position to the DB now, if it moved since the last write
+  void flush();
+
+signals:
+  void positionChanged(int videoId, int seconds);
+  void watchedReached(int playlistId, int videoId);
+  void sessionEnded(int videoId);
+  // Its time played is committed to the watch history
+  void sessionRecorded(int playlistId);
+  void failed(const QString &reason);
+
+private:
+  Kind kind = Kind::Other;
+  Video current{};
+  qint64 durationMs = 0;
+  int position = -1;       // seconds; -1 not known yet
+  int storedPosition = -1; // what the DB has
+  int playedSeconds = 0;   // this session, forward steps only
+  int recordedSeconds = 0; // of those, in the watch history
+  bool watchedSent = false;
+  bool tracking = false;
+  int session = 0; // numbers the mpv sockets of this process
+
+  QString ipcServer; // mpv: socket path / pipe name
+  quint16 rcPort = 0; // VLC
+  QList<bool> vlcAsked; // questions not answered yet, true: get_length
+  int connectAttempts = 0;
+
+  QLocalSocket *mpvSocket = nullptr;
+  QTcpSocket *vlcSocket = nullptr;
+  QTimer connectTimer;
+  QTimer flushTimer;
+  QTimer pollTimer;
+
+  QStringList arguments(int startSeconds) const;
+  void connectIpc();
+  void onIpcConnected();
+  void readMpv();
+  void readVlc();
+  void setPosition(int seconds);
+  void recordPlayed();
+  void endSession();
+};
+
+#endif // PLAYERCONTROLLER_H
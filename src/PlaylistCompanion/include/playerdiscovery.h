@@ -0,0 +1,75 @@
+#ifndef PLAYERDISCOVERY_H
+#define PLAYERDISCOVERY_H
+
+#include <QDebug>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#define discoverydebug qDebug() << "[PlayerDiscovery] "
+
+// A player the app knows how to look for
+struct KnownPlayer {
+  QString name;         // shown in Settings, MediaPlayerPath.mediaPlayerName
+  QString defaultPath;  // where its installer puts it; may be empty
+  QStringList commands; // executable names searched in PATH and snap
+  QString flatpakId;    // exported as <flatpak>/exports/bin/<id>
+};
+
+// A row of MediaPlayerPath
+struct FoundPlayer {
+  QString name;
+  QString path;
+  QString source; // 'known', 'path', 'flatpak' or 'snap'
+};
+
+// Finds installed media players once, in the background, and caches them in
+// MediaPlayerPath. The folders it searches ($PATH, flatpak exports, snap,
+// the default install folders) are stamped by their modification times;
+// the stamp is kept in General.playerStamp and the search only runs again
+// when it moved (a player was installed or removed, PATH changed).
+// Settings reads the cache only and does no filesystem I/O.
+class PlayerDiscovery : public QObject {
+  Q_OBJECT
+
+public:
+  // GUI-thread singleton
+  static PlayerDiscovery *instance();
+
+  // Stamp check on the pool, search and store only if it changed.
+  // While one runs, another follows it (once, however often this is called).
+  void refresh();
+
+  static const QVector<KnownPlayer> &knownPlayers();
+  // The cached rows, in the order of knownPlayers(); any thread
+  static QVector<FoundPlayer> load();
+
+signals:
+  // MediaPlayerPath was rewritten (not emitted when the stamp was the same)
+  void playersChanged();
+
+private:
+  struct Scan {
+    QString stamp;
+    bool unchanged = false;
+    QVector<FoundPlayer> players;
+  };
+  struct SearchDir {
+    QString path;
+    QString source;
+  };
+
+  explicit PlayerDiscovery(QObject *parent = nullptr);
+  static PlayerDiscovery *discoveryInstance;
+  bool running = false;
+  bool rerun = false; // refresh() came in while running
+
+  static QVector<SearchDir> searchDirs();
+  static QString stampOf(const QVector<SearchDir> &dirs);
+  static Scan scan(); // worker side
+  void store(const Scan &scan);
+  void finishRun(); // GUI thread, after the last step of a run
+};
+
+#endif // PLAYERDISCOVERY_H
@@ -0,0 +1,78 @@
+#ifndef PLAYLISTRESCANNER_H
+#define PLAYLISTRESCANNER_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <include/db_sqlite.h>
+#include <include/structures.h>
+
+#define rescandebug qDebug() << "[PlaylistRescanner] "
+
+// What a rescan wants to change, computed without touching the DB
+struct RescanPlan {
+  QString rootPath; // Video rows are stored relative to it
+  QStringList addedFiles;
+  QStringList removedFiles;
+  // Size and mtime of every video in a listed folder (added or known)
+  QHash<QString, FileIdentity> identities;
+  QVector<DirFingerprint> changedDirs; // upserted into DirFingerprint
+  QStringList removedDirs;             // deleted from DirFingerprint
+  int statCount = 0;                   // directories stat()ed
+  int listedDirs = 0;                  // directories actually listed
+  bool rootMissing = false; // folder offline / unmounted: change nothing
+};
+
+// Incremental rescan of a playlist folder. Every known folder is stat()ed;
+// only folders whose fingerprint changed are listed again, and only the
+// added / removed Video rows are written back.
+class PlaylistRescanner : public QObject {
+  Q_OBJECT
+
+public:
+  explicit PlaylistRescanner(QObject *parent = nullptr);
+
+  // Reads the cache on the calling thread, walks the tree on a worker and
+  // writes the diff back through DbWriter. false if one is running.
+  bool rescan(int playlistId, const QString &rootPath);
+  bool isRunning() const;
+
+  // Filesystem-only part, safe on any thread. Walks the subtrees under
+  // startDirs (all inside rootPath); an empty list means the whole playlist.
+  static RescanPlan plan(const QString &rootPath, const QStringList &startDirs,
+                         const QHash<QString, DirFingerprint> &cache,
+                         const QSet<QString> &knownVideos);
+
+  // --- DB side, reads on the calling thread's read connection ---
+  static QHash<QString, DirFingerprint> loadFingerprints(int playlistId);
+  // Absolute paths; rootPath is the playlist's folder
+  static QSet<QString> loadVideoPaths(int playlistId, const QString &rootPath);
+  // --- Writes, only inside DbWriter jobs ---
+  // Run inside a transaction when storing many rows
+  static bool storeFingerprints(int playlistId,
+                                const QVector<DirFingerprint> &fingerprints);
+  // Writes the plan in one transaction. A removed and an added file with
+  // the same name (moved to another folder), or failing that with the same
+  // size and mtime (renamed), update the existing row so watched state,
+  // resume time and duration survive; anything else is remove + add.
+  static bool apply(int playlistId, const RescanPlan &plan,
+                    VideoDelta *delta = nullptr);
+
+signals:
+  void finished(int playlistId, int added, int removed);
+  void videosChanged(const VideoDelta &delta);
+  void failed(int playlistId, const QString &reason);
+
+private:
+  QFutureWatcher<RescanPlan> watcher;
+  int runningPlaylistId = -1;
+  int runningGeneration = 0; // SQliteDB::generation() at rescan()
+
+  void onPlanReady();
+};
+
+#endif // PLAYLISTRESCANNER_H
@@ -0,0 +1,36 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QElapsedTimer>
+#include <QVector>
+
+// Startup phases of the GUI, timed from the top of main(). Always recorded
+// (a clock read per phase); printed only with --startup-trace, as one JSON
+// line on stdout once the first playlist is on screen:
+//
+//   {"startup":[{"phase":"qt init","ms":14.2,"atMs":14.2},...],
+//    "firstPaintMs":41.7,"readyMs":63.0}
+//
+// Only the phases up to "first paint" decide when the window appears; the
+// catalog is read after it.
+class StartupTrace {
+
+public:
+  static void start(); // first thing in main()
+  static void setEnabled(bool on);
+  // Time since the previous phase ended; ignored after finish()
+  static void phase(const char *name);
+  static void finish();
+
+private:
+  struct Phase {
+    const char *name;
+    qint64 endNs;
+  };
+  static QElapsedTimer clock;
+  static QVector<Phase> phases;
+  static bool enabled;
+  static bool finished;
+};
+
+#endif // STARTUPTRACE_H
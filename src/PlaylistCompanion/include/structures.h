@@ -1,6 +1,9 @@
 #ifndef STRUCTURES_H
 #define STRUCTURES_H
+#include <QHash>
 #include <QString>
+#include <QVector>
+#include <include/pathstore.h>
 
 struct Playlist {
   int playlistId;
@@ -11,17 +14,61 @@ struct Playlist {
   int totalVideoCount;
   int watchedCount;
   int totalTimeHour;
+  qint64 totalDurationMs = 0; // sum of the probed video durations
   QString creationDateTime;
   QString lastWatchedDateTime;
+  int watchFolder = 0; // 1 = keep Video rows in sync with the folder
 };
 
 struct Video {
     int videoID;
     int playlistID;
-    QString videoPath;
+    QString videoPath; // absolute; the Video row keeps it relative
     QString videoTitle;
     int isWatched; // 0 for false, 1 for true
     int resumeTime;
 };
 
+// Cheap "did this folder change" check, one stat() per directory.
+// A directory's mtime changes whenever an entry is added, removed or renamed
+// directly inside it, so an unchanged fingerprint means its listing is too.
+struct DirFingerprint {
+    QString dirPath;
+    QString parentPath; // empty for the playlist root
+    qint64 mtime = 0;   // nanoseconds on Linux, milliseconds elsewhere
+    int entryCount = 0; // videos + subfolders seen at the last listing
+    quint64 inode = 0;  // 0 where the platform does not expose one
+};
+
+// What a rename keeps: size and modification time of a video file. A
+// removed and an added file with the same identity are one file renamed.
+struct FileIdentity {
+    qint64 size = -1; // -1: unknown (rows written before schema 13)
+    qint64 mtimeMs = 0;
+    bool isValid() const { return size >= 0; }
+    bool operator==(const FileIdentity &other) const {
+        return size == other.size && mtimeMs == other.mtimeMs;
+    }
+};
+
+struct VideoCollection {
+    PathStore fileList; // rooted at the scanned folder, naturally sorted
+    QVector<FileIdentity> identities; // per fileList handle; may be empty
+    int count = 0;
+    QVector<DirFingerprint> dirFingerprints; // every folder that was listed
+};
+
+// Row level change of one playlist, so views can patch instead of reload
+struct VideoDelta {
+    int playlistId = -1;
+    QVector<Video> added;
+    QVector<Video> renamed; // same videoID (watched state kept), new path
+    QHash<int, qint64> renamedDurations; // videoID -> ms, probed ones only
+    QVector<int> removedIds;
+
+    bool isEmpty() const {
+        return added.isEmpty() && renamed.isEmpty() && removedIds.isEmpty();
+    }
+};
+
 #endif // STRUCTURES_H
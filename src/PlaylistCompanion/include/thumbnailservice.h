@@ -0,0 +1,124 @@
+#ifndef THUMBNAILSERVICE_H
+#define THUMBNAILSERVICE_H
+
+#include <QCache>
+#include <QDebug>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+
+#ifdef PLC_HAVE_MULTIMEDIA
+class QMediaPlayer;
+class QVideoFrame;
+class QVideoSink;
+#endif
+
+#define thumbdebug qDebug() << "[ThumbnailService] "
+
+// Where thumbnail requests were answered from
+struct ThumbnailStats {
+  quint64 memoryHits = 0; // QPixmap already in the LRU
+  quint64 diskHits = 0;   // decoded from the disk cache
+  quint64 generated = 0;  // cover art or a grabbed frame
+  quint64 failures = 0;   // nothing to show (not retried this run)
+
+  quint64 requests() const {
+    return memoryHits + diskHits + generated + failures;
+  }
+};
+
+// One thumbnail per video, made off the GUI thread. Two cache levels:
+//  - disk: <db dir>/thumbnails/<2 hex>/<key>.jpg, kDiskWidth wide, key =
+//    SHA-1 of (path, size, mtime), so a replaced file gets a new one
+//  - memory: QCache of QPixmaps per (key, width), bounded in KiB
+// A miss reads embedded cover art (MP4 covr, Matroska attachment) on a
+// pool; without any, and with Qt Multimedia, a frame at 10% of the video
+// is grabbed by one QMediaPlayer (decoding runs on its own threads).
+// GUI thread only, apart from the pool jobs it starts.
+class ThumbnailService : public QObject {
+  Q_OBJECT
+
+public:
+  static constexpr int kDiskWidth = 320; // 16:9 -> 320x180
+
+  explicit ThumbnailService(QObject *parent = nullptr);
+  ~ThumbnailService();
+
+  // Cached pixmap or a null one; never starts work
+  QPixmap cached(const QString &path, int width) const;
+  // Cached pixmap, or a null one and a job ahead of all prefetches;
+  // thumbnailReady() follows
+  QPixmap request(const QString &path, int width);
+  // Rows around the viewport: queued behind requests. Prefetches of an
+  // older call that have not started yet are dropped.
+  void prefetch(const QStringList &paths, int width);
+  // Tried before: no cover art and no frame could be had
+  bool hasNoThumbnail(const QString &path) const;
+
+  ThumbnailStats stats() const;
+  void logStats() const;
+
+signals:
+  void thumbnailReady(const QString &path, int width);
+
+private:
+  struct Job {
+    QString path;
+    int width = 0;
+    int prefetchRound = 0; // 0 = explicit request
+  };
+  // What a pool job hands back to the GUI thread
+  enum class Outcome { Ready, NeedsFrame, Failed, Dropped };
+
+  static constexpr int kMemoryCacheKiB = 48 * 1024;
+  static constexpr qint64 kDiskCacheBytes = 256LL * 1024 * 1024;
+  static constexpr int kWorkerThreads = 2;
+  static constexpr int kJpegQuality = 80;
+
+  QThreadPool pool;
+  QCache<QString, QPixmap> memory; // "<path>@<width>", cost in KiB
+  QSet<QString> pending;           // "<path>@<width>" queued or running
+  QSet<QString> failed;            // paths with nothing to show
+  std::atomic_int prefetchRound{0};
+  ThumbnailStats counters; // memoryHits, failures; this thread only
+  std::atomic<quint64> diskHits{0};
+  std::atomic<quint64> generated{0};
+
+  void start(const Job &job, int priority);
+  void deliver(const Job &job, Outcome outcome, const QImage &image);
+  // --- Pool side ---
+  Outcome load(const Job &job, QImage &image);
+  // Cover art or a grabbed frame: to the disk cache, then scaled for job.
+  // A null source fails; remember: a .none marker keeps later runs from
+  // trying the file again.
+  Outcome store(const Job &job, const QImage &source, QImage &image,
+                bool remember);
+  static QString diskPath(const QString &path); // empty if the file is gone
+  static QString cacheDir();
+  static QImage scaled(const QImage &image, int width);
+  static void trimDiskCache(); // oldest first, down to kDiskCacheBytes
+
+#ifdef PLC_HAVE_MULTIMEDIA
+  static constexpr int kGrabTimeoutMs = 5000;
+  QMediaPlayer *player = nullptr;
+  QVideoSink *sink = nullptr;
+  QList<Job> grabQueue;
+  bool grabbing = false;
+  Job grabJob;
+  QTimer grabTimer;
+  void grabNext();
+  void onFrame(const QVideoFrame &frame);
+  // Invalid frame: failed; unplayable (InvalidMedia) ones are remembered
+  void finishGrab(const QVideoFrame &frame, bool unplayable);
+#endif
+};
+
+#endif // THUMBNAILSERVICE_H
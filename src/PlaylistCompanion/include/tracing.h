@@ -0,0 +1,84 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QString>
+#include <QVector>
+
+// Scoped spans on the hot paths: SQL statements, folder scans, the video
+// table, backups. Built in with `qmake CONFIG+=tracing` (PLC_TRACING);
+// without it the macros expand to nothing and no argument is evaluated.
+//
+//   PLC_TRACE_SPAN(span, "sql.read");
+//   PLC_TRACE_DETAIL(span, sql);
+//   ...
+//   PLC_TRACE_ROWS(span, query.numRowsAffected());
+//
+// A span records itself when it goes out of scope. Every thread appends to
+// its own buffer, which only that thread writes; readers see the events
+// published so far, so the hot path takes no lock. A thread stops recording
+// after kMaxEventsPerThread (counted in droppedEvents()).
+
+// Latency of one span name, over everything recorded
+struct TraceSummary {
+  QString name;
+  int count = 0;
+  double p50Ms = 0;
+  double p99Ms = 0;
+  double maxMs = 0;
+  double totalMs = 0;
+};
+
+class Tracing {
+
+public:
+  static constexpr int kMaxEventsPerThread = 1 << 18;
+
+  static constexpr bool compiledIn() {
+#ifdef PLC_TRACING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Per span name, the most total time first
+  static QVector<TraceSummary> summary();
+  // Chrome trace event format ("X" events, one track per thread); opens in
+  // chrome://tracing and ui.perfetto.dev. false without PLC_TRACING.
+  static bool exportChrome(const QString &path, QString *error = nullptr);
+  static qint64 droppedEvents();
+};
+
+#ifdef PLC_TRACING
+
+class TraceSpan {
+
+public:
+  explicit TraceSpan(const char *name); // a string literal, kept as is
+  ~TraceSpan();
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+  void setDetail(const QString &text) { detail = text; }
+  void setRows(qint64 count) { rows = count; }
+
+private:
+  const char *name;
+  qint64 startNs;
+  qint64 rows = -1;
+  QString detail;
+};
+
+#define PLC_TRACE_SPAN(var, name) TraceSpan var(name)
+#define PLC_TRACE_DETAIL(var, text) var.setDetail(text)
+#define PLC_TRACE_ROWS(var, count) var.setRows(count)
+
+#else
+
+#define PLC_TRACE_SPAN(var, name) ((void)0)
+#define PLC_TRACE_DETAIL(var, text) ((void)0)
+#define PLC_TRACE_ROWS(var, count) ((void)0)
+
+#endif // PLC_TRACING
+
+#endif // TRACING_H
@@ -0,0 +1,42 @@
+#ifndef VIDEOINGEST_H
+#define VIDEOINGEST_H
+
+#include <QByteArray>
+#include <QString>
+#include <include/dbwriter.h>
+#include <include/structures.h>
+
+#define ingestdebug qDebug() << "[VideoIngest] "
+
+struct IngestStats {
+  bool ok = true;
+  int rows = 0;
+  qint64 elapsedMs = 0;
+  double rowsPerSecond = 0;
+};
+
+// Bulk insert of a scanned folder into the Video table: multi-row INSERTs
+// through the statement cache, committed in chunks, no per-row logging.
+// Runs inside a DbWriter job (writer thread and connection).
+class VideoIngest {
+
+public:
+  static constexpr int kRowsPerStatement = 140;    // 7 binds each, < 999
+  static constexpr int kRowsPerTransaction = 5000; // bounded journal size
+
+  // Display title: file name without folder and extension
+  static QString titleOf(const QString &videoPath);
+
+  // Inserts all videos of vdos (plus its folder fingerprints); videoPath
+  // is stored relative to playlistPath
+  static IngestStats insertVideos(int playlistId, const QString &playlistPath,
+                                  const VideoCollection &vdos);
+
+  // The Playlist row (title, path, status, totalTimeHour, watchFolder of
+  // pl), then insertVideos(). Its new playlistId, -1 if the row could not
+  // be written; stats (optional) is for the videos.
+  static int createPlaylist(const Playlist &pl, const VideoCollection &vdos,
+                            IngestStats *stats = nullptr);
+};
+
+#endif // VIDEOINGEST_H
@@ -0,0 +1,78 @@
+#ifndef VIDEOSCANNER_H
+#define VIDEOSCANNER_H
+
+#include <QDebug>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <include/structures.h>
+
+#define scandebug qDebug() << "[VideoScanner] "
+
+// Walks a playlist folder on a worker pool. Every directory is its own task,
+// so sibling folders (e.g. on a NAS) are listed concurrently. Counts reach
+// the owning (GUI) thread after every folder; the files themselves come
+// with finished(), once.
+class VideoScanner : public QObject {
+  Q_OBJECT
+
+public:
+  explicit VideoScanner(QObject *parent = nullptr);
+  ~VideoScanner();
+
+  // Name filters that decide what counts as a "Video"
+  static const QStringList &videoNameFilters();
+
+  // One stat() of dirPath, fills mtime and inode (not entryCount)
+  static bool readFingerprint(const QString &dirPath, DirFingerprint &fp);
+
+  // Case-insensitive, numeric-aware order (see naturalSortKey). Returns
+  // the permutation applied (see PathStore::reorder()), for data kept
+  // per handle.
+  static QVector<PathStore::Handle> naturalSort(PathStore &paths);
+
+  // Non-recursive listing of one folder: matching videos and subfolders,
+  // plus size and mtime of each video if identities is given (from the
+  // listing's own stat, no extra call)
+  static void listDirectory(const QString &dirPath, QStringList &files,
+                            QStringList &subdirs,
+                            QVector<FileIdentity> *identities = nullptr,
+                            const std::atomic_bool *cancelFlag = nullptr);
+
+  // Start scanning rootPath; a running scan is cancelled first
+  void start(const QString &rootPath);
+
+  // Ask the workers to stop; cancelled() is emitted once they are done
+  void cancel();
+
+  bool isRunning() const;
+
+signals:
+  void progress(int dirsScanned, int dirsPending, int filesFound);
+  // Whole tree done, fileList naturally sorted
+  void finished(const VideoCollection &vdos);
+  void cancelled();
+
+private:
+  QThreadPool pool;
+  std::atomic_bool cancelRequested{false};
+  std::atomic_bool running{false};
+  std::atomic_int pendingDirs{0};
+  std::atomic_int scannedDirs{0};
+  std::atomic_int filesFound{0};
+
+  QMutex foundMutex;
+  PathStore found;                      // guarded by foundMutex
+  QVector<FileIdentity> foundIdentities; // per handle of found, same lock
+  QVector<DirFingerprint> fingerprints; // guarded by foundMutex
+
+  void enqueueDirectory(const QString &dirPath, const QString &parentPath);
+  // Both run on pool threads
+  void scanDirectory(const QString &dirPath, const QString &parentPath);
+  void finishScan(); // only on the thread that finished the last folder
+};
+
+#endif // VIDEOSCANNER_H
@@ -0,0 +1,57 @@
+#ifndef VIDEOSEARCH_H
+#define VIDEOSEARCH_H
+
+#include <QDebug>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#define searchdebug qDebug() << "[VideoSearch] "
+
+// One row of the search results: a video, or a note (on a video or on a
+// whole playlist)
+struct SearchHit {
+  int playlistId = -1;
+  int videoId = -1; // -1: a note on the playlist itself
+  int noteId = -1;  // -1: the video matched, not one of its notes
+  QString title;    // video title, or the playlist title for its notes
+  QString playlistTitle;
+  QString detail;    // path of the video, or the start of the note
+  double score = 0;  // bm25, lower is better
+};
+
+// Full-text search over every playlist, through the FTS5 tables of schema
+// step 9: VideoSearch (videoTitle, searchText) and NoteSearch (noteText).
+// Triggers on Video and Notes keep both in sync with their rows.
+//
+// FTS5's unicode61 tokenizer only splits at punctuation, so a file name
+// is split here before it is stored (Video.searchText, like sortKey): path
+// segments, letter / digit runs and CamelCase humps become words of their
+// own, so "lec 10" finds ".../DeepLearning/Lecture10-Backprop.mp4".
+class VideoSearch {
+
+public:
+  // Per table, best bm25 first. Every match is scored, so a word that is
+  // in most rows ("lecture") is the slow case (see the searchCommonTerm
+  // bench).
+  static constexpr int kMaxHits = 50;
+
+  // Words of a path for Video.searchText
+  static QString indexText(const QString &path);
+  // FTS5 MATCH expression for what was typed; empty if nothing to search.
+  // Words before the last are whole terms unless allPrefix, the last is a
+  // prefix once it has two characters (the prefix indexes cover 2-4).
+  static QString matchExpression(const QString &typed, bool allPrefix = false);
+
+  // Best hits of both tables, on the calling thread's read connection.
+  // Retried with every word as a prefix when that finds nothing ("lect 10").
+  static QVector<SearchHit> search(const QString &typed, int limit = kMaxHits);
+
+private:
+  // Letter runs, digit runs, CamelCase humps of one word
+  static QStringList splitWord(const QString &word);
+  static QVector<SearchHit> searchVideos(const QString &match, int limit);
+  static QVector<SearchHit> searchNotes(const QString &match, int limit);
+};
+
+#endif // VIDEOSEARCH_H
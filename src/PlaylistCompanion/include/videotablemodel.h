@@ -0,0 +1,115 @@
+#ifndef VIDEOTABLEMODEL_H
+#define VIDEOTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include <include/structures.h>
+
+class ThumbnailService;
+
+#define modeldebug qDebug() << "[VideoTableModel] "
+
+// Videos of one playlist for the "All Videos" table. Rows are paged in
+// from SQLite while the view scrolls (canFetchMore / fetchMore), so
+// switching playlists costs one page, not one widget item per video.
+// Rows are in natural order ("Part 2" before "Part 10"): SQLite sorts by
+// the persisted sortKey through an index, pages continue after the last
+// (sortKey, videoID) fetched. Only that one key is kept, not one per row.
+// Column 0: watched checkbox, column 1: file name (derived when painted),
+// column 2: duration from the container headers (see MetadataProber).
+class VideoTableModel : public QAbstractTableModel {
+  Q_OBJECT
+
+public:
+  enum Column { WatchedColumn = 0, NameColumn, DurationColumn, ColumnCount };
+  static constexpr int kPageSize = 256;
+
+  explicit VideoTableModel(QObject *parent = nullptr);
+
+  // Drops all rows; the view pulls the first page on its own
+  void setPlaylist(int playlistId);
+  int playlistId() const;
+
+  int videoIdAt(int row) const;
+  QString videoPathAt(int row) const;
+  // Heap bytes of the loaded rows, give or take the containers' headers
+  qsizetype memoryBytes() const;
+
+  // Same as ticking the checkbox (watchedToggled() follows); false if the
+  // row is not loaded
+  bool setWatched(int videoId, bool isWatched);
+
+  // Pages rows in until videoId is loaded (a search hit further down);
+  // its row, or -1 if it is not in this playlist
+  int fetchUntil(int videoId);
+
+  // Patch loaded rows after a rescan / folder-watch sync
+  void applyDelta(const VideoDelta &delta);
+  // Decoration of the name column, from the memory cache only: the view
+  // prefetches what is near the viewport, painting never waits on it
+  void setThumbnails(ThumbnailService *service, int width);
+
+  // Durations stored by the prober since the rows were loaded
+  void applyDurations(int playlistId, const QHash<int, qint64> &probed);
+
+  // "1:02:03" / "4:05", empty when unknown
+  static QString formatDuration(qint64 ms);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  bool setData(const QModelIndex &index, const QVariant &value,
+               int role = Qt::EditRole) override;
+  Qt::ItemFlags flags(const QModelIndex &index) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
+
+signals:
+  // The checkbox was toggled by the user; persisting it is up to the owner
+  void watchedToggled(int videoId, bool watched);
+
+private:
+  // Parallel columns instead of a Video struct per row: ids and flags stay
+  // contiguous, paths are handles into one PathStore rooted at the
+  // playlist folder (rows removed by a delta leave their name behind until
+  // the next setPlaylist()).
+  int currentPlaylistId = -1;
+  PathStore pathStore;
+  QVector<int> ids; // same order as ORDER BY sortKey, videoID
+  QByteArray pageEndKey; // last row fetched; the next page starts after it
+  int pageEndId = -1;    // -1: nothing fetched yet
+  QVector<PathStore::Handle> paths;
+  QVector<quint8> watched;
+  QVector<qint64> durations; // ms; -1 not probed yet or unreadable
+  bool allFetched = true;
+  ThumbnailService *thumbnails = nullptr;
+  int thumbnailWidth = 0;
+
+  mutable QHash<int, int> rowIndex; // videoID -> row, rebuilt on demand
+
+  // A row applyDelta() puts in
+  struct NewRow {
+    QByteArray key;
+    Video vdo;
+    qint64 durationMs;
+  };
+
+  int rowOf(int videoId) const; // -1 if not loaded
+  // Row a (sortKey, videoID) pair belongs at; rowCount() when past the
+  // end. Recomputes the keys of the rows it probes (O(log n) of them).
+  int insertPosition(const QByteArray &key, int videoId) const;
+  // One begin/end pair and one shift of each column per run of rows
+  void insertVideoRows(int row, const QVector<NewRow> &rows, int from,
+                       int count);
+  void removeVideoRows(int first, int last);
+};
+
+#endif // VIDEOTABLEMODEL_H
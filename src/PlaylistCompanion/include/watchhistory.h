@@ -0,0 +1,66 @@
+#ifndef WATCHHISTORY_H
+#define WATCHHISTORY_H
+
+#include <QDate>
+#include <QDebug>
+#include <QFuture>
+#include <QString>
+#include <QVector>
+#include <include/dbwriter.h>
+
+#define historydebug qDebug() << "[WatchHistory] "
+
+// One day / week (by its Monday) of the rollups
+struct WatchPeriod {
+  QDate start;
+  qint64 secondsWatched = 0;
+  int videosFinished = 0;
+  int sessions = 0;
+};
+
+struct PlaylistWatchTotal {
+  int playlistId = -1;
+  QString playlistTitle; // empty once the playlist was removed
+  qint64 secondsWatched = 0;
+  int videosFinished = 0;
+  int sessions = 0;
+};
+
+struct WatchStats {
+  QVector<WatchPeriod> days;  // last kDays, only those with events
+  QVector<WatchPeriod> weeks; // last kWeeks, same
+  QVector<PlaylistWatchTotal> playlists; // most watched first
+  int currentStreak = 0; // days in a row up to today or yesterday
+  int longestStreak = 0;
+};
+
+// Watch statistics from the tables of schema step 10. Events go into the
+// append-only WatchEvent log; its trigger keeps the rollups (per day, per
+// week, per playlist, the streak) up to date, which is all that is read
+// here: a few hundred rows at most, however long the history is.
+// Watched / unwatched events come from the Video.isWatched trigger;
+// player sessions are recorded by PlayerController.
+class WatchHistory {
+
+public:
+  static constexpr int kDays = 30;
+  static constexpr int kWeeks = 12;
+
+  // Seconds actually played in one player session, queued on the DbWriter;
+  // resolves once committed (an empty future if there was nothing to add)
+  static QFuture<WriteResult> recordSession(int playlistId, int videoId,
+                                            int seconds);
+
+  // Rollups on the calling thread's read connection
+  static WatchStats load();
+  // Plain-text report for the statistics box
+  static QString summary(const WatchStats &stats);
+
+  // "2 h 05 min" / "12 min"
+  static QString formatSeconds(qint64 seconds);
+
+private:
+  static QVector<WatchPeriod> loadPeriods(const char *sql, const QDate &from);
+};
+
+#endif // WATCHHISTORY_H
@@ -1,24 +1,61 @@
 #include "mainwindow.h"
+#include "include/backupstore.h"
+#include "include/dbwriter.h"
+#include "include/headlesscli.h"
+#include "include/startuptrace.h"
 
 #include <QApplication>
 #include <QLocale>
+#include <QTimer>
 #include <QTranslator>
 
 
 int main(int argc, char *argv[])
 {
-    QApplication a(argc, argv);
+    StartupTrace::start();
 
-    QTranslator translator;
-    const QStringList uiLanguages = QLocale::system().uiLanguages();
-    for (const QString &locale : uiLanguages) {
-        const QString baseName = "PlaylistCompanion_" + QLocale(locale).name();
-        if (translator.load(":/i18n/" + baseName)) {
-            a.installTranslator(&translator);
-            break;
-        }
+    // "PlaylistCompanion import <dir...>" and the other commands: no
+    // widgets, so it runs without a display (servers, scripts, cron)
+    if (HeadlessCli::wants(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        HeadlessCli cli;
+        const int exitCode = cli.run(app.arguments());
+        BackupStore::shutdown();
+        DbWriter::shutdown();
+        return exitCode;
     }
+
+    QApplication a(argc, argv);
+    // Per-phase milliseconds on stdout once the first playlist is shown
+    StartupTrace::setEnabled(a.arguments().contains("--startup-trace"));
+    StartupTrace::phase("qt init");
+
+    // The window shows first; playlists, settings and the video list are
+    // loaded after its first paint (MainWindow::startDeferredInit)
     MainWindow w;
+    StartupTrace::phase("main window");
     w.show();
-    return a.exec();
+    StartupTrace::phase("show");
+
+    // Looked up once the event loop runs; installing it sends LanguageChange
+    // and the open windows retranslate themselves
+    QTranslator translator;
+    QTimer::singleShot(0, &a, [&a, &translator]() {
+        const QStringList uiLanguages = QLocale::system().uiLanguages();
+        for (const QString &locale : uiLanguages) {
+            const QString baseName = "PlaylistCompanion_" + QLocale(locale).name();
+            if (translator.load(":/i18n/" + baseName)) {
+                a.installTranslator(&translator);
+                break;
+            }
+        }
+        StartupTrace::phase("translator");
+    });
+    const int exitCode = a.exec();
+
+    // Let a running snapshot finish, then commit whatever is still queued
+    // before the process goes away
+    BackupStore::shutdown();
+    DbWriter::shutdown();
+    return exitCode;
 }
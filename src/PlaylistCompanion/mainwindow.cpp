@@ -1,23 +1,238 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include <QFileDialog>
+#include <QHeaderView>
+#include <QListWidget>
+#include <QScrollBar>
 #include <QMessageBox>
 #include <QFileInfo>
 #include <QDebug>
+#include <QSignalBlocker>
+#include <QtConcurrent/QtConcurrentRun>
+#include <include/playerdiscovery.h>
+#include <include/startuptrace.h>
+#include <include/tracing.h>
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow) {
   ui->setupUi(this);
-  MainWindow::dbInstance = SQliteDB::instance();
+
+  rescanner = new PlaylistRescanner(this);
+  connect(rescanner, &PlaylistRescanner::finished, this,
+          [this](int, int added, int removed) {
+            ui->rescanPlaylist->setEnabled(true);
+            ui->statusbar->showMessage(
+                QString("Rescan done: %1 added, %2 removed")
+                    .arg(added)
+                    .arg(removed),
+                5000);
+          });
+  connect(rescanner, &PlaylistRescanner::videosChanged, this,
+          &MainWindow::applyVideoDelta);
+  connect(rescanner, &PlaylistRescanner::failed, this,
+          [this](int, const QString &reason) {
+            ui->rescanPlaylist->setEnabled(true);
+            QMessageBox::warning(this, "Rescan failed", reason);
+          });
+
+  // "All Videos": a model that pages rows in, instead of a QTableWidget
+  // item per video
+  videoModel = new VideoTableModel(this);
+  ui->allVideosTableView->setModel(videoModel);
+  ui->allVideosTableView->setColumnWidth(VideoTableModel::WatchedColumn, 80);
+  ui->allVideosTableView->horizontalHeader()->setSectionResizeMode(
+      VideoTableModel::NameColumn, QHeaderView::Stretch);
+  ui->allVideosTableView->setColumnWidth(VideoTableModel::DurationColumn, 80);
+  // Fixed row height: no per-row size hints for 100k rows
+  ui->allVideosTableView->verticalHeader()->setSectionResizeMode(
+      QHeaderView::Fixed);
+  connect(videoModel, &VideoTableModel::watchedToggled, this,
+          &MainWindow::onVideoWatchedToggled);
+
+  // Thumbnails: a large one of the selected video, small ones in the list.
+  // The list only paints what is in memory; rows around the viewport are
+  // prefetched once scrolling pauses.
+  thumbnails = new ThumbnailService(this);
+  videoModel->setThumbnails(thumbnails, kListThumbWidth);
+  ui->allVideosTableView->setIconSize(
+      QSize(kListThumbWidth, kListThumbWidth * 9 / 16));
+  ui->allVideosTableView->verticalHeader()->setDefaultSectionSize(
+      kListThumbWidth * 9 / 16 + 4);
+  prefetchTimer.setSingleShot(true);
+  prefetchTimer.setInterval(50);
+  connect(&prefetchTimer, &QTimer::timeout, this,
+          &MainWindow::prefetchVisibleThumbnails);
+  const auto schedulePrefetch = [this]() { prefetchTimer.start(); };
+  connect(ui->allVideosTableView->verticalScrollBar(),
+          &QScrollBar::valueChanged, this, schedulePrefetch);
+  connect(videoModel, &VideoTableModel::rowsInserted, this, schedulePrefetch);
+  connect(videoModel, &VideoTableModel::modelReset, this, schedulePrefetch);
+  connect(ui->allVideosTableView->selectionModel(),
+          &QItemSelectionModel::currentRowChanged, this,
+          &MainWindow::showCurrentVideo);
+  connect(thumbnails, &ThumbnailService::thumbnailReady, this,
+          [this](const QString &path, int width) {
+            if (width == kListThumbWidth)
+              ui->allVideosTableView->viewport()->update();
+            else if (path == shownVideoPath)
+              showThumbnail(thumbnails->cached(path, width), false);
+          });
+
+  // Durations come from the container headers, read on a pool; totals
+  // are summed by the Video triggers as each batch commits
+  prober = new MetadataProber(this);
+  connect(prober, &MetadataProber::durationsStored, this,
+          [this](int playlistId, const QHash<int, qint64> &durations) {
+            videoModel->applyDurations(playlistId, durations);
+            refreshPlaylistProgress(playlistId);
+          });
+  connect(prober, &MetadataProber::progress, this,
+          [this](int, int probed, int total) {
+            ui->statusbar->showMessage(
+                QString("Reading video durations... %1/%2")
+                    .arg(probed)
+                    .arg(total),
+                3000);
+          });
+
+  // Search of all playlists while typing: debounced, run on the global
+  // pool (FTS5 through a read connection), one at a time
+  searchTimer.setSingleShot(true);
+  searchTimer.setInterval(80);
+  connect(&searchTimer, &QTimer::timeout, this, &MainWindow::runSearch);
+  connect(ui->searchEdit, &QLineEdit::textChanged, this,
+          [this]() { searchTimer.start(); });
+  connect(ui->searchEdit, &QLineEdit::returnPressed, this, [this]() {
+    if (ui->searchResults->count() > 0)
+      openSearchHit(ui->searchResults->item(0));
+  });
+  connect(&searchWatcher, &QFutureWatcher<QVector<SearchHit>>::finished,
+          this, &MainWindow::showSearchResults);
+  connect(ui->searchResults, &QListWidget::itemActivated, this,
+          &MainWindow::openSearchHit);
+  connect(ui->searchResults, &QListWidget::itemClicked, this,
+          &MainWindow::openSearchHit);
+
+  // "Play this video": resume positions and watched marks come back from
+  // mpv / VLC while they play
+  player = new PlayerController(this);
+  connect(player, &PlayerController::watchedReached, this,
+          &MainWindow::onWatchedReached);
+  connect(player, &PlayerController::sessionRecorded, this,
+          &MainWindow::refreshPlaylistProgress);
+  connect(player, &PlayerController::failed, this,
+          [this](const QString &reason) {
+            QMessageBox::warning(this, "Can not play", reason);
+          });
+
+  folderWatcher = new FolderWatcher(this);
+  connect(folderWatcher, &FolderWatcher::videosChanged, this,
+          &MainWindow::applyVideoDelta);
+
+  // A search running into a restore reads the old data; its hits are
+  // dropped by the new search onDatabaseReplaced() starts
+  connect(DbEvents::instance(), &DbEvents::aboutToReplaceDatabase, this,
+          [this]() { searchWatcher.waitForFinished(); });
+  connect(DbEvents::instance(), &DbEvents::databaseReplaced, this,
+          &MainWindow::onDatabaseReplaced);
+
+  // Skeleton until the catalog is read: the first frame costs the same
+  // with 10 playlists or 10 000 (startDeferredInit after it)
+  ui->playlistList->setEnabled(false);
+  ui->playlistList->setPlaceholderText("Loading playlists...");
+  ui->editPlaylistButton->setEnabled(false);
+  ui->removePlaylist->setEnabled(false);
+  ui->rescanPlaylist->setEnabled(false);
+  // Everything else that reads the database waits for it to be open
+  ui->createNewPlaylist->setEnabled(false);
+  ui->pushButton_3->setEnabled(false);
+  ui->playThisVdo->setEnabled(false);
+  ui->searchEdit->setEnabled(false);
+  ui->actionWatchStatistics->setEnabled(false);
+  ui->statusbar->showMessage("Loading library...");
+  connect(&openWatcher, &QFutureWatcher<bool>::finished, this,
+          &MainWindow::onDatabaseOpened);
+}
+
+bool MainWindow::event(QEvent *e) {
+  const bool handled = QMainWindow::event(e);
+  // UpdateRequest paints the whole window into its backing store
+  if (!firstPaintDone && e->type() == QEvent::UpdateRequest) {
+    firstPaintDone = true;
+    StartupTrace::phase("first paint");
+    QTimer::singleShot(0, this, &MainWindow::startDeferredInit);
+  }
+  return handled;
+}
+
+void MainWindow::changeEvent(QEvent *e) {
+  if (e->type() == QEvent::LanguageChange)
+    ui->retranslateUi(this);
+  QMainWindow::changeEvent(e);
+}
+
+void MainWindow::startDeferredInit() {
+  // 1. Open the file and run pending migrations on the pool. An upgrade
+  //    that rewrites every row (sort keys, search index, relative paths)
+  //    runs behind the skeleton instead of before the first frame.
+  openWatcher.setFuture(QtConcurrent::run([this]() {
+    return SQliteDB::upgradeDatabase(
+        [this](int version, const QString &description) {
+          QMetaObject::invokeMethod(this, [this, version, description]() {
+            ui->statusbar->showMessage(
+                QString("Upgrading library (%1 of %2): %3...")
+                    .arg(version)
+                    .arg(SQliteDB::kSchemaVersion)
+                    .arg(description));
+          });
+        });
+  }));
+}
+
+void MainWindow::onDatabaseOpened() {
+  StartupTrace::phase("open + migrate");
+  if (!openWatcher.result()) {
+    // Logged by SQliteDB; the window stays as it is
+    ui->statusbar->showMessage("The library could not be opened.");
+    ui->playlistList->setPlaceholderText("No library");
+    return;
+  }
+  // Main connection; the schema is current, so this only opens the file
+  dbInstance = SQliteDB::instance();
+  StartupTrace::phase("database");
+  ui->statusbar->showMessage("Loading library...");
+  ui->createNewPlaylist->setEnabled(true);
+  ui->pushButton_3->setEnabled(true);
+  ui->playThisVdo->setEnabled(true);
+  ui->searchEdit->setEnabled(true);
+  ui->actionWatchStatistics->setEnabled(true);
+
+  // 2. One row of General: default player, what was open last time
   initGeneralSettings();
-  MainWindow::updatePlaylistListCombo();
-  MainWindow::populateVideoTable(MainWindow::lastWatchedPlId);
+  StartupTrace::phase("general settings");
+  // 3. Hourly snapshots into the backup store (only the changed chunks)
+  BackupStore::instance()->setAutoBackupInterval(
+      BackupStore::loadPolicy().autoBackupHours);
+  StartupTrace::phase("backup policy");
+  // 4. Installed players, on the pool; searched only if their folders
+  //    changed since the last run. After step 2, which queues the General row.
+  PlayerDiscovery::instance()->refresh();
+  // 5. Playlists on the pool; showPlaylists() selects the last watched one
+  updatePlaylistListCombo();
 }
 
-MainWindow::~MainWindow() { delete ui; }
+MainWindow::~MainWindow() {
+  openWatcher.waitForFinished();
+  searchWatcher.waitForFinished();
+  if (dbInstance)
+    dbInstance->logStatementStats();
+  delete ui;
+}
 
 void MainWindow::on_pushButton_3_clicked() {
     settingsWidgt = new Settings();
+    settingsWidgt->setThumbnails(thumbnails);
     // 2. Set Modality: This disables the MainWindow while Settings is open
     settingsWidgt->setWindowModality(Qt::ApplicationModal);
     // 3. (Optional) Make sure it deletes itself from memory when closed
@@ -69,13 +284,16 @@ void MainWindow::on_removePlaylist_clicked() {
         "Are you sure you want to delete this playlist and all its videos?",
         QMessageBox::Yes | QMessageBox::No);
     if (reply == QMessageBox::Yes) {
+      DbWriter *writer = DbWriter::instance();
+      folderWatcher->unwatch(playlistId);
       // Delete videos associated with the playlist
-      dbInstance->execQuery(
-          QString("DELETE FROM Video WHERE playlistID = %1").arg(playlistId));
-      // Delete the playlist itself
-      dbInstance->execQuery(
-          QString("DELETE FROM Playlist WHERE playlistId = %1").arg(playlistId));
-      updatePlaylistListCombo();
+      writer->enqueue("DELETE FROM Video WHERE playlistID = ?", {playlistId});
+      writer->enqueue("DELETE FROM DirFingerprint WHERE playlistID = ?",
+                      {playlistId});
+      // Delete the playlist itself; reload once all three are committed
+      writer
+          ->enqueue("DELETE FROM Playlist WHERE playlistId = ?", {playlistId})
+          .then(this, [this](const WriteResult &) { updatePlaylistListCombo(); });
     }
   } else {
     QMessageBox::warning(this, "No playlist selected",
@@ -83,6 +301,20 @@ void MainWindow::on_removePlaylist_clicked() {
   }
 }
 
+void MainWindow::on_rescanPlaylist_clicked() {
+  int playlistId = ui->playlistList->currentData().toInt();
+  for (const auto &pl : listOfPlaylists) {
+    if (pl.playlistId == playlistId) {
+      // Only changed folders are listed again; watched state is kept
+      if (rescanner->rescan(playlistId, pl.playlistPath)) {
+        ui->rescanPlaylist->setEnabled(false);
+        ui->statusbar->showMessage("Rescanning " + pl.playlistTitle + "...");
+      }
+      return;
+    }
+  }
+}
+
 void MainWindow::initGeneralSettings() {
   // 1. Determine the current Operating System
   // The DB schema 'General' table has a CHECK constraint: OS IN ('Windows',
@@ -99,9 +331,9 @@ void MainWindow::initGeneralSettings() {
 
   // 2. Attempt to fetch existing data
   // We only select the columns we need. ID is always 1.
-  QString q = "SELECT defaultMediaPlayer, lastWatchedPlId, lastWatchedVdoId "
-              "FROM General WHERE id = 1";
-  QSqlQuery query = dbInstance->execQuery(q);
+  QSqlQuery query = dbInstance->execPrepared(
+      "SELECT defaultMediaPlayer, lastWatchedPlId, lastWatchedVdoId "
+      "FROM General WHERE id = 1");
 
   if (query.next()) {
     // --- DATA FOUND: Load into variables ---
@@ -111,6 +343,7 @@ void MainWindow::initGeneralSettings() {
     // Since IDs are AUTOINCREMENT (starting at 1), 0 is a safe "empty" state.
     lastWatchedPlId = query.value("lastWatchedPlId").toInt();
     lastWatchedVdoId = query.value("lastWatchedVdoId").toInt();
+    query.finish(); // single row, release the cached statement
 
     qDebug() << "[MainWindow] Settings Loaded: " << defaultMediaPlayer
              << " | Last Playlist ID:" << lastWatchedPlId;
@@ -120,12 +353,9 @@ void MainWindow::initGeneralSettings() {
     // The table has a constraint CHECK(id = 1), so we explicitly set id=1.
     // We use the determined currentOS.
 
-    QString insertQ =
-        QString("INSERT INTO General (id, OS, defaultMediaPlayer) "
-                "VALUES (1, '%1', '')")
-            .arg(currentOS);
-
-    dbInstance->execQuery(insertQ);
+    DbWriter::instance()->enqueue(
+        "INSERT INTO General (id, OS, defaultMediaPlayer) VALUES (1, ?, '')",
+        {currentOS});
 
     // Initialize local variables to defaults
     defaultMediaPlayer = "";
@@ -135,24 +365,31 @@ void MainWindow::initGeneralSettings() {
     qDebug()
         << "[MainWindow] General info was empty. Initialized defaults for OS:"
         << currentOS;
-    MainWindow::on_pushButton_3_clicked();
+    // First run: Settings (and its player lookup) once startup is done
+    QTimer::singleShot(0, this, &MainWindow::on_pushButton_3_clicked);
   }
 
 }
 
 void MainWindow::updatePlaylistListCombo() {
-    QComboBox* combo = ui->playlistList;
-
-    // 2. Clear previous data to avoid duplicates
-    listOfPlaylists.clear();
-    combo->clear();
+    // 1. Read on the pool (its own read connection); the window stays
+    //    responsive however many playlists there are
+    const int load = ++playlistLoads;
+    QtConcurrent::run(&MainWindow::loadPlaylists)
+        .then(this, [this, load](const QVector<Playlist> &playlists) {
+            if (load == playlistLoads) // a newer reload is on its way
+                showPlaylists(playlists);
+        });
+}
 
-    // 3. Execute Query to fetch all playlists
+QVector<Playlist> MainWindow::loadPlaylists() {
+    // 2. Execute Query to fetch all playlists
     // We select all columns to populate the full struct
-    QString q = "SELECT * FROM Playlist ORDER BY playlistId ASC";
-    QSqlQuery query = dbInstance->execQuery(q);
+    QVector<Playlist> playlists;
+    QSqlQuery query = SQliteDB::instance()->execRead(
+        "SELECT * FROM Playlist ORDER BY playlistId ASC");
 
-    // 4. Iterate through results
+    // 3. Iterate through results
     while (query.next()) {
         Playlist pl;
 
@@ -166,85 +403,336 @@ void MainWindow::updatePlaylistListCombo() {
         pl.totalVideoCount = query.value("totalVideoCount").toInt();
         pl.watchedCount = query.value("watchedCount").toInt();
         pl.totalTimeHour = query.value("totalTimeHour").toInt();
+        pl.totalDurationMs = query.value("totalDurationMs").toLongLong();
 
         // Retrieve Dates
         pl.creationDateTime = query.value("creationDateTime").toString();
         pl.lastWatchedDateTime = query.value("lastWatchedDateTime").toString();
+        pl.watchFolder = query.value("watchFolder").toInt();
         // -------------------------------
 
-        // 5. Add to the member vector
-        listOfPlaylists.append(pl);
+        playlists.append(pl);
+    }
+    return playlists;
+}
 
-        // 6. Add to the UI ComboBox
+void MainWindow::showPlaylists(const QVector<Playlist> &playlists) {
+    QComboBox* combo = ui->playlistList;
+    StartupTrace::phase("playlists read");
+    PLC_TRACE_SPAN(span, "ui.playlists");
+    PLC_TRACE_ROWS(span, playlists.size());
+
+    // 4. Replace previous data; the selection handler runs once, below,
+    //    not for every item added
+    listOfPlaylists = playlists;
+    {
+        const QSignalBlocker blocker(combo);
+        combo->clear();
         // Argument 1: Text to display (Title)
         // Argument 2: UserData (The ID, hidden) - useful for retrieving the specific playlist later
-        combo->addItem(pl.playlistTitle, pl.playlistId);
-    }
-
-    // 7. (Optional) Auto-select the last watched playlist
-    // 'lastWatchedPlId' was loaded in initGeneralSettings()
-    if (lastWatchedPlId != -1) {
-        int index = combo->findData(lastWatchedPlId);
-        if (index != -1) {
-            combo->setCurrentIndex(index);
+        for (const auto &pl : std::as_const(listOfPlaylists))
+            combo->addItem(pl.playlistTitle, pl.playlistId);
+
+        // 5. Auto-select the last watched playlist
+        // 'lastWatchedPlId' was loaded in initGeneralSettings()
+        if (lastWatchedPlId != -1) {
+            int index = combo->findData(lastWatchedPlId);
+            if (index != -1) {
+                combo->setCurrentIndex(index);
+            }
         }
     }
+    combo->setEnabled(true);
+    combo->setPlaceholderText("No playlists yet");
+    on_playlistList_currentIndexChanged(combo->currentIndex());
+
+    // 6. First page of its videos now, not on the next layout
+    if (videoModel->canFetchMore(QModelIndex()))
+        videoModel->fetchMore(QModelIndex());
+    if (!catalogShown) {
+        catalogShown = true;
+        StartupTrace::phase("first video page");
+        StartupTrace::finish();
+        ui->statusbar->clearMessage(); // "Loading library..."
+    }
 
     qDebug() << "[MainWindow] Playlist combo refreshed. Count:" << listOfPlaylists.size();
+    syncFolderWatches();
+
+    // Files added since the last run (or a new playlist) still lack their
+    // duration; playlists without such files cost one index lookup
+    for (const auto &pl : std::as_const(listOfPlaylists))
+        prober->enqueue(pl.playlistId);
+}
+
+void MainWindow::syncFolderWatches() {
+  // Start / stop live watching to match the per-playlist opt-in flag
+  QSet<int> wanted;
+  for (const auto &pl : listOfPlaylists) {
+    if (pl.watchFolder) {
+      wanted.insert(pl.playlistId);
+      folderWatcher->watch(pl.playlistId, pl.playlistPath);
+    }
+  }
+  // Also those whose playlist is gone (removed, or not in a restored file)
+  for (int playlistId : folderWatcher->watchedPlaylists()) {
+    if (!wanted.contains(playlistId))
+      folderWatcher->unwatch(playlistId);
+  }
 }
 
 void MainWindow::populateVideoTable(int playlistId) {
-    // 1. Clear existing data
-    currentVideoList.clear();
-    ui->allVideosTableWidget->setRowCount(0);
+    // Rows are paged in by the model while the view scrolls, so this only
+    // drops the old playlist; the first page is read on the next layout.
+    videoModel->setPlaylist(playlistId);
+}
 
-    // 2. Setup Table Headers (if not done in UI designer)
-    // Column 0: Watched Status, Column 1: Video Name
-    ui->allVideosTableWidget->setColumnCount(2);
-    ui->allVideosTableWidget->setHorizontalHeaderLabels(QStringList() << "Watched" << "Video Name");
+void MainWindow::onVideoWatchedToggled(int videoId, bool watched) {
+    // The Video triggers adjust watchedCount and status in the same commit
+    const int playlistId = videoModel->playlistId();
+    DbWriter::instance()
+        ->enqueue("UPDATE Video SET isWatched = ? WHERE videoID = ?",
+                  {watched ? 1 : 0, videoId})
+        .then(this, [this, playlistId](const WriteResult &) {
+          refreshPlaylistProgress(playlistId);
+        });
+}
 
-    // Adjust column widths (Status column small, Name column stretches)
-    ui->allVideosTableWidget->setColumnWidth(0, 80);
-    ui->allVideosTableWidget->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
+void MainWindow::onWatchedReached(int playlistId, int videoId) {
+  // Through the model when the row is loaded, so the checkbox follows
+  if (playlistId == videoModel->playlistId() &&
+      videoModel->setWatched(videoId, true))
+    return;
+  DbWriter::instance()
+      ->enqueue("UPDATE Video SET isWatched = ? WHERE videoID = ?",
+                {1, videoId})
+      .then(this, [this, playlistId](const WriteResult &) {
+        refreshPlaylistProgress(playlistId);
+      });
+}
 
-    // 3. Prepare Query
-    // We fetch videos only for the selected playlist
-    QString q = QString("SELECT * FROM Video WHERE playlistID = %1 ORDER BY videoID ASC").arg(playlistId);
-    QSqlQuery query = dbInstance->execQuery(q);
+void MainWindow::on_playThisVdo_clicked() {
+  const int row = ui->allVideosTableView->currentIndex().row();
+  Video vdo{};
+  vdo.videoID = videoModel->videoIdAt(row);
+  if (vdo.videoID < 0) {
+    ui->statusbar->showMessage("Select a video to play", 3000);
+    return;
+  }
+  vdo.playlistID = videoModel->playlistId();
+  vdo.videoPath = videoModel->videoPathAt(row);
+
+  // 1. Where it was left, and its length for the watched mark
+  qint64 durationMs = 0;
+  QSqlQuery saved = dbInstance->execPrepared(
+      "SELECT resumeTime, durationMs FROM Video WHERE videoID = ?",
+      {vdo.videoID});
+  if (saved.next()) {
+    vdo.resumeTime = saved.value(0).toInt();
+    durationMs = saved.value(1).toLongLong();
+  }
+  saved.finish();
+
+  // 2. The default player may have been changed in Settings since startup
+  QSqlQuery general = dbInstance->execPrepared(
+      "SELECT defaultMediaPlayer FROM General WHERE id = 1");
+  if (general.next())
+    defaultMediaPlayer = general.value(0).toString();
+  general.finish();
+
+  if (!player->play(defaultMediaPlayer, vdo, durationMs))
+    return;
+  lastWatchedVdoId = vdo.videoID;
+  DbWriter::instance()->enqueue(
+      "UPDATE General SET lastWatchedVdoId = ? WHERE id = 1", {vdo.videoID});
+}
 
-    int row = 0;
-    while (query.next()) {
-        Video vdo;
-        vdo.videoID = query.value("videoID").toInt();
-        vdo.playlistID = query.value("playlistID").toInt();
-        vdo.videoPath = query.value("videoPath").toString();
-        vdo.isWatched = query.value("isWatched").toInt();
+void MainWindow::on_actionWatchStatistics_triggered() {
+  // Rollup rows only, the event log is never read
+  QMessageBox::information(this, "Watch Statistics",
+                           WatchHistory::summary(WatchHistory::load()));
+}
 
-        // Add to local memory vector
-        currentVideoList.append(vdo);
+void MainWindow::refreshPlaylistProgress(int playlistId) {
+  // One row by primary key; the triggers keep it exact
+  QSqlQuery counts = dbInstance->execPrepared(
+      "SELECT totalVideoCount, watchedCount, status, totalDurationMs, "
+      "lastWatchedDateTime FROM Playlist WHERE playlistId = ?",
+      {playlistId});
+  if (!counts.next())
+    return;
+  const int total = counts.value(0).toInt();
+  const int watched = counts.value(1).toInt();
+  const QString status = counts.value(2).toString();
+  const qint64 durationMs = counts.value(3).toLongLong();
+  const QString lastWatched = counts.value(4).toString(); // watch history
+  counts.finish();
+
+  Playlist *current = nullptr;
+  for (auto &pl : listOfPlaylists) {
+    if (pl.playlistId == playlistId) {
+      pl.totalVideoCount = total;
+      pl.watchedCount = watched;
+      pl.status = status;
+      pl.totalDurationMs = durationMs;
+      pl.lastWatchedDateTime = lastWatched;
+      current = &pl;
+      break;
+    }
+  }
 
-        // --- UI POPULATION ---
-        ui->allVideosTableWidget->insertRow(row);
+  if (playlistId != ui->playlistList->currentData().toInt())
+    return;
+  ui->progressBar->setValue(total > 0 ? (watched * 100) / total : 0);
+  ui->playlistProgressCount->setText(QString("%1/%2").arg(watched).arg(total));
+  ui->lastWatched->setText(lastWatched);
+  if (current)
+    ui->totalTime->setText(totalTimeText(*current));
+}
 
-        // Col 0: Watched Status (Checkbox)
-        QTableWidgetItem *statusItem = new QTableWidgetItem();
-        statusItem->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-        // BUG: user checkbox e check kore data change kortese but database e save hocche na
-        statusItem->setCheckState(vdo.isWatched ? Qt::Checked : Qt::Unchecked); // Set Checkbox state based on DB value
-        statusItem->setData(Qt::UserRole, vdo.videoID); // Store the videoID in the item so we can identify it later if clicked
+QString MainWindow::totalTimeText(const Playlist &pl) {
+  // Exact sum of the probed files; the hand-entered hours until then
+  if (pl.totalDurationMs <= 0)
+    return QString::number(pl.totalTimeHour) + " hours";
+  const qint64 minutes = (pl.totalDurationMs + 30000) / 60000;
+  if (minutes < 60)
+    return QString("%1 min").arg(minutes);
+  return QString("%1 h %2 min").arg(minutes / 60).arg(minutes % 60);
+}
 
-        ui->allVideosTableWidget->setItem(row, 0, statusItem);
+void MainWindow::onDatabaseReplaced() {
+  // Everything read from the old file is stale: settings, listOfPlaylists
+  // (and the folder watches built from it), the loaded video rows. The
+  // model starts over and pages in from the restored file.
+  const int shownPlaylistId = ui->playlistList->currentData().toInt();
+  initGeneralSettings();
+  if (shownPlaylistId > 0)
+    lastWatchedPlId = shownPlaylistId; // stays selected if it still exists
+  BackupStore::instance()->setAutoBackupInterval(
+      BackupStore::loadPolicy().autoBackupHours);
+  videoModel->setPlaylist(-1);
+  // Refilling the combo selects a playlist again, which reloads the rows
+  updatePlaylistListCombo();
+  // Hits of the old file may point at rows that are gone
+  searchTimer.start();
+  ui->statusbar->showMessage("Database restored", 5000);
+}
 
-        // Col 1: Video Name (Clean display)
-        QFileInfo fileInfo(vdo.videoPath);
-        QTableWidgetItem *nameItem = new QTableWidgetItem(fileInfo.fileName());
-        // Make it read-only (user can't rename file here)
-        nameItem->setFlags(nameItem->flags() ^ Qt::ItemIsEditable);
+void MainWindow::prefetchVisibleThumbnails() {
+  const QTableView *view = ui->allVideosTableView;
+  const int rows = videoModel->rowCount();
+  if (rows == 0)
+    return;
+  int first = view->rowAt(0);
+  int last = view->rowAt(view->viewport()->height() - 1);
+  if (first < 0)
+    first = 0;
+  if (last < 0)
+    last = rows - 1;
+
+  // Visible rows first, then the ones below (scrolling down is the common
+  // case), then above; the pool works through them in this order
+  QStringList paths;
+  for (int row = first; row <= last; ++row)
+    paths.append(videoModel->videoPathAt(row));
+  for (int row = last + 1; row < qMin(rows, last + 1 + kPrefetchMargin); ++row)
+    paths.append(videoModel->videoPathAt(row));
+  for (int row = first - 1; row >= qMax(0, first - kPrefetchMargin); --row)
+    paths.append(videoModel->videoPathAt(row));
+  thumbnails->prefetch(paths, kListThumbWidth);
+}
 
-        ui->allVideosTableWidget->setItem(row, 1, nameItem);
+void MainWindow::showCurrentVideo(const QModelIndex &current) {
+  shownVideoPath = videoModel->videoPathAt(current.row());
+  if (shownVideoPath.isEmpty()) {
+    ui->currentVideoTitle->clear();
+    ui->currentVideoThumbnail->clear();
+    return;
+  }
+  ui->currentVideoTitle->setText(
+      shownVideoPath.mid(shownVideoPath.lastIndexOf('/') + 1));
+  const QPixmap pixmap = thumbnails->request(shownVideoPath, kLabelThumbWidth);
+  showThumbnail(pixmap, !thumbnails->hasNoThumbnail(shownVideoPath));
+}
 
-        row++;
-    }
+void MainWindow::showThumbnail(const QPixmap &pixmap, bool loading) {
+  if (!pixmap.isNull())
+    ui->currentVideoThumbnail->setPixmap(pixmap);
+  else
+    ui->currentVideoThumbnail->setText(loading ? "Loading..." : "No preview");
+}
+
+void MainWindow::runSearch() {
+  // showSearchResults() starts the next one if the text changed meanwhile
+  if (searchWatcher.isRunning())
+    return;
+  const QString text = ui->searchEdit->text();
+  searchedText = text;
+  if (VideoSearch::matchExpression(text).isEmpty()) {
+    ui->searchResults->clear();
+    ui->searchResults->hide();
+    return;
+  }
+  searchWatcher.setFuture(
+      QtConcurrent::run([text]() { return VideoSearch::search(text); }));
+}
+
+void MainWindow::showSearchResults() {
+  if (ui->searchEdit->text() != searchedText) {
+    runSearch(); // typed on while it ran
+    return;
+  }
+
+  QListWidget *list = ui->searchResults;
+  list->clear();
+  const QVector<SearchHit> hits = searchWatcher.result();
+  for (const SearchHit &hit : hits) {
+    const QString kind = hit.noteId >= 0 ? "Note: " : QString();
+    auto *item = new QListWidgetItem(
+        QString("%1%2  (%3)").arg(kind, hit.title, hit.playlistTitle), list);
+    item->setToolTip(hit.detail);
+    item->setData(kHitPlaylistRole, hit.playlistId);
+    item->setData(kHitVideoRole, hit.videoId);
+  }
+  if (hits.isEmpty()) {
+    auto *item = new QListWidgetItem("No matches", list);
+    item->setFlags(Qt::NoItemFlags);
+  }
+  list->show();
+}
+
+void MainWindow::openSearchHit(QListWidgetItem *item) {
+  const int playlistId = item->data(kHitPlaylistRole).toInt();
+  const int index = ui->playlistList->findData(playlistId);
+  if (playlistId <= 0 || index < 0)
+    return;
+  // Reloads the rows when it is another playlist
+  ui->playlistList->setCurrentIndex(index);
+
+  const int videoId = item->data(kHitVideoRole).toInt();
+  if (videoId <= 0)
+    return; // a note on the playlist itself
+  const int row = videoModel->fetchUntil(videoId);
+  if (row < 0)
+    return;
+  const QModelIndex target =
+      videoModel->index(row, VideoTableModel::NameColumn);
+  ui->allVideosTableView->setCurrentIndex(target);
+  ui->allVideosTableView->scrollTo(target,
+                                   QAbstractItemView::PositionAtCenter);
+}
+
+void MainWindow::applyVideoDelta(const VideoDelta &delta) {
+  // 1. Rows: removed, renamed in place, added at their sorted position
+  if (delta.playlistId == ui->playlistList->currentData().toInt())
+    videoModel->applyDelta(delta);
+
+  // 2. Counters of that playlist (labels only if it is the visible one)
+  refreshPlaylistProgress(delta.playlistId);
+
+  // 3. New files have no duration yet
+  if (!delta.added.isEmpty())
+    prober->enqueue(delta.playlistId);
 }
 
 void MainWindow::on_playlistList_currentIndexChanged(int index) {
@@ -256,6 +744,7 @@ void MainWindow::on_playlistList_currentIndexChanged(int index) {
   bool isValidPlaylist = playlistId > 0;
   ui->editPlaylistButton->setEnabled(isValidPlaylist);
   ui->removePlaylist->setEnabled(isValidPlaylist);
+  ui->rescanPlaylist->setEnabled(isValidPlaylist && !rescanner->isRunning());
 
   if (isValidPlaylist) { // -1 or 0 usually indicates invalid ID or "Select
                            // Playlist..." placeholder
@@ -274,25 +763,15 @@ void MainWindow::on_playlistList_currentIndexChanged(int index) {
     // Now update the UI elements
     ui->playlistCreationDate->setText(currentPlaylist.creationDateTime);
     ui->lastWatched->setText(currentPlaylist.lastWatchedDateTime);
-    ui->totalTime->setText(QString::number(currentPlaylist.totalTimeHour) +
-                           " hours");
-
-    // Progress bar and count
-    if (currentPlaylist.totalVideoCount > 0) {
-      int progress =
-          (currentPlaylist.watchedCount * 100) / currentPlaylist.totalVideoCount;
-      ui->progressBar->setValue(progress);
-    } else {
-      ui->progressBar->setValue(0);
-    }
-    ui->playlistProgressCount->setText(QString("%1/%2")
-                                           .arg(currentPlaylist.watchedCount)
-                                           .arg(currentPlaylist.totalVideoCount));
+    ui->totalTime->setText(totalTimeText(currentPlaylist));
+
+    // Progress bar and count: exact, trigger-maintained counters
+    refreshPlaylistProgress(playlistId);
 
     // Update 'General' table in DB so app remembers this selection next time
-    QString q = QString("UPDATE General SET lastWatchedPlId = %1 WHERE id = 1")
-                    .arg(playlistId);
-    dbInstance->execQuery(q);
+    // Write-behind, nothing waits for it
+    DbWriter::instance()->enqueue(
+        "UPDATE General SET lastWatchedPlId = ? WHERE id = 1", {playlistId});
   } else {
     // Clear the labels if no playlist is selected
     ui->playlistCreationDate->setText("");
@@ -1,11 +1,25 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QFutureWatcher>
 #include <QMainWindow>
+#include <QModelIndex>
+#include <QTimer>
 #include <QVector>
 #include <addnewplaylistwindow.h>
+#include <include/backupstore.h>
 #include <include/db_sqlite.h>
+#include <include/dbevents.h>
+#include <include/dbwriter.h>
+#include <include/folderwatcher.h>
+#include <include/metadataprober.h>
+#include <include/playercontroller.h>
+#include <include/playlistrescanner.h>
 #include <include/structures.h>
+#include <include/thumbnailservice.h>
+#include <include/videosearch.h>
+#include <include/videotablemodel.h>
+#include <include/watchhistory.h>
 #include <settings.h>
 
 QT_BEGIN_NAMESPACE
@@ -14,6 +28,8 @@ class MainWindow;
 }
 QT_END_NAMESPACE
 
+class QListWidgetItem;
+
 class MainWindow : public QMainWindow {
   Q_OBJECT
 
@@ -21,11 +37,18 @@ public:
   MainWindow(QWidget *parent = nullptr);
   ~MainWindow();
 
+protected:
+  bool event(QEvent *e) override; // first paint starts the deferred init
+  void changeEvent(QEvent *e) override; // translator installed late
+
 private slots:
   void on_pushButton_3_clicked();
   void on_editPlaylistButton_clicked();
   void on_createNewPlaylist_clicked();
   void on_removePlaylist_clicked();
+  void on_rescanPlaylist_clicked();
+  void on_playThisVdo_clicked();
+  void on_actionWatchStatistics_triggered();
   void on_playlistList_currentIndexChanged(
       int index); // Slot to handle when user selects a different playlist from
                   // the combo box
@@ -34,18 +57,54 @@ private:
   Ui::MainWindow *ui;
   int lastWatchedPlId = -1; // -1 or 0 indicates no playlist selected
   int lastWatchedVdoId = -1;
-  SQliteDB *dbInstance;
+  SQliteDB *dbInstance = nullptr; // set once the file is open and migrated
   Settings *settingsWidgt;
   AddNewPlaylistWindow *playlistWindow;
+  PlaylistRescanner *rescanner;
+  FolderWatcher *folderWatcher;
+  MetadataProber *prober; // durations of new files, in the background
+  PlayerController *player; // the player started by "Play this video"
+  ThumbnailService *thumbnails;
+  QTimer prefetchTimer; // debounces scrolling
+  QString shownVideoPath; // video in the "Video" box
+  static constexpr int kListThumbWidth = 64;
+  static constexpr int kLabelThumbWidth = 240;
+  static constexpr int kPrefetchMargin = 32; // rows above / below the view
+  QTimer searchTimer; // debounces typing in the search box
+  QFutureWatcher<QVector<SearchHit>> searchWatcher;
+  QFutureWatcher<bool> openWatcher; // SQliteDB::upgradeDatabase() on the pool
+  QString searchedText; // what the running / shown results are for
+  static constexpr int kHitPlaylistRole = Qt::UserRole;
+  static constexpr int kHitVideoRole = Qt::UserRole + 1;
   QVector<Playlist> listOfPlaylists;
-  QVector<Video> currentVideoList; // Store videos in memory for easy access
+  VideoTableModel *videoModel; // videos of the selected playlist
   QString defaultMediaPlayer;
   QString currentOS;
+  bool firstPaintDone = false;
+  bool catalogShown = false; // the first showPlaylists() ended startup
+  int playlistLoads = 0; // newest read wins when reloads overlap
 
   // --- Helper Function ---
+  void startDeferredInit(); // opens the database: after first paint
+  void onDatabaseOpened();  // settings, backups, catalog
   void initGeneralSettings();
-  void updatePlaylistListCombo();
+  void updatePlaylistListCombo(); // reads on the pool, fills when done
+  static QVector<Playlist> loadPlaylists();
+  void showPlaylists(const QVector<Playlist> &playlists);
   void populateVideoTable(
       int playlistId); // Helper function to load videos for a specific playlist
+  void onVideoWatchedToggled(int videoId, bool watched);
+  void onWatchedReached(int playlistId, int videoId); // by the player
+  void refreshPlaylistProgress(int playlistId);
+  static QString totalTimeText(const Playlist &pl);
+  void applyVideoDelta(const VideoDelta &delta); // patch rows, no reload
+  void syncFolderWatches();
+  void onDatabaseReplaced(); // hot restore: reload everything cached
+  void prefetchVisibleThumbnails();
+  void showCurrentVideo(const QModelIndex &current);
+  void showThumbnail(const QPixmap &pixmap, bool loading);
+  void runSearch();
+  void showSearchResults();
+  void openSearchHit(QListWidgetItem *item); // its playlist, then its row
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,773 @@
+#include "include/mediaprobe.h"
+
+#include <QList>
+#include <QtEndian>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+constexpr int kMaxBoxDepth = 8;
+constexpr qint64 kMaxEbmlMasterBytes = 1024 * 1024; // Info / Tracks / Seek
+constexpr int kMaxSegmentChildren = 64;             // before the clusters
+constexpr qint64 kMaxAviHeaderBytes = 256 * 1024;   // hdrl incl. indexes
+constexpr qint64 kTsWindowBytes = 512 * 1024;       // head and tail
+constexpr qint64 kPcrWrap = (qint64(1) << 33) * 300;
+constexpr qint64 kMaxCoverBytes = 16 * 1024 * 1024;
+
+quint16 be16(const char *p) { return qFromBigEndian<quint16>(p); }
+quint32 be32(const char *p) { return qFromBigEndian<quint32>(p); }
+quint64 be64(const char *p) { return qFromBigEndian<quint64>(p); }
+quint32 le32(const char *p) { return qFromLittleEndian<quint32>(p); }
+
+// --- MP4 / MOV ---
+
+// Size and header length of the box whose first 16 bytes are `head`;
+// size 0 runs to `end`. false for garbage.
+bool parseBoxHeader(const QByteArray &head, qint64 pos, qint64 end,
+                    qint64 &size, qint64 &headerSize) {
+  if (head.size() < 8)
+    return false;
+  quint64 boxSize = be32(head.constData());
+  headerSize = 8;
+  if (boxSize == 1) {
+    if (head.size() < 16)
+      return false;
+    boxSize = be64(head.constData() + 8);
+    headerSize = 16;
+  } else if (boxSize == 0) {
+    boxSize = quint64(end - pos);
+  }
+  if (boxSize < quint64(headerSize))
+    return false;
+  size = qint64(boxSize);
+  return true;
+}
+
+struct Mp4State {
+  quint32 timescale = 0;
+  quint64 duration = 0;  // in timescale units, from mvhd
+  quint64 fragmented = 0; // mehd, for fragmented files without one
+  bool haveMvhd = false;
+
+  // Current trak
+  QByteArray handler;
+  int tkhdWidth = 0, tkhdHeight = 0;
+  int sampleWidth = 0, sampleHeight = 0;
+  QString sampleCodec;
+
+  // First video trak
+  bool haveVideo = false;
+  int width = 0, height = 0;
+  QString codec;
+};
+
+// --- Matroska ---
+
+int vintLength(uchar first) {
+  for (int i = 0; i < 8; ++i) {
+    if (first & (0x80 >> i))
+      return i + 1;
+  }
+  return 0;
+}
+
+// One element header (ID keeps its marker bits, size does not)
+struct EbmlElement {
+  quint32 id = 0;
+  qint64 size = -1; // -1: unknown size (live / streamed files)
+  int headerLength = 0;
+};
+
+bool parseEbmlHeader(const char *data, qint64 available, EbmlElement &el) {
+  const auto *p = reinterpret_cast<const uchar *>(data);
+  if (available < 2)
+    return false;
+  const int idLength = vintLength(p[0]);
+  if (idLength == 0 || idLength > 4 || available <= idLength)
+    return false;
+  const int sizeLength = vintLength(p[idLength]);
+  if (sizeLength == 0 || available < idLength + sizeLength)
+    return false;
+
+  el.id = 0;
+  for (int i = 0; i < idLength; ++i)
+    el.id = (el.id << 8) | p[i];
+  const uchar mask = uchar(0xFF >> sizeLength);
+  quint64 size = p[idLength] & mask;
+  bool allOnes = size == mask;
+  for (int i = 1; i < sizeLength; ++i) {
+    size = (size << 8) | p[idLength + i];
+    allOnes = allOnes && p[idLength + i] == 0xFF;
+  }
+  el.size = allOnes ? -1 : qint64(size);
+  el.headerLength = idLength + sizeLength;
+  return true;
+}
+
+// Calls visit(id, data, size) for every child inside a loaded master
+// element; stops at the first malformed one
+void forEachEbmlChild(
+    const QByteArray &master,
+    const std::function<void(quint32, const char *, qint64)> &visit) {
+  qint64 pos = 0;
+  while (pos < master.size()) {
+    EbmlElement el;
+    if (!parseEbmlHeader(master.constData() + pos, master.size() - pos, el) ||
+        el.size < 0 || pos + el.headerLength + el.size > master.size())
+      return;
+    visit(el.id, master.constData() + pos + el.headerLength, el.size);
+    pos += el.headerLength + el.size;
+  }
+}
+
+quint64 ebmlUInt(const char *data, qint64 size) {
+  quint64 value = 0;
+  for (qint64 i = 0; i < size && i < 8; ++i)
+    value = (value << 8) | uchar(data[i]);
+  return value;
+}
+
+double ebmlFloat(const char *data, qint64 size) {
+  if (size == 4) {
+    const quint32 bits = be32(data);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  if (size == 8) {
+    const quint64 bits = be64(data);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  return 0;
+}
+
+enum : quint32 {
+  kEbmlMagic = 0x1A45DFA3,
+  kDocType = 0x4282,
+  kSegment = 0x18538067,
+  kSeekHead = 0x114D9B74,
+  kSeek = 0x4DBB,
+  kSeekId = 0x53AB,
+  kSeekPosition = 0x53AC,
+  kInfo = 0x1549A966,
+  kTimecodeScale = 0x2AD7B1,
+  kDuration = 0x4489,
+  kTracks = 0x1654AE6B,
+  kTrackEntry = 0xAE,
+  kTrackType = 0x83,
+  kCodecId = 0x86,
+  kVideo = 0xE0,
+  kPixelWidth = 0xB0,
+  kPixelHeight = 0xBA,
+  kCluster = 0x1F43B675,
+  kAttachments = 0x1941A469,
+  kAttachedFile = 0x61A7,
+  kFileName = 0x466E,
+  kFileMimeType = 0x4660,
+  kFileData = 0x465C,
+};
+
+// --- MPEG-TS ---
+
+QString tsVideoCodec(int streamType) {
+  switch (streamType) {
+  case 0x01:
+    return "mpeg1video";
+  case 0x02:
+    return "mpeg2video";
+  case 0x10:
+    return "mpeg4";
+  case 0x1B:
+    return "h264";
+  case 0x24:
+    return "hevc";
+  case 0x33:
+    return "vvc";
+  case 0xEA:
+    return "vc1";
+  default:
+    return QString();
+  }
+}
+
+struct TsState {
+  int pmtPid = -1;
+  int pcrPid = -1;
+  qint64 firstPcr = -1;
+  qint64 lastPcr = -1;
+  QString codec;
+};
+
+// Walks the packets of one window. With `head` set it also reads PAT / PMT
+// and keeps the first PCR; otherwise only the last PCR of pcrPid.
+void scanTsWindow(const QByteArray &window, int packetSize, int packetOffset,
+                  bool head, TsState &ts) {
+  const auto *buf = reinterpret_cast<const uchar *>(window.constData());
+  for (qint64 at = packetOffset; at + 188 <= window.size(); at += packetSize) {
+    const uchar *p = buf + at;
+    if (p[0] != 0x47)
+      continue; // lost sync, e.g. a torn tail
+    const int pid = ((p[1] & 0x1F) << 8) | p[2];
+    const bool unitStart = p[1] & 0x40;
+    const int adaptation = (p[3] >> 4) & 0x3;
+    int payload = 4;
+
+    if (adaptation & 0x2) {
+      const int length = p[4];
+      if (length >= 7 && (p[5] & 0x10) &&
+          (ts.pcrPid < 0 ? head : pid == ts.pcrPid)) {
+        const qint64 base = (qint64(p[6]) << 25) | (qint64(p[7]) << 17) |
+                            (qint64(p[8]) << 9) | (qint64(p[9]) << 1) |
+                            (p[10] >> 7);
+        const qint64 pcr = base * 300 + (((p[10] & 0x1) << 8) | p[11]);
+        if (ts.pcrPid < 0)
+          ts.pcrPid = pid;
+        if (head && ts.firstPcr < 0)
+          ts.firstPcr = pcr;
+        if (!head)
+          ts.lastPcr = pcr;
+      }
+      payload = 5 + length;
+    }
+    if (!head || !unitStart || !(adaptation & 0x1) || payload >= 188)
+      continue;
+
+    // PSI section behind the pointer field
+    const int section = payload + 1 + p[payload];
+    if (section + 3 > 188)
+      continue;
+    const int sectionEnd =
+        qMin(188, section + 3 + (((p[section + 1] & 0x0F) << 8) |
+                                 p[section + 2]) - 4); // minus CRC
+    if (pid == 0 && p[section] == 0x00 && ts.pmtPid < 0) {
+      for (int i = section + 8; i + 4 <= sectionEnd; i += 4) {
+        if (((p[i] << 8) | p[i + 1]) != 0) { // 0 is the network PID
+          ts.pmtPid = ((p[i + 2] & 0x1F) << 8) | p[i + 3];
+          break;
+        }
+      }
+    } else if (pid == ts.pmtPid && p[section] == 0x02 && ts.codec.isEmpty() &&
+               section + 12 <= sectionEnd) {
+      const int pcrPid = ((p[section + 8] & 0x1F) << 8) | p[section + 9];
+      if (pcrPid != 0x1FFF && ts.firstPcr < 0)
+        ts.pcrPid = pcrPid; // before any PCR was taken from another PID
+      int i = section + 12 +
+              (((p[section + 10] & 0x0F) << 8) | p[section + 11]);
+      while (i + 5 <= sectionEnd && ts.codec.isEmpty()) {
+        ts.codec = tsVideoCodec(p[i]);
+        i += 5 + (((p[i + 3] & 0x0F) << 8) | p[i + 4]);
+      }
+    }
+  }
+}
+
+} // namespace
+
+// --- Reader ---
+
+MediaProbe::Reader::Reader(const QString &path) : file(path) {
+  // Unbuffered: a seek + read is one positioned read, not a 16 KiB refill
+  if (file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    fileSize = file.size();
+}
+
+bool MediaProbe::Reader::isOpen() const { return file.isOpen(); }
+
+qint64 MediaProbe::Reader::size() const { return fileSize; }
+
+QByteArray MediaProbe::Reader::readAt(qint64 pos, qint64 length) {
+  if (pos < 0 || pos >= fileSize || length <= 0 || !file.seek(pos))
+    return QByteArray();
+  const QByteArray data = file.read(qMin(length, fileSize - pos));
+  totalRead += data.size();
+  return data;
+}
+
+qint64 MediaProbe::Reader::bytesRead() const { return totalRead; }
+
+// --- Probe ---
+
+MediaInfo MediaProbe::probe(const QString &path) {
+  MediaInfo info;
+  Reader reader(path);
+  if (!reader.isOpen())
+    return info;
+
+  // 1. Pick the container by its first bytes, not by the extension
+  const QByteArray magic = reader.readAt(0, 12);
+  if (magic.size() < 12)
+    return info;
+  static const QList<QByteArray> mp4Boxes = {"ftyp", "moov", "mdat",
+                                             "free", "wide", "skip"};
+  if (be32(magic.constData()) == kEbmlMagic)
+    probeMatroska(reader, info);
+  else if (magic.startsWith("RIFF") && magic.mid(8, 4) == "AVI ")
+    probeAvi(reader, info);
+  else if (mp4Boxes.contains(magic.mid(4, 4)))
+    probeMp4(reader, info);
+  else if (magic[0] == 0x47)
+    probeMpegTs(reader, info, 188, 0);
+  else if (magic[4] == 0x47)
+    probeMpegTs(reader, info, 192, 4); // M2TS: 4 byte timestamp first
+
+  info.ok = info.durationMs > 0;
+  info.bytesRead = reader.bytesRead();
+  return info;
+}
+
+bool MediaProbe::probeMp4(Reader &reader, MediaInfo &info) {
+  info.container = "mp4";
+  Mp4State st;
+
+  // Box tree down to what is needed; everything else (mdat, sample
+  // tables) is skipped by its size without being read
+  std::function<void(qint64, qint64, int)> walk = [&](qint64 pos, qint64 end,
+                                                      int depth) {
+    while (depth < kMaxBoxDepth && pos + 8 <= end) {
+      const QByteArray head = reader.readAt(pos, 16);
+      qint64 size = 0, headerSize = 0;
+      if (!parseBoxHeader(head, pos, end, size, headerSize))
+        return;
+      const QByteArray type = head.mid(4, 4);
+      const qint64 boxEnd = qMin(end, pos + size); // truncated file
+      const qint64 payload = pos + headerSize;
+
+      if (type == "moov" || type == "trak" || type == "mdia" ||
+          type == "minf" || type == "stbl" || type == "mvex") {
+        if (type == "trak") {
+          st.handler.clear();
+          st.tkhdWidth = st.tkhdHeight = 0;
+          st.sampleWidth = st.sampleHeight = 0;
+          st.sampleCodec.clear();
+        }
+        walk(payload, boxEnd, depth + 1);
+        if (type == "trak" && st.handler == "vide" && !st.haveVideo) {
+          st.haveVideo = true;
+          // Display size; the coded one (e.g. 1088 lines) as fallback
+          st.width = st.tkhdWidth ? st.tkhdWidth : st.sampleWidth;
+          st.height = st.tkhdHeight ? st.tkhdHeight : st.sampleHeight;
+          st.codec = st.sampleCodec;
+        }
+        if (type == "moov")
+          return; // all of it is in moov
+      } else if (type == "mvhd") {
+        const QByteArray b = reader.readAt(payload, 32);
+        if (b.size() >= 32 && b[0] == 1) {
+          st.timescale = be32(b.constData() + 20);
+          st.duration = be64(b.constData() + 24);
+          st.haveMvhd = st.duration != ~quint64(0);
+        } else if (b.size() >= 20) {
+          st.timescale = be32(b.constData() + 12);
+          st.duration = be32(b.constData() + 16);
+          st.haveMvhd = st.duration != 0xFFFFFFFFu;
+        }
+      } else if (type == "mehd") {
+        const QByteArray b = reader.readAt(payload, 12);
+        if (b.size() >= 12 && b[0] == 1)
+          st.fragmented = be64(b.constData() + 4);
+        else if (b.size() >= 8)
+          st.fragmented = be32(b.constData() + 4);
+      } else if (type == "tkhd") {
+        const QByteArray b = reader.readAt(payload, 96);
+        const int at = (!b.isEmpty() && b[0] == 1) ? 88 : 76;
+        if (b.size() >= at + 8) {
+          st.tkhdWidth = int(be32(b.constData() + at) >> 16); // 16.16
+          st.tkhdHeight = int(be32(b.constData() + at + 4) >> 16);
+        }
+      } else if (type == "hdlr") {
+        const QByteArray b = reader.readAt(payload, 12);
+        if (b.size() >= 12)
+          st.handler = b.mid(8, 4);
+      } else if (type == "stsd") {
+        // version/flags, entry count, then the first sample entry:
+        // size, format, ... width and height at +32 for video entries
+        const QByteArray b = reader.readAt(payload, 44);
+        if (b.size() >= 16)
+          st.sampleCodec = QString::fromLatin1(b.mid(12, 4));
+        if (b.size() >= 44 && st.handler == "vide") {
+          st.sampleWidth = be16(b.constData() + 40);
+          st.sampleHeight = be16(b.constData() + 42);
+        }
+      }
+      pos = boxEnd;
+    }
+  };
+  walk(0, reader.size(), 0);
+
+  if (st.timescale == 0)
+    return false;
+  const quint64 units = (st.haveMvhd && st.duration > 0) ? st.duration
+                                                         : st.fragmented;
+  if (units > 0)
+    info.durationMs = qint64(double(units) * 1000.0 / st.timescale);
+  info.width = st.width;
+  info.height = st.height;
+  info.videoCodec = st.codec.trimmed();
+  return true;
+}
+
+bool MediaProbe::probeMatroska(Reader &reader, MediaInfo &info) {
+  info.container = "matroska";
+
+  const auto readElement = [&reader](qint64 pos, EbmlElement &el) {
+    const QByteArray head = reader.readAt(pos, 12);
+    return parseEbmlHeader(head.constData(), head.size(), el);
+  };
+  const auto loadPayload = [&reader](qint64 pos, const EbmlElement &el) {
+    if (el.size < 0 || el.size > kMaxEbmlMasterBytes)
+      return QByteArray();
+    return reader.readAt(pos + el.headerLength, el.size);
+  };
+
+  // 1. EBML header: the DocType tells WebM from Matroska
+  EbmlElement el;
+  if (!readElement(0, el) || el.id != kEbmlMagic || el.size < 0)
+    return false;
+  forEachEbmlChild(loadPayload(0, el),
+                   [&](quint32 id, const char *data, qint64 size) {
+                     if (id == kDocType &&
+                         QByteArray(data, int(size)).startsWith("webm"))
+                       info.container = "webm";
+                   });
+
+  // 2. The Segment; its children up to the first Cluster
+  qint64 pos = el.headerLength + el.size;
+  EbmlElement segment;
+  if (!readElement(pos, segment) || segment.id != kSegment)
+    return false;
+  const qint64 segmentData = pos + segment.headerLength;
+  const qint64 segmentEnd =
+      segment.size < 0 ? reader.size()
+                       : qMin(reader.size(), segmentData + segment.size);
+
+  quint64 timecodeScale = 1000000; // ns per tick, the default
+  double duration = -1;
+  bool haveInfo = false, haveTracks = false;
+  qint64 infoAt = -1, tracksAt = -1; // from the SeekHead
+
+  const auto parseInfo = [&](const QByteArray &payload) {
+    haveInfo = true;
+    forEachEbmlChild(payload, [&](quint32 id, const char *data, qint64 size) {
+      if (id == kTimecodeScale)
+        timecodeScale = ebmlUInt(data, size);
+      else if (id == kDuration)
+        duration = ebmlFloat(data, size);
+    });
+  };
+  const auto parseTracks = [&](const QByteArray &payload) {
+    haveTracks = true;
+    forEachEbmlChild(payload, [&](quint32 id, const char *data, qint64 size) {
+      if (id != kTrackEntry || !info.videoCodec.isEmpty())
+        return;
+      quint64 type = 0;
+      QString codec;
+      int width = 0, height = 0;
+      forEachEbmlChild(QByteArray::fromRawData(data, int(size)),
+                       [&](quint32 id, const char *data, qint64 size) {
+                         if (id == kTrackType)
+                           type = ebmlUInt(data, size);
+                         else if (id == kCodecId)
+                           codec = QString::fromLatin1(data, int(size));
+                         else if (id == kVideo)
+                           forEachEbmlChild(
+                               QByteArray::fromRawData(data, int(size)),
+                               [&](quint32 id, const char *data, qint64 size) {
+                                 if (id == kPixelWidth)
+                                   width = int(ebmlUInt(data, size));
+                                 else if (id == kPixelHeight)
+                                   height = int(ebmlUInt(data, size));
+                               });
+                       });
+      if (type == 1) { // video
+        info.videoCodec = codec.trimmed();
+        info.width = width;
+        info.height = height;
+      }
+    });
+  };
+
+  pos = segmentData;
+  for (int n = 0; n < kMaxSegmentChildren && pos < segmentEnd; ++n) {
+    if (!readElement(pos, el) || el.id == kCluster || el.size < 0)
+      break; // media data starts, or a live stream of unknown size
+    if (el.id == kSeekHead) {
+      forEachEbmlChild(loadPayload(pos, el), [&](quint32 id, const char *data,
+                                                 qint64 size) {
+        if (id != kSeek)
+          return;
+        quint64 target = 0, at = 0;
+        forEachEbmlChild(QByteArray::fromRawData(data, int(size)),
+                         [&](quint32 id, const char *data, qint64 size) {
+                           if (id == kSeekId)
+                             target = ebmlUInt(data, size);
+                           else if (id == kSeekPosition)
+                             at = ebmlUInt(data, size);
+                         });
+        if (target == kInfo)
+          infoAt = segmentData + qint64(at);
+        else if (target == kTracks)
+          tracksAt = segmentData + qint64(at);
+      });
+    } else if (el.id == kInfo) {
+      parseInfo(loadPayload(pos, el));
+    } else if (el.id == kTracks) {
+      parseTracks(loadPayload(pos, el));
+    }
+    if (haveInfo && haveTracks)
+      break;
+    pos += el.headerLength + el.size;
+  }
+
+  // 3. Info / Tracks written after the clusters: jump via the SeekHead
+  if (!haveInfo && infoAt > 0 && readElement(infoAt, el) && el.id == kInfo)
+    parseInfo(loadPayload(infoAt, el));
+  if (!haveTracks && tracksAt > 0 && readElement(tracksAt, el) &&
+      el.id == kTracks)
+    parseTracks(loadPayload(tracksAt, el));
+
+  if (duration > 0)
+    info.durationMs = qint64(duration * double(timecodeScale) / 1e6);
+  return haveInfo;
+}
+
+bool MediaProbe::probeAvi(Reader &reader, MediaInfo &info) {
+  info.container = "avi";
+
+  // 1. The hdrl LIST is the first chunk after "RIFF....AVI "
+  const QByteArray list = reader.readAt(12, 12);
+  if (list.size() < 12 || !list.startsWith("LIST") || list.mid(8, 4) != "hdrl")
+    return false;
+  const qint64 hdrlSize = le32(list.constData() + 4) - 4;
+  const QByteArray hdrl = reader.readAt(24, qMin(hdrlSize, kMaxAviHeaderBytes));
+
+  quint32 usPerFrame = 0, totalFrames = 0, odmlFrames = 0;
+  qint64 streamMs = -1;
+
+  // 2. Chunks: avih directly, strh / strf inside each strl LIST
+  std::function<void(const char *, qint64)> walk = [&](const char *data,
+                                                       qint64 size) {
+    qint64 pos = 0;
+    bool videoStream = false;
+    while (pos + 8 <= size) {
+      const QByteArray id(data + pos, 4);
+      const qint64 length = le32(data + pos + 4);
+      const char *body = data + pos + 8;
+      const qint64 available = qMin(length, size - pos - 8);
+
+      if (id == "LIST" && available >= 4) {
+        walk(body + 4, available - 4); // strl, odml
+      } else if (id == "avih" && available >= 40) {
+        usPerFrame = le32(body);
+        totalFrames = le32(body + 16);
+        info.width = int(le32(body + 32));
+        info.height = int(le32(body + 36));
+      } else if (id == "strh" && available >= 36) {
+        videoStream = QByteArray(body, 4) == "vids";
+        const quint32 scale = le32(body + 20);
+        const quint32 rate = le32(body + 24);
+        if (videoStream && rate > 0 && streamMs < 0)
+          streamMs = qint64(double(le32(body + 32)) * scale * 1000.0 / rate);
+      } else if (id == "strf" && videoStream && available >= 20 &&
+                 info.videoCodec.isEmpty()) {
+        // BITMAPINFOHEADER: biCompression is the codec fourcc
+        info.videoCodec = QString::fromLatin1(body + 16, 4).trimmed();
+      } else if (id == "dmlh" && available >= 4) {
+        odmlFrames = le32(body); // all RIFF parts of an OpenDML file
+      }
+      pos += 8 + length + (length & 1); // chunks are word aligned
+    }
+  };
+  walk(hdrl.constData(), hdrl.size());
+
+  // 3. The video stream header counts every frame; avih only the first
+  // RIFF part of files over 1 GB
+  const quint32 frames = odmlFrames ? odmlFrames : totalFrames;
+  if (streamMs > 0)
+    info.durationMs = streamMs;
+  else if (usPerFrame > 0 && frames > 0)
+    info.durationMs = qint64(frames) * usPerFrame / 1000;
+  return true;
+}
+
+bool MediaProbe::probeMpegTs(Reader &reader, MediaInfo &info, int packetSize,
+                             int packetOffset) {
+  const QByteArray head = reader.readAt(0, kTsWindowBytes);
+  // Three sync bytes in a row, or it only started with 'G'
+  for (int i = 0; i < 3; ++i) {
+    const qint64 at = packetOffset + qint64(i) * packetSize;
+    if (at >= head.size() || head[at] != 0x47)
+      return false;
+  }
+  info.container = "mpegts";
+
+  // 1. PAT -> PMT -> video stream type and the PCR PID; the first PCR
+  TsState ts;
+  scanTsWindow(head, packetSize, packetOffset, true, ts);
+  info.videoCodec = ts.codec;
+  if (ts.firstPcr < 0)
+    return true;
+
+  // 2. The last PCR of the same PID, from a window at the end that starts
+  // on a packet boundary
+  qint64 tailStart = qMax<qint64>(0, reader.size() - kTsWindowBytes);
+  tailStart -= tailStart % packetSize;
+  scanTsWindow(reader.readAt(tailStart, reader.size() - tailStart),
+               packetSize, packetOffset, false, ts);
+  if (ts.lastPcr < 0)
+    return true;
+
+  qint64 span = ts.lastPcr - ts.firstPcr;
+  if (span < 0)
+    span += kPcrWrap; // the 33 bit clock wrapped (every ~26.5 hours)
+  info.durationMs = span / 27000; // 27 MHz
+  return true;
+}
+
+// --- Cover art ---
+
+QByteArray MediaProbe::coverArt(const QString &path) {
+  Reader reader(path);
+  const QByteArray magic = reader.readAt(0, 12);
+  if (magic.size() < 12)
+    return QByteArray();
+  if (be32(magic.constData()) == kEbmlMagic)
+    return coverMatroska(reader);
+  if (magic.mid(4, 4) == "ftyp" || magic.mid(4, 4) == "moov")
+    return coverMp4(reader);
+  return QByteArray();
+}
+
+QByteArray MediaProbe::coverMp4(Reader &reader) {
+  // Payload range of the first child of [pos, end) with the given type
+  const auto find = [&reader](qint64 pos, qint64 end, const char *type,
+                              qint64 &from, qint64 &to) {
+    while (pos + 8 <= end) {
+      const QByteArray head = reader.readAt(pos, 16);
+      qint64 size = 0, headerSize = 0;
+      if (!parseBoxHeader(head, pos, end, size, headerSize))
+        return false;
+      if (head.mid(4, 4) == type) {
+        from = pos + headerSize;
+        to = qMin(end, pos + size);
+        return true;
+      }
+      pos += size;
+    }
+    return false;
+  };
+
+  // moov/udta/meta/ilst/covr/data
+  qint64 from = 0, to = reader.size();
+  for (const char *type : {"moov", "udta", "meta"}) {
+    if (!find(from, to, type, from, to))
+      return QByteArray();
+  }
+  // ISO meta is a full box (version + flags first); QuickTime's is not
+  if (reader.readAt(from + 4, 4) != "hdlr")
+    from += 4;
+  for (const char *type : {"ilst", "covr", "data"}) {
+    if (!find(from, to, type, from, to))
+      return QByteArray();
+  }
+  from += 8; // type indicator (13 JPEG, 14 PNG) and locale
+  if (to - from <= 0 || to - from > kMaxCoverBytes)
+    return QByteArray();
+  return reader.readAt(from, to - from);
+}
+
+QByteArray MediaProbe::coverMatroska(Reader &reader) {
+  const auto readElement = [&reader](qint64 pos, EbmlElement &el) {
+    const QByteArray head = reader.readAt(pos, 12);
+    return parseEbmlHeader(head.constData(), head.size(), el);
+  };
+
+  // 1. EBML header, Segment
+  EbmlElement el;
+  if (!readElement(0, el) || el.id != kEbmlMagic || el.size < 0)
+    return QByteArray();
+  qint64 pos = el.headerLength + el.size;
+  EbmlElement segment;
+  if (!readElement(pos, segment) || segment.id != kSegment)
+    return QByteArray();
+  const qint64 segmentData = pos + segment.headerLength;
+  const qint64 segmentEnd =
+      segment.size < 0 ? reader.size()
+                       : qMin(reader.size(), segmentData + segment.size);
+
+  // 2. Attachments: among the first children, or where the SeekHead says
+  qint64 attachmentsAt = -1;
+  pos = segmentData;
+  for (int n = 0; n < kMaxSegmentChildren && pos < segmentEnd; ++n) {
+    if (!readElement(pos, el) || el.id == kCluster || el.size < 0)
+      break;
+    if (el.id == kAttachments) {
+      attachmentsAt = pos;
+      break;
+    }
+    if (el.id == kSeekHead && el.size <= kMaxEbmlMasterBytes) {
+      forEachEbmlChild(
+          reader.readAt(pos + el.headerLength, el.size),
+          [&](quint32 id, const char *data, qint64 size) {
+            if (id != kSeek)
+              return;
+            quint64 target = 0, at = 0;
+            forEachEbmlChild(QByteArray::fromRawData(data, int(size)),
+                             [&](quint32 id, const char *data, qint64 size) {
+                               if (id == kSeekId)
+                                 target = ebmlUInt(data, size);
+                               else if (id == kSeekPosition)
+                                 at = ebmlUInt(data, size);
+                             });
+            if (target == kAttachments)
+              attachmentsAt = segmentData + qint64(at);
+          });
+    }
+    pos += el.headerLength + el.size;
+  }
+  EbmlElement attachments;
+  if (attachmentsAt < 0 || !readElement(attachmentsAt, attachments) ||
+      attachments.id != kAttachments || attachments.size < 0)
+    return QByteArray();
+
+  // 3. Each AttachedFile child by its header only; FileData (fonts can be
+  // megabytes) is read once, for the chosen image
+  qint64 bestAt = -1, bestSize = 0;
+  bool bestIsCover = false;
+  pos = attachmentsAt + attachments.headerLength;
+  const qint64 attachmentsEnd = pos + attachments.size;
+  while (pos < attachmentsEnd && readElement(pos, el) && el.size >= 0) {
+    if (el.id == kAttachedFile) {
+      QString name, mime;
+      qint64 dataAt = -1, dataSize = 0;
+      qint64 child = pos + el.headerLength;
+      const qint64 fileEnd = child + el.size;
+      EbmlElement field;
+      while (child < fileEnd && readElement(child, field) && field.size >= 0) {
+        const qint64 body = child + field.headerLength;
+        if ((field.id == kFileName || field.id == kFileMimeType) &&
+            field.size <= 1024) {
+          const QString text =
+              QString::fromUtf8(reader.readAt(body, field.size));
+          (field.id == kFileName ? name : mime) = text;
+        } else if (field.id == kFileData) {
+          dataAt = body;
+          dataSize = field.size;
+        }
+        child = body + field.size;
+      }
+      const bool isCover = name.startsWith("cover", Qt::CaseInsensitive);
+      if (mime.startsWith("image/") && dataAt > 0 &&
+          dataSize <= kMaxCoverBytes &&
+          (bestAt < 0 || (isCover && !bestIsCover))) {
+        bestAt = dataAt;
+        bestSize = dataSize;
+        bestIsCover = isCover;
+      }
+    }
+    pos += el.headerLength + el.size;
+  }
+  return bestAt > 0 ? reader.readAt(bestAt, bestSize) : QByteArray();
+}
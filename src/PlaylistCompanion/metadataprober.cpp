@@ -0,0 +1,176 @@
+#include "include/metadataprober.h"
+#include "include/db_sqlite.h"
+#include "include/dbevents.h"
+#include "include/dbwriter.h"
+#include "include/pathstore.h"
+
+#include <QStringList>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+
+MetadataProber::MetadataProber(QObject *parent) : QObject(parent) {
+  // Header reads are a few small seeks per file: a handful of threads
+  // keeps a disk (or a NAS) busy without thrashing it
+  probePool.setMaxThreadCount(kProbeThreads);
+  connect(&watcher, &QFutureWatcher<int>::finished, this,
+          &MetadataProber::onPlaylistDone);
+  // A restore parks the writer that the worker waits on; stop after the
+  // batch in flight and let it commit first. MainWindow queues the
+  // playlists again once the restored data is read.
+  connect(DbEvents::instance(), &DbEvents::aboutToReplaceDatabase, this,
+          [this]() {
+            cancel();
+            watcher.waitForFinished();
+          });
+}
+
+MetadataProber::~MetadataProber() {
+  cancel();
+  watcher.waitForFinished();
+  probePool.waitForDone();
+}
+
+void MetadataProber::enqueue(int playlistId) {
+  if (playlistId <= 0 || pending.contains(playlistId))
+    return;
+  pending.append(playlistId);
+  if (!isRunning())
+    startNext();
+}
+
+bool MetadataProber::isRunning() const { return runningPlaylistId != -1; }
+
+void MetadataProber::cancel() {
+  cancelRequested = true;
+  pending.clear();
+}
+
+void MetadataProber::startNext() {
+  if (pending.isEmpty())
+    return;
+
+  runningPlaylistId = pending.takeFirst();
+  cancelRequested = false;
+  runTimer.start();
+
+  // Ids read before a hot restore must not be written into the restored
+  // data, so every batch checks the generation it was read from
+  const int playlistId = runningPlaylistId;
+  const int generation = SQliteDB::instance()->generation();
+  watcher.setFuture(QtConcurrent::run([this, playlistId, generation]() {
+    return probePlaylist(playlistId, generation);
+  }));
+}
+
+void MetadataProber::onPlaylistDone() {
+  const int playlistId = runningPlaylistId;
+  const int probed = watcher.result();
+  runningPlaylistId = -1;
+
+  if (probed > 0) {
+    proberdebug << "playlist" << playlistId << ":" << probed
+                << "files probed in" << runTimer.elapsed() << "ms";
+    emit finished(playlistId, probed, runTimer.elapsed());
+  }
+  startNext();
+}
+
+int MetadataProber::probePlaylist(int playlistId, int generation) {
+  // 1. What is left to probe (partial index, so cheap when nothing is);
+  // rows hold the path below the playlist folder
+  SQliteDB *db = SQliteDB::instance();
+  QSqlQuery root = db->execRead(
+      "SELECT playlistPath FROM Playlist WHERE playlistId = ?", {playlistId});
+  const QString rootPath = root.next() ? root.value(0).toString() : QString();
+  root.finish();
+
+  QVector<int> ids;
+  QStringList paths;
+  QSqlQuery query = db->execRead("SELECT videoID, videoPath FROM Video "
+                                 "WHERE playlistID = ? AND durationMs IS NULL",
+                                 {playlistId});
+  while (query.next()) {
+    ids.append(query.value(0).toInt());
+    paths.append(PathStore::absoluteOf(rootPath, query.value(1).toString()));
+  }
+  query.finish();
+
+  // 2. Probe a batch on the pool while the previous one commits
+  const int total = int(ids.size());
+  int probed = 0, committed = 0, inFlight = 0;
+  QFuture<bool> stored;
+  for (int start = 0; start < total && !cancelRequested; start += kBatchSize) {
+    Batch batch;
+    batch.ids = ids.mid(start, kBatchSize);
+    batch.infos = QtConcurrent::blockingMapped<QVector<MediaInfo>>(
+        &probePool, paths.mid(start, kBatchSize), &MediaProbe::probe);
+    probed += int(batch.ids.size());
+
+    if (stored.isValid()) {
+      if (!stored.result()) // waits; false: restored or write error
+        return committed;
+      committed += inFlight;
+    }
+    stored = storeBatch(playlistId, generation, batch, probed, total);
+    inFlight = int(batch.ids.size());
+  }
+
+  // 3. finished() only after the last batch is committed
+  if (stored.isValid() && stored.result())
+    committed += inFlight;
+  return committed;
+}
+
+QFuture<bool> MetadataProber::storeBatch(int playlistId, int generation,
+                                         const Batch &batch, int probed,
+                                         int total) {
+  QHash<int, qint64> durations;
+  for (int i = 0; i < batch.ids.size(); ++i) {
+    const MediaInfo &info = batch.infos[i];
+    durations.insert(batch.ids[i], info.ok ? info.durationMs : -1);
+  }
+
+  // The worker waits on the writer's future itself, not on the continuation:
+  // that runs on this object's thread, which may be blocked in ~MetadataProber
+  const auto job = [generation, batch]() {
+    if (SQliteDB::instance()->generation() != generation)
+      return false; // these ids belong to the file before the restore
+
+    // One transaction per batch; the duration triggers add up
+    // Playlist.totalDurationMs in the same commit
+    DbWriter *writer = DbWriter::instance();
+    QSqlDatabase &db = writer->database();
+    if (!db.transaction())
+      return false;
+    bool ok = true;
+    for (int i = 0; ok && i < batch.ids.size(); ++i) {
+      const MediaInfo &info = batch.infos[i];
+      ok = writer
+               ->execPrepared(
+                   "UPDATE Video SET durationMs = ?, width = ?, "
+                   "height = ?, videoCodec = ? "
+                   "WHERE videoID = ? AND durationMs IS NULL",
+                   {info.ok ? info.durationMs : -1,
+                    info.width > 0 ? QVariant(info.width) : QVariant(),
+                    info.height > 0 ? QVariant(info.height) : QVariant(),
+                    info.videoCodec.isEmpty() ? QVariant()
+                                              : QVariant(info.videoCodec),
+                    batch.ids[i]})
+               .isActive();
+    }
+    if (!ok) {
+      qCritical() << "[MetadataProber] storing durations failed:"
+                  << db.lastError().text();
+      db.rollback();
+      return false;
+    }
+    return db.commit();
+  };
+  QFuture<bool> stored = DbWriter::instance()->run(job);
+  stored.then(this, [this, playlistId, durations, probed, total](bool ok) {
+    if (ok)
+      emit durationsStored(playlistId, durations);
+    emit progress(playlistId, probed, total);
+  });
+  return stored;
+}
@@ -0,0 +1,51 @@
+#include "include/naturalsortkey.h"
+
+namespace {
+constexpr char kSeparator = 0x00;
+constexpr char kDigitRun = 0x01;
+constexpr char kTextRun = 0x02;
+
+bool isAsciiDigit(QChar c) { return c >= u'0' && c <= u'9'; }
+} // namespace
+
+QByteArray naturalSortKey(const QString &path) {
+  const QString folded = path.toCaseFolded();
+  QByteArray key;
+  key.reserve(folded.size() + 8);
+
+  qsizetype i = 0;
+  const qsizetype n = folded.size();
+  while (i < n) {
+    const QChar c = folded[i];
+
+    if (c == u'/' || c == u'\\') {
+      key.append(kSeparator);
+      ++i;
+    } else if (isAsciiDigit(c)) {
+      // Leading zeros do not count: "007" == "7"
+      while (i < n && folded[i] == u'0')
+        ++i;
+      const qsizetype start = i;
+      while (i < n && isAsciiDigit(folded[i]))
+        ++i;
+      const qsizetype digits = i - start;
+      key.append(kDigitRun);
+      key.append(char(qMin<qsizetype>(digits, 255)));
+      for (qsizetype d = start; d < i; ++d)
+        key.append(char(folded[d].unicode()));
+    } else {
+      const qsizetype start = i;
+      while (i < n && folded[i] != u'/' && folded[i] != u'\\' &&
+             !isAsciiDigit(folded[i]))
+        ++i;
+      key.append(kTextRun);
+      const QByteArray text = folded.mid(start, i - start).toUtf8();
+      for (char byte : text) {
+        // Control characters would collide with the markers
+        if (uchar(byte) >= 0x20)
+          key.append(byte);
+      }
+    }
+  }
+  return key;
+}
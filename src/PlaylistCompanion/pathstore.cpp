@@ -0,0 +1,159 @@
+#include "include/pathstore.h"
+
+#include <QDir>
+
+namespace {
+
+// Not QDir::isAbsolutePath(): that takes ":name" for a resource, and a file
+// in the playlist root may well be called that
+bool isAbsolute(const QString &path) {
+#ifdef _WIN32
+  return path.startsWith('/') || (path.size() > 1 && path.at(1) == ':');
+#else
+  return path.startsWith('/');
+#endif
+}
+
+QString joined(const QString &dir, const QString &name) {
+  if (dir.isEmpty())
+    return name;
+  return dir.endsWith('/') ? dir + name : dir + '/' + name;
+}
+
+} // namespace
+
+PathStore::PathStore(const QString &root)
+    : rootPath(root.isEmpty() ? root : QDir::cleanPath(root)) {
+  dirs.append({kNoParent, 0, 0});
+}
+
+QString PathStore::relativeTo(const QString &root, const QString &path) {
+  if (root.isEmpty())
+    return path;
+  const QString base = QDir::cleanPath(root);
+  const QString prefix = base.endsWith('/') ? base : base + '/';
+  if (!path.startsWith(prefix))
+    return path;
+  // "root//file" from a root given with a trailing slash is still inside
+  qsizetype start = prefix.size();
+  while (start < path.size() && path.at(start) == '/')
+    ++start;
+  return start < path.size() ? path.mid(start) : path;
+}
+
+QString PathStore::absoluteOf(const QString &root, const QString &stored) {
+  if (root.isEmpty() || stored.isEmpty() || isAbsolute(stored))
+    return stored;
+  return joined(QDir::cleanPath(root), stored);
+}
+
+PathStore::Handle PathStore::add(const QString &path) {
+  // 1. Split into folder (relative to the root where it can be) and name
+  const QString relative = relativeTo(rootPath, path);
+  const qsizetype slash = relative.lastIndexOf('/');
+  const QString dirKey = slash < 0    ? QString()
+                         : slash == 0 ? QString("/")
+                                      : relative.left(slash);
+
+  // 2. Same folder as the previous file: no hash lookup
+  if (dirKey != lastDirKey) {
+    lastDir = internDir(dirKey);
+    lastDirKey = dirKey;
+  }
+
+  const quint32 offset = appendName(relative.mid(slash + 1));
+  leaves.append({lastDir, offset, quint32(names.size()) - offset});
+  return Handle(leaves.size() - 1);
+}
+
+void PathStore::reserve(int count) { leaves.reserve(count); }
+
+void PathStore::clear() {
+  names.clear();
+  leaves.clear();
+  dirs.clear();
+  dirs.append({kNoParent, 0, 0});
+  dirIndex.clear();
+  lastDirKey.clear();
+  lastDir = 0;
+}
+
+QString PathStore::path(Handle handle) const {
+  return absoluteOf(rootPath, relativePath(handle));
+}
+
+QString PathStore::relativePath(Handle handle) const {
+  const Leaf &leaf = leaves[handle];
+  return joined(dirKeyOf(leaf.dir), nameAt(leaf.offset, leaf.length));
+}
+
+QString PathStore::fileName(Handle handle) const {
+  const Leaf &leaf = leaves[handle];
+  return nameAt(leaf.offset, leaf.length);
+}
+
+void PathStore::reorder(const QVector<Handle> &order) {
+  Q_ASSERT(order.size() == leaves.size());
+  QVector<Leaf> sorted;
+  sorted.reserve(order.size());
+  for (Handle handle : order)
+    sorted.append(leaves[handle]);
+  leaves = std::move(sorted);
+}
+
+qsizetype PathStore::memoryBytes() const {
+  qsizetype bytes = names.capacity() + leaves.capacity() * sizeof(Leaf) +
+                    dirs.capacity() * sizeof(DirNode);
+  // Hash nodes: key, value and a next pointer, plus the key's UTF-16 data
+  for (auto it = dirIndex.cbegin(); it != dirIndex.cend(); ++it)
+    bytes += sizeof(QString) + 2 * sizeof(quint32) + 2 * it.key().capacity();
+  return bytes;
+}
+
+quint32 PathStore::internDir(const QString &dirKey) {
+  if (dirKey.isEmpty())
+    return 0;
+  const auto known = dirIndex.constFind(dirKey);
+  if (known != dirIndex.cend())
+    return *known;
+
+  // A relative folder is its parent's node plus one segment; a folder
+  // outside the root is one node with the whole path
+  DirNode node{kNoParent, 0, 0};
+  QString segment = dirKey;
+  if (!isAbsolute(dirKey)) {
+    const qsizetype slash = dirKey.lastIndexOf('/');
+    node.parent = slash < 0 ? 0 : internDir(dirKey.left(slash));
+    segment = dirKey.mid(slash + 1);
+  }
+  node.offset = appendName(segment);
+  node.length = quint32(names.size()) - node.offset;
+  dirs.append(node);
+
+  const quint32 index = quint32(dirs.size() - 1);
+  dirIndex.insert(dirKey, index);
+  return index;
+}
+
+quint32 PathStore::appendName(const QString &name) {
+  const quint32 offset = quint32(names.size());
+  names.append(name.toUtf8());
+  return offset;
+}
+
+QString PathStore::nameAt(quint32 offset, quint32 length) const {
+  return QString::fromUtf8(names.constData() + offset, length);
+}
+
+QString PathStore::dirKeyOf(quint32 dir) const {
+  QString key;
+  while (dir != 0) {
+    const DirNode &node = dirs[dir];
+    const QString segment = nameAt(node.offset, node.length);
+    key = key.isEmpty() ? segment : segment + '/' + key;
+    if (node.parent == kNoParent)
+      break;
+    dir = node.parent;
+  }
+  return key;
+}
@@ -0,0 +1,304 @@
+#include "include/playercontroller.h"
+#include "include/dbwriter.h"
+#include "include/watchhistory.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+PlayerController::PlayerController(QObject *parent) : QObject(parent) {
+  mpvSocket = new QLocalSocket(this);
+  connect(mpvSocket, &QLocalSocket::connected, this,
+          &PlayerController::onIpcConnected);
+  connect(mpvSocket, &QLocalSocket::readyRead, this,
+          &PlayerController::readMpv);
+  connect(mpvSocket, &QLocalSocket::disconnected, this,
+          &PlayerController::endSession);
+
+  vlcSocket = new QTcpSocket(this);
+  connect(vlcSocket, &QTcpSocket::connected, this,
+          &PlayerController::onIpcConnected);
+  connect(vlcSocket, &QTcpSocket::readyRead, this,
+          &PlayerController::readVlc);
+  connect(vlcSocket, &QTcpSocket::disconnected, this,
+          &PlayerController::endSession);
+
+  connectTimer.setInterval(kConnectRetryMs);
+  connect(&connectTimer, &QTimer::timeout, this,
+          &PlayerController::connectIpc);
+  flushTimer.setInterval(kFlushIntervalMs);
+  connect(&flushTimer, &QTimer::timeout, this, &PlayerController::flush);
+  pollTimer.setInterval(kPollMs);
+  connect(&pollTimer, &QTimer::timeout, this, [this]() {
+    // The length is asked along until VLC knows it (0 while loading)
+    if (vlcAsked.size() > kMaxUnanswered)
+      vlcAsked.clear(); // lost track of which answer is which
+    if (durationMs <= 0) {
+      vlcSocket->write("get_length\n");
+      vlcAsked.append(true);
+    }
+    vlcSocket->write("get_time\n");
+    vlcAsked.append(false);
+  });
+
+  // The DbWriter is shut down once the event loop has returned, so the
+  // last position and the time played have to be queued before that
+  connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this,
+          [this]() {
+            flush();
+            recordPlayed();
+          });
+}
+
+PlayerController::~PlayerController() {
+  // Only the sockets go, the player keeps playing on its own. Their
+  // disconnects must not reach endSession() from here.
+  mpvSocket->disconnect(this);
+  vlcSocket->disconnect(this);
+}
+
+PlayerController::Kind PlayerController::kindOf(const QString &playerPath) {
+  const QString name = QFileInfo(playerPath).completeBaseName().toLower();
+  // Flatpak exports are named by app id (see PlayerDiscovery)
+  const QString appId = QFileInfo(playerPath).fileName().toLower();
+  if (name == "mpv" || appId == "io.mpv.mpv")
+    return Kind::Mpv;
+  if (name == "vlc" || appId == "org.videolan.vlc")
+    return Kind::Vlc;
+  return Kind::Other;
+}
+
+bool PlayerController::isTracking() const { return tracking; }
+
+int PlayerController::videoId() const {
+  return current.videoID > 0 ? current.videoID : -1;
+}
+
+bool PlayerController::play(const QString &playerPath, const Video &vdo,
+                            qint64 knownDurationMs) {
+  if (playerPath.isEmpty() || !QFileInfo::exists(playerPath)) {
+    emit failed("No media player found. Choose the default one in Settings.");
+    return false;
+  }
+
+  // 1. The video before keeps where it was left
+  endSession();
+  kind = kindOf(playerPath);
+  current = vdo;
+  durationMs = knownDurationMs > 0 ? knownDurationMs : 0;
+  position = storedPosition = vdo.resumeTime;
+  playedSeconds = recordedSeconds = 0;
+  watchedSent = false;
+
+  // A finished video starts over
+  int startSeconds = vdo.resumeTime;
+  if (durationMs > 0 &&
+      qint64(startSeconds) * 1000 * 100 >= durationMs * kWatchedPercent)
+    startSeconds = 0;
+
+  // 2. Where the player will listen: a socket per session, an older mpv
+  // window may still be open on the previous one
+  if (kind == Kind::Mpv) {
+    const QString name = QString("plc-mpv-%1-%2")
+                             .arg(QCoreApplication::applicationPid())
+                             .arg(++session);
+#ifdef Q_OS_WIN
+    ipcServer = name; // \\.\pipe\<name>, QLocalSocket adds the prefix
+#else
+    ipcServer = QDir::temp().filePath(name + ".sock");
+    QFile::remove(ipcServer);
+#endif
+  } else if (kind == Kind::Vlc) {
+    QTcpServer freePort;
+    freePort.listen(QHostAddress::LocalHost, 0);
+    rcPort = freePort.serverPort();
+    freePort.close();
+  }
+
+  // 3. Detached: closing the app must not close the player
+  QProcess process;
+  process.setProgram(playerPath);
+  process.setArguments(arguments(startSeconds));
+  if (!process.startDetached()) {
+    emit failed(QString("Could not start %1").arg(playerPath));
+    current = Video{};
+    return false;
+  }
+  playerdebug << "playing video" << vdo.videoID << "from" << startSeconds
+              << "s in" << playerPath;
+
+  // 4. The player needs a moment before it listens
+  if (kind != Kind::Other) {
+    connectAttempts = 0;
+    connectTimer.start();
+  }
+  return true;
+}
+
+QStringList PlayerController::arguments(int startSeconds) const {
+  QStringList args;
+  switch (kind) {
+  case Kind::Mpv:
+#ifdef Q_OS_WIN
+    args << "--input-ipc-server=\\\\.\\pipe\\" + ipcServer;
+#else
+    args << "--input-ipc-server=" + ipcServer;
+#endif
+    if (startSeconds > 0)
+      args << QString("--start=%1").arg(startSeconds);
+    args << "--" << current.videoPath;
+    break;
+  case Kind::Vlc:
+    args << "--extraintf=rc"
+         << QString("--rc-host=127.0.0.1:%1").arg(rcPort);
+#ifdef Q_OS_WIN
+    args << "--rc-quiet"; // no console window
+#endif
+    if (startSeconds > 0)
+      args << QString("--start-time=%1").arg(startSeconds);
+    args << current.videoPath;
+    break;
+  case Kind::Other:
+    args << current.videoPath;
+    break;
+  }
+  return args;
+}
+
+void PlayerController::connectIpc() {
+  if (++connectAttempts > kConnectAttempts) {
+    connectTimer.stop();
+    qWarning() << "[PlayerController] The player did not answer; position of"
+               << "video" << current.videoID << "is not tracked";
+    return;
+  }
+  if (kind == Kind::Mpv) {
+    mpvSocket->abort();
+    mpvSocket->connectToServer(ipcServer);
+  } else {
+    vlcSocket->abort();
+    vlcSocket->connectToHost(QHostAddress::LocalHost, rcPort);
+  }
+}
+
+void PlayerController::onIpcConnected() {
+  connectTimer.stop();
+  tracking = true;
+  if (kind == Kind::Mpv) {
+    // Pushed on every change; setPosition() drops same-second updates
+    mpvSocket->write("{\"command\":[\"observe_property\",1,\"time-pos\"]}\n");
+    mpvSocket->write("{\"command\":[\"observe_property\",2,\"duration\"]}\n");
+  } else {
+    vlcAsked.clear();
+    pollTimer.start();
+  }
+  flushTimer.start();
+}
+
+void PlayerController::readMpv() {
+  while (mpvSocket->canReadLine()) {
+    const QJsonObject message =
+        QJsonDocument::fromJson(mpvSocket->readLine()).object();
+    if (message.value("event").toString() != "property-change")
+      continue; // command replies, other events
+    const QString name = message.value("name").toString();
+    const QJsonValue data = message.value("data");
+    if (!data.isDouble())
+      continue; // null while a file is loading
+    if (name == "duration")
+      durationMs = qint64(data.toDouble() * 1000);
+    else if (name == "time-pos")
+      setPosition(int(data.toDouble()));
+  }
+}
+
+void PlayerController::readVlc() {
+  while (vlcSocket->canReadLine()) {
+    // Answers are bare numbers, possibly behind a "> " prompt; status
+    // lines and the greeting are not
+    QString line = QString::fromUtf8(vlcSocket->readLine()).trimmed();
+    while (line.startsWith('>'))
+      line = line.mid(1).trimmed();
+    bool isNumber = false;
+    const int value = line.toInt(&isNumber);
+    if (!isNumber || vlcAsked.isEmpty())
+      continue;
+    if (vlcAsked.takeFirst()) {
+      if (value > 0)
+        durationMs = qint64(value) * 1000;
+    } else {
+      setPosition(value);
+    }
+  }
+}
+
+void PlayerController::setPosition(int seconds) {
+  if (seconds < 0 || seconds == position)
+    return;
+  if (position >= 0 && seconds > position &&
+      seconds - position <= kMaxPlayStep)
+    playedSeconds += seconds - position;
+  position = seconds;
+  emit positionChanged(current.videoID, seconds);
+
+  if (!watchedSent && durationMs > 0 &&
+      qint64(seconds) * 1000 * 100 >= durationMs * kWatchedPercent) {
+    watchedSent = true;
+    emit watchedReached(current.playlistID, current.videoID);
+  }
+}
+
+void PlayerController::flush() {
+  if (current.videoID <= 0 || position < 0 || position == storedPosition)
+    return;
+  // Watched to the end: the next play starts from the beginning
+  const int resumeTime = watchedSent ? 0 : position;
+  DbWriter::instance()->enqueue(
+      "UPDATE Video SET resumeTime = ? WHERE videoID = ?",
+      {resumeTime, current.videoID});
+  storedPosition = position;
+}
+
+void PlayerController::recordPlayed() {
+  if (current.videoID <= 0 || playedSeconds <= recordedSeconds)
+    return;
+  const int playlistId = current.playlistID;
+  WatchHistory::recordSession(playlistId, current.videoID,
+                              playedSeconds - recordedSeconds)
+      .then(this, [this, playlistId](const WriteResult &result) {
+        if (result.ok)
+          emit sessionRecorded(playlistId);
+      });
+  recordedSeconds = playedSeconds;
+}
+
+void PlayerController::endSession() {
+  if (current.videoID <= 0)
+    return;
+  const bool wasTracking = tracking;
+  tracking = false;
+  connectTimer.stop();
+  pollTimer.stop();
+  flushTimer.stop();
+  flush();
+  recordPlayed();
+
+  const int videoId = current.videoID;
+  current = Video{};
+  position = storedPosition = -1;
+  mpvSocket->abort(); // the disconnects come back here, with no session
+  vlcSocket->abort();
+  if (wasTracking) {
+    playerdebug << "video" << videoId << "closed";
+    emit sessionEnded(videoId);
+  }
+}
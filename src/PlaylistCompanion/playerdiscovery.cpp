@@ -0,0 +1,250 @@
+#include "include/playerdiscovery.h"
+#include "include/db_sqlite.h"
+#include "include/dbevents.h"
+#include "include/dbwriter.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+
+PlayerDiscovery *PlayerDiscovery::discoveryInstance = nullptr;
+
+PlayerDiscovery *PlayerDiscovery::instance() {
+  if (!discoveryInstance)
+    discoveryInstance = new PlayerDiscovery();
+  return discoveryInstance;
+}
+
+PlayerDiscovery::PlayerDiscovery(QObject *parent) : QObject(parent) {
+  // A restored file carries the cache (and stamp) of when it was saved
+  connect(DbEvents::instance(), &DbEvents::databaseReplaced, this,
+          &PlayerDiscovery::refresh);
+}
+
+const QVector<KnownPlayer> &PlayerDiscovery::knownPlayers() {
+  // NOTE: Windows paths must use double backslashes (\\) or forward slashes
+  // (/) for proper string escaping. Empty: not made for this OS, or only
+  // found through PATH / flatpak / snap.
+  static const QVector<KnownPlayer> players = {
+#ifdef _WIN32
+      {"VLC", "C:\\Program Files\\VideoLAN\\VLC\\vlc.exe", {"vlc"}, {}},
+      {"MPV", "C:\\Program Files\\mpv\\mpv.exe", {"mpv"}, {}},
+      {"Windows Media Player (WMP)",
+       "C:\\Program Files\\Windows Media Player\\wmplayer.exe",
+       {"wmplayer"},
+       {}},
+      {"PotPlayer",
+       "C:\\Program Files\\DAUM\\PotPlayer\\PotPlayer.exe",
+       {"PotPlayerMini64", "PotPlayerMini"},
+       {}},
+      {"KMPlayer", "C:\\Program Files\\KMPlayer\\", {"KMPlayer"}, {}},
+      {"MPlayer", "C:\\Program Files\\MPlayer\\", {"mplayer"}, {}},
+      {"SM Player", "C:\\Program Files\\SMPlayer\\", {"smplayer"}, {}},
+      {"Media Player Classic", "C:\\Program Files\\MPC-HC\\",
+       {"mpc-hc64", "mpc-hc"}, {}},
+      {"GOM Player", "C:\\Program Files\\GRETECH\\GOM Player\\", {"GOM"}, {}},
+      {"GNOME Videos", "", {}, {}}, // Not applicable on Windows
+#else
+      // Common default paths on many Linux distros
+      {"VLC", "/usr/bin/vlc", {"vlc"}, "org.videolan.VLC"},
+      {"MPV", "/usr/bin/mpv", {"mpv"}, "io.mpv.Mpv"},
+      // WMP is not available on Linux
+      {"Windows Media Player (WMP)", "", {}, {}},
+      {"PotPlayer", "", {}, {}},
+      {"KMPlayer", "", {}, {}},
+      {"MPlayer", "/usr/bin/mplayer", {"mplayer"}, {}},
+      {"SM Player", "/usr/bin/smplayer", {"smplayer"}, "info.smplayer.SMPlayer"},
+      {"Media Player Classic", "", {}, {}},
+      {"GOM Player", "", {}, {}},
+      // Common executable name for GNOME Videos (Totem)
+      {"GNOME Videos", "/usr/bin/totem", {"totem"}, "org.gnome.Totem"},
+#endif
+  };
+  return players;
+}
+
+QVector<PlayerDiscovery::SearchDir> PlayerDiscovery::searchDirs() {
+  QVector<SearchDir> dirs;
+  QSet<QString> seen;
+  const auto add = [&](const QString &path, const QString &source) {
+    const QString clean = QDir::cleanPath(path);
+    if (!path.isEmpty() && !seen.contains(clean)) {
+      seen.insert(clean);
+      dirs.append({clean, source});
+    }
+  };
+
+  // 1. $PATH, in its order
+  const QString snapBin = "/snap/bin";
+  for (const QString &dir : qEnvironmentVariable("PATH").split(
+           QDir::listSeparator(), Qt::SkipEmptyParts))
+    add(dir, QDir::cleanPath(dir) == snapBin ? "snap" : "path");
+
+#ifdef __linux__
+  // 2. Snap and flatpak, also when the session's PATH lacks them
+  add(snapBin, "snap");
+  add("/var/lib/flatpak/exports/bin", "flatpak");
+  add(QDir::homePath() + "/.local/share/flatpak/exports/bin", "flatpak");
+#endif
+
+  // 3. Default install folders: only stamped, their files are checked
+  //    directly
+  for (const KnownPlayer &player : knownPlayers())
+    if (!player.defaultPath.isEmpty())
+      add(QFileInfo(player.defaultPath).absolutePath(), "known");
+  return dirs;
+}
+
+QString PlayerDiscovery::stampOf(const QVector<SearchDir> &dirs) {
+  // A folder's mtime moves when an entry is added or removed, so installing
+  // or removing a player changes it; so does editing PATH or this list
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  for (const KnownPlayer &player : knownPlayers())
+    hash.addData(QString("%1|%2|%3|%4\n")
+                     .arg(player.name, player.defaultPath,
+                          player.commands.join(','), player.flatpakId)
+                     .toUtf8());
+  for (const SearchDir &dir : dirs) {
+    const QFileInfo info(dir.path);
+    hash.addData(QString("%1|%2|%3\n")
+                     .arg(dir.path)
+                     .arg(info.exists())
+                     .arg(info.lastModified().toMSecsSinceEpoch())
+                     .toUtf8());
+  }
+  return QString::fromLatin1(hash.result().toHex());
+}
+
+PlayerDiscovery::Scan PlayerDiscovery::scan() {
+  Scan result;
+  const QVector<SearchDir> dirs = searchDirs();
+  result.stamp = stampOf(dirs);
+
+  // 1. Same folders as last time: the cache is still right
+  QSqlQuery stored = SQliteDB::instance()->execRead(
+      "SELECT playerStamp FROM General WHERE id = 1");
+  if (stored.next() && stored.value(0).toString() == result.stamp) {
+    result.unchanged = true;
+    return result;
+  }
+  stored.finish();
+
+  // 2. Default path first, then PATH / snap in order, then flatpak
+  for (const KnownPlayer &player : knownPlayers()) {
+    FoundPlayer found{player.name, {}, {}};
+    if (!player.defaultPath.isEmpty() && QFileInfo::exists(player.defaultPath))
+      found = {player.name, player.defaultPath, "known"};
+    for (const SearchDir &dir : dirs) {
+      if (!found.path.isEmpty())
+        break;
+      if (dir.source == "path" || dir.source == "snap") {
+        for (const QString &command : player.commands) {
+          const QString path = QStandardPaths::findExecutable(command, {dir.path});
+          if (!path.isEmpty()) {
+            found = {player.name, path, dir.source};
+            break;
+          }
+        }
+      } else if (dir.source == "flatpak" && !player.flatpakId.isEmpty()) {
+        const QFileInfo exported(dir.path + "/" + player.flatpakId);
+        if (exported.isExecutable())
+          found = {player.name, exported.filePath(), "flatpak"};
+      }
+    }
+    if (!found.path.isEmpty())
+      result.players.append(found);
+  }
+  return result;
+}
+
+void PlayerDiscovery::refresh() {
+  // A restored database has the stamp of its own time: the run under way
+  // compared against the old one, so one more follows it
+  if (running) {
+    rerun = true;
+    return;
+  }
+  running = true;
+  QtConcurrent::run(&PlayerDiscovery::scan)
+      .then(this, [this](const Scan &result) {
+        if (result.unchanged) {
+          discoverydebug << "players unchanged, stamp" << result.stamp.left(8);
+          finishRun();
+          return;
+        }
+        store(result);
+      });
+}
+
+void PlayerDiscovery::store(const Scan &result) {
+  // One transaction: Settings never sees a half-written list. The stamp goes
+  // to the General row, which startup queued before this.
+  DbWriter::instance()
+      ->run([result]() {
+        DbWriter *writer = DbWriter::instance();
+        QSqlDatabase &db = writer->database();
+        if (!db.transaction())
+          return false;
+        bool ok = writer->execPrepared("DELETE FROM MediaPlayerPath").isActive();
+        for (const FoundPlayer &player : result.players) {
+          if (!ok)
+            break;
+          ok = writer
+                   ->execPrepared("INSERT INTO MediaPlayerPath "
+                                  "(mediaPlayerName, mediaPlayerPath, source) "
+                                  "VALUES (?, ?, ?)",
+                                  {player.name, player.path, player.source})
+                   .isActive();
+        }
+        ok = ok && writer
+                       ->execPrepared(
+                           "UPDATE General SET playerStamp = ?, "
+                           "playersScannedAt = CAST(strftime('%s','now') "
+                           "AS INTEGER) WHERE id = 1",
+                           {result.stamp})
+                       .isActive();
+        if (ok && db.commit())
+          return true;
+        db.rollback();
+        return false;
+      })
+      .then(this, [this, count = result.players.size()](bool ok) {
+        if (!ok) {
+          qWarning() << "[PlayerDiscovery] Could not store the players found";
+        } else {
+          discoverydebug << count << "players found";
+          emit playersChanged();
+        }
+        finishRun();
+      });
+}
+
+void PlayerDiscovery::finishRun() {
+  running = false;
+  if (rerun) {
+    rerun = false;
+    refresh();
+  }
+}
+
+QVector<FoundPlayer> PlayerDiscovery::load() {
+  QHash<QString, FoundPlayer> byName;
+  QSqlQuery query = SQliteDB::instance()->execRead(
+      "SELECT mediaPlayerName, mediaPlayerPath, source FROM MediaPlayerPath");
+  while (query.next()) {
+    const QString name = query.value(0).toString();
+    byName.insert(name, {name, query.value(1).toString(),
+                         query.value(2).toString()});
+  }
+
+  QVector<FoundPlayer> players;
+  for (const KnownPlayer &player : knownPlayers())
+    if (byName.contains(player.name))
+      players.append(byName.value(player.name));
+  return players;
+}
@@ -0,0 +1,451 @@
+#include "include/playlistrescanner.h"
+#include "include/db_sqlite.h"
+#include "include/dbevents.h"
+#include "include/dbwriter.h"
+#include "include/naturalsortkey.h"
+#include "include/tracing.h"
+#include "include/videoingest.h"
+#include "include/videoscanner.h"
+#include "include/videosearch.h"
+
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+
+QString parentOf(const QString &path) {
+  return path.left(path.lastIndexOf('/'));
+}
+
+bool isInside(const QString &path, const QStringList &dirs) {
+  for (const QString &dir : dirs) {
+    if (path == dir || path.startsWith(dir + '/'))
+      return true;
+  }
+  return false;
+}
+
+} // namespace
+
+PlaylistRescanner::PlaylistRescanner(QObject *parent) : QObject(parent) {
+  connect(&watcher, &QFutureWatcher<RescanPlan>::finished, this,
+          &PlaylistRescanner::onPlanReady);
+  // The walk reads the old file; let it end before the writer is parked
+  connect(DbEvents::instance(), &DbEvents::aboutToReplaceDatabase, this,
+          [this]() { watcher.waitForFinished(); });
+}
+
+bool PlaylistRescanner::rescan(int playlistId, const QString &rootPath) {
+  if (isRunning())
+    return false;
+
+  runningPlaylistId = playlistId;
+  runningGeneration = SQliteDB::instance()->generation();
+  rescandebug << "rescan started:" << rootPath;
+
+  // 1. + 2. Load the cache and walk on a worker, through its own read
+  // connection. The GUI thread does no DB or filesystem work.
+  watcher.setFuture(QtConcurrent::run([playlistId, rootPath]() {
+    return PlaylistRescanner::plan(rootPath, {}, loadFingerprints(playlistId),
+                                   loadVideoPaths(playlistId, rootPath));
+  }));
+  return true;
+}
+
+bool PlaylistRescanner::isRunning() const { return runningPlaylistId != -1; }
+
+void PlaylistRescanner::onPlanReady() {
+  const int playlistId = runningPlaylistId;
+  const RescanPlan result = watcher.result();
+
+  if (runningGeneration != SQliteDB::instance()->generation()) {
+    runningPlaylistId = -1;
+    emit failed(playlistId, "The database was restored during the rescan.");
+    return;
+  }
+  if (result.rootMissing) {
+    runningPlaylistId = -1;
+    emit failed(playlistId, "Playlist folder is not reachable.");
+    return;
+  }
+
+  // 3. Write the diff back on the writer thread, report on this one.
+  // Still "running" until then, so a new rescan never reads a stale cache.
+  DbWriter::instance()
+      ->run([playlistId, result]() {
+        VideoDelta delta;
+        if (!PlaylistRescanner::apply(playlistId, result, &delta))
+          delta.playlistId = -1;
+        return delta;
+      })
+      .then(this, [this, playlistId](const VideoDelta &delta) {
+        runningPlaylistId = -1;
+        if (runningGeneration != SQliteDB::instance()->generation()) {
+          // Committed, then overwritten by a restore: ids of the old data
+          emit failed(playlistId,
+                      "The database was restored during the rescan.");
+          return;
+        }
+        if (delta.playlistId < 0) {
+          emit failed(playlistId,
+                      "Could not write rescan result to the database.");
+          return;
+        }
+        emit finished(playlistId, int(delta.added.size()),
+                      int(delta.removedIds.size()));
+        if (!delta.isEmpty())
+          emit videosChanged(delta);
+      });
+}
+
+RescanPlan PlaylistRescanner::plan(const QString &rootPath,
+                                   const QStringList &startDirs,
+                                   const QHash<QString, DirFingerprint> &cache,
+                                   const QSet<QString> &knownVideos) {
+  PLC_TRACE_SPAN(span, "rescan.plan");
+  PLC_TRACE_DETAIL(span, rootPath);
+  QElapsedTimer timer;
+  timer.start();
+
+  RescanPlan result;
+  result.rootPath = rootPath;
+  const QStringList scope = startDirs.isEmpty() ? QStringList{rootPath}
+                                                : startDirs;
+
+  DirFingerprint rootFp;
+  if (!VideoScanner::readFingerprint(rootPath, rootFp)) {
+    // Do not wipe a playlist because its drive is not mounted
+    result.rootMissing = true;
+    return result;
+  }
+
+  // 1. Index the cache: children per folder, known videos per folder
+  QHash<QString, QStringList> cachedChildren;
+  for (auto it = cache.cbegin(); it != cache.cend(); ++it) {
+    if (!it->parentPath.isEmpty())
+      cachedChildren[it->parentPath].append(it.key());
+  }
+  QHash<QString, QSet<QString>> videosByDir;
+  for (const QString &video : knownVideos)
+    videosByDir[parentOf(video)].insert(video);
+
+  // 2. Walk. Unchanged folders cost one stat and are not listed; their
+  // children are taken from the cache instead.
+  QSet<QString> visited;
+  QStringList stack = scope;
+  while (!stack.isEmpty()) {
+    const QString dir = stack.takeLast();
+    if (visited.contains(dir))
+      continue;
+
+    DirFingerprint fp;
+    result.statCount++;
+    if (!VideoScanner::readFingerprint(dir, fp))
+      continue; // gone; handled as "not visited" below
+    visited.insert(dir);
+
+    const auto cached = cache.constFind(dir);
+    if (cached != cache.cend() && cached->mtime == fp.mtime &&
+        cached->inode == fp.inode) {
+      stack.append(cachedChildren.value(dir));
+      continue;
+    }
+
+    QStringList files;
+    QStringList subdirs;
+    QVector<FileIdentity> identities;
+    VideoScanner::listDirectory(dir, files, subdirs, &identities);
+    result.listedDirs++;
+    for (qsizetype i = 0; i < files.size(); ++i)
+      result.identities.insert(files[i], identities[i]);
+
+    fp.parentPath = (dir == rootPath) ? QString() : parentOf(dir);
+    fp.entryCount = int(files.size() + subdirs.size());
+    result.changedDirs.append(fp);
+
+    const QSet<QString> onDisk(files.cbegin(), files.cend());
+    const QSet<QString> inDb = videosByDir.value(dir);
+    for (const QString &file : files) {
+      if (!inDb.contains(file))
+        result.addedFiles.append(file);
+    }
+    for (const QString &video : inDb) {
+      if (!onDisk.contains(video))
+        result.removedFiles.append(video);
+    }
+
+    stack.append(subdirs);
+  }
+
+  // 3. Anything in scope that was not reached any more has been removed
+  for (auto it = cache.cbegin(); it != cache.cend(); ++it) {
+    if (!visited.contains(it.key()) && isInside(it.key(), scope))
+      result.removedDirs.append(it.key());
+  }
+  for (auto it = videosByDir.cbegin(); it != videosByDir.cend(); ++it) {
+    if (!visited.contains(it.key()) && isInside(it.key(), scope)) {
+      for (const QString &video : it.value())
+        result.removedFiles.append(video);
+    }
+  }
+
+  rescandebug << "plan:" << result.statCount << "stats," << result.listedDirs
+              << "listed, +" << result.addedFiles.size() << "/ -"
+              << result.removedFiles.size() << "in" << timer.elapsed()
+              << "ms";
+  return result;
+}
+
+QHash<QString, DirFingerprint> PlaylistRescanner::loadFingerprints(
+    int playlistId) {
+  QHash<QString, DirFingerprint> cache;
+  QSqlQuery query = SQliteDB::instance()->execRead(
+      "SELECT dirPath, parentPath, mtime, entryCount, inode "
+      "FROM DirFingerprint WHERE playlistID = ?",
+      {playlistId});
+  while (query.next()) {
+    DirFingerprint fp;
+    fp.dirPath = query.value(0).toString();
+    fp.parentPath = query.value(1).toString();
+    fp.mtime = query.value(2).toLongLong();
+    fp.entryCount = query.value(3).toInt();
+    fp.inode = quint64(query.value(4).toLongLong());
+    cache.insert(fp.dirPath, fp);
+  }
+  return cache;
+}
+
+QSet<QString> PlaylistRescanner::loadVideoPaths(int playlistId,
+                                                const QString &rootPath) {
+  QSet<QString> paths;
+  QSqlQuery query = SQliteDB::instance()->execRead(
+      "SELECT videoPath FROM Video WHERE playlistID = ?", {playlistId});
+  while (query.next())
+    paths.insert(PathStore::absoluteOf(rootPath, query.value(0).toString()));
+  return paths;
+}
+
+bool PlaylistRescanner::storeFingerprints(
+    int playlistId, const QVector<DirFingerprint> &fingerprints) {
+  DbWriter *writer = DbWriter::instance();
+  for (const DirFingerprint &fp : fingerprints) {
+    QSqlQuery query = writer->execPrepared(
+        "INSERT OR REPLACE INTO DirFingerprint "
+        "(playlistID, dirPath, parentPath, mtime, entryCount, inode) "
+        "VALUES (?, ?, ?, ?, ?, ?)",
+        {playlistId, fp.dirPath, fp.parentPath, fp.mtime, fp.entryCount,
+         qint64(fp.inode)});
+    if (!query.isActive())
+      return false;
+  }
+  return true;
+}
+
+bool PlaylistRescanner::apply(int playlistId, const RescanPlan &plan,
+                              VideoDelta *delta) {
+  DbWriter *writer = DbWriter::instance();
+  QSqlDatabase &db = writer->database();
+
+  // 1. Pair up moves and renames before touching the DB
+  QStringList removed = plan.removedFiles;
+  QStringList added = plan.addedFiles;
+  QVector<QPair<QString, QString>> renames; // old path, new path
+
+  // Only names that occur once on each side, so two "intro.mp4" from
+  // different folders never swap their watched state.
+  auto fileName = [](const QString &path) {
+    return path.mid(path.lastIndexOf('/') + 1);
+  };
+  QHash<QString, int> addedByName;
+  QHash<QString, int> removedNameCount;
+  for (int i = 0; i < added.size(); ++i) {
+    const QString name = fileName(added[i]);
+    addedByName.insert(name, addedByName.contains(name) ? -1 : i);
+  }
+  for (const QString &path : std::as_const(removed))
+    removedNameCount[fileName(path)]++;
+  for (int i = removed.size() - 1; i >= 0; --i) {
+    const QString name = fileName(removed[i]);
+    const auto match = addedByName.constFind(name);
+    if (match != addedByName.cend() && *match >= 0 &&
+        removedNameCount.value(name) == 1) {
+      renames.append({removed[i], added[*match]});
+      added[*match].clear();
+      removed.removeAt(i);
+    }
+  }
+
+  // Plan paths are absolute, rows hold them below the playlist folder
+  const auto stored = [&plan](const QString &path) {
+    return PathStore::relativeTo(plan.rootPath, path);
+  };
+
+  // Then renames: what is left pairs up only when both files have the same
+  // size and mtime (a rename keeps both) and no other file of this batch
+  // has them. A delete plus an unrelated copy never matches, and a row
+  // without a stored identity (before schema 13) stays remove + add.
+  using IdentityKey = QPair<qint64, qint64>;
+  QHash<IdentityKey, int> addedById; // -1: more than one
+  for (int i = 0; i < added.size(); ++i) {
+    const FileIdentity id = plan.identities.value(added[i]);
+    if (added[i].isEmpty() || !id.isValid())
+      continue;
+    const IdentityKey key{id.size, id.mtimeMs};
+    addedById.insert(key, addedById.contains(key) ? -1 : i);
+  }
+  QVector<IdentityKey> removedIds(removed.size(), IdentityKey{-1, 0});
+  QHash<IdentityKey, int> removedIdCount;
+  for (int i = 0; !addedById.isEmpty() && i < removed.size(); ++i) {
+    QSqlQuery row = writer->execPrepared(
+        "SELECT fileSize, fileMtime FROM Video WHERE playlistID = ? "
+        "AND videoPath = ? AND fileSize IS NOT NULL",
+        {playlistId, stored(removed[i])});
+    if (row.next()) {
+      removedIds[i] = {row.value(0).toLongLong(), row.value(1).toLongLong()};
+      removedIdCount[removedIds[i]]++;
+    }
+    row.finish();
+  }
+  for (int i = removed.size() - 1; i >= 0 && !addedById.isEmpty(); --i) {
+    const auto match = addedById.constFind(removedIds[i]);
+    if (removedIds[i].first < 0 || match == addedById.cend() || *match < 0 ||
+        removedIdCount.value(removedIds[i]) != 1)
+      continue;
+    renames.append({removed[i], added[*match]});
+    added[*match].clear();
+    removed.removeAt(i);
+  }
+
+  if (!db.transaction())
+    return false;
+
+  bool ok = true;
+
+  // 2. Video diff
+  const auto identityBinds = [&plan](const QString &path) {
+    const FileIdentity id = plan.identities.value(path);
+    return id.isValid() ? QVariantList{id.size, id.mtimeMs}
+                        : QVariantList{QVariant(), QVariant()};
+  };
+  QVariant durationMs;
+  auto lookup = [&](const QString &path, Video &vdo) {
+    QSqlQuery found = writer->execPrepared(
+        "SELECT videoID, isWatched, durationMs FROM Video WHERE "
+        "playlistID = ? AND videoPath = ?",
+        {playlistId, stored(path)});
+    if (!found.next())
+      return false;
+    vdo.videoID = found.value(0).toInt();
+    vdo.isWatched = found.value(1).toInt();
+    durationMs = found.value(2);
+    found.finish();
+    return true;
+  };
+
+  for (const auto &rename : std::as_const(renames)) {
+    Video vdo{};
+    vdo.playlistID = playlistId;
+    vdo.videoPath = rename.second;
+    if (!ok || !lookup(rename.first, vdo))
+      continue;
+    const QVariantList identity = identityBinds(rename.second);
+    ok = writer
+             ->execPrepared("UPDATE Video SET videoPath = ?, videoTitle = ?, "
+                            "sortKey = ?, searchText = ?, fileSize = ?, "
+                            "fileMtime = ? WHERE videoID = ?",
+                            {stored(rename.second),
+                             VideoIngest::titleOf(rename.second),
+                             naturalSortKey(rename.second),
+                             VideoSearch::indexText(rename.second),
+                             identity[0], identity[1], vdo.videoID})
+             .isActive();
+    if (delta) {
+      delta->renamed.append(vdo);
+      // For views that have not paged the old row in yet
+      if (!durationMs.isNull())
+        delta->renamedDurations.insert(vdo.videoID, durationMs.toLongLong());
+    }
+  }
+
+  for (const QString &path : std::as_const(removed)) {
+    Video vdo{};
+    if (!ok || !lookup(path, vdo))
+      continue;
+    ok = writer
+             ->execPrepared("DELETE FROM Video WHERE videoID = ?",
+                            {vdo.videoID})
+             .isActive();
+    if (delta)
+      delta->removedIds.append(vdo.videoID);
+  }
+
+  for (const QString &path : std::as_const(added)) {
+    if (!ok || path.isEmpty())
+      continue; // empty: consumed by a rename
+    const QVariantList identity = identityBinds(path);
+    QSqlQuery addVideo = writer->execPrepared(
+        "INSERT OR IGNORE INTO Video (playlistID, videoPath, videoTitle, "
+        "sortKey, searchText, fileSize, fileMtime) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?)",
+        {playlistId, stored(path), VideoIngest::titleOf(path),
+         naturalSortKey(path), VideoSearch::indexText(path), identity[0],
+         identity[1]});
+    ok = addVideo.isActive();
+    if (ok && delta && addVideo.numRowsAffected() > 0) {
+      Video vdo{};
+      vdo.videoID = addVideo.lastInsertId().toInt();
+      vdo.playlistID = playlistId;
+      vdo.videoPath = path;
+      delta->added.append(vdo);
+    }
+  }
+
+  // Known files of the listed folders: store their identity where it is
+  // missing (rows from before schema 13) or changed (file rewritten)
+  const QSet<QString> addedSet(plan.addedFiles.cbegin(),
+                               plan.addedFiles.cend());
+  for (auto it = plan.identities.cbegin(); ok && it != plan.identities.cend();
+       ++it) {
+    if (addedSet.contains(it.key()) || !it->isValid())
+      continue;
+    ok = writer
+             ->execPrepared(
+                 "UPDATE Video SET fileSize = ?, fileMtime = ? "
+                 "WHERE playlistID = ? AND videoPath = ? "
+                 "AND (fileSize IS NOT ? OR fileMtime IS NOT ?)",
+                 {it->size, it->mtimeMs, playlistId, stored(it.key()),
+                  it->size, it->mtimeMs})
+             .isActive();
+  }
+
+  // 3. Fingerprint cache
+  for (const QString &dir : plan.removedDirs) {
+    if (!ok)
+      break;
+    ok = writer
+             ->execPrepared("DELETE FROM DirFingerprint WHERE playlistID = ? "
+                            "AND dirPath = ?",
+                            {playlistId, dir})
+             .isActive();
+  }
+  ok = ok && storeFingerprints(playlistId, plan.changedDirs);
+
+  // 4. Counters follow through the Video triggers; only stamp the change
+  if (ok && (!plan.addedFiles.isEmpty() || !plan.removedFiles.isEmpty())) {
+    ok = writer
+             ->execPrepared("UPDATE Playlist SET updatingDateTime = "
+                            "CURRENT_TIMESTAMP WHERE playlistId = ?",
+                            {playlistId})
+             .isActive();
+  }
+
+  if (!ok) {
+    qCritical() << "[PlaylistRescanner] applying rescan failed:"
+                << db.lastError().text();
+    db.rollback();
+    return false;
+  }
+  if (delta)
+    delta->playlistId = playlistId;
+  return db.commit();
+}
@@ -1,109 +1,26 @@
 #include "settings.h"
 #include "ui_settings.h"
 
-#include <QBrush> // REQUIRED for setting the background brush
-#include <QColor> // REQUIRED for setting the background color
+#include <QApplication>
 #include <QCoreApplication>
-#include <QFile> // REQUIRED for checking file existence
+#include <QDir>
+#include <QFile>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QSignalBlocker>
+#include <QSpinBox>
 #include <QString>
 #include <QTableWidget>
 #include <QTableWidgetItem>
-#include <utility>
-#include <vector>
-
-// --- Global Data ---
-
-std::vector<std::pair<QString, QString>> mediaPlayerEntries = {
-    // NOTE: Windows paths must use double backslashes (\\) or forward slashes
-    // (/) for proper string escaping.
-
-    {"VLC",
-#ifdef __linux__
-     // Common default path for VLC executable on many Linux distros
-     "/usr/bin/vlc"
-#elif _WIN32
-// Default path for 64-bit VLC. Note the use of \\
-        "C:\\Program Files\\VideoLAN\\VLC\\vlc.exe"
-#endif
-    },
-    {"MPV",
-#ifdef __linux__
-     // Common default path for MPV executable
-     "/usr/bin/mpv"
-#elif _WIN32
-        // General path, often within a subfolder or C:\Program Files\mpv\mpv.exe
-        "C:\\Program Files\\mpv\\mpv.exe"
-#endif
-    },
-    {"Windows Media Player (WMP)",
-#ifdef __linux__
-     // WMP is not available on Linux. Path is left empty.
-     ""
-#elif _WIN32
-        // The executable is typically in the Windows system directory
-        "C:\\Program Files\\Windows Media Player\\wmplayer.exe"
-#endif
-    },
-    {"PotPlayer",
-#ifdef __linux__
-     ""
-#elif _WIN32
-        "C:\\Program Files\\DAUM\\PotPlayer\\PotPlayer.exe"
-#endif
-    },
-    // The rest of the entries are left with placeholder paths for brevity,
-    // but they require the same double-backslash fix for Windows.
-    {"KMPlayer",
-#ifdef __linux__
-     ""
-#elif _WIN32
-        "C:\\Program Files\\KMPlayer\\"
-#endif
-    },
-    {"MPlayer",
-#ifdef __linux__
-     "/usr/bin/mplayer"
-#elif _WIN32
-        "C:\\Program Files\\MPlayer\\"
-#endif
-    },
-    {"SM Player",
-#ifdef __linux__
-     "/usr/bin/smplayer"
-#elif _WIN32
-        "C:\\Program Files\\SMPlayer\\"
-#endif
-    },
-    {"Media Player Classic",
-#ifdef __linux__
-     ""
-#elif _WIN32
-        "C:\\Program Files\\MPC-HC\\"
-#endif
-    },
-    {"GOM Player",
-#ifdef __linux__
-     ""
-#elif _WIN32
-        "C:\\Program Files\\GRETECH\\GOM Player\\"
-#endif
-    },
-    {"GNOME Videos",
-#ifdef __linux__
-     // Common executable name for GNOME Videos (Totem)
-     "/usr/bin/totem"
-#elif _WIN32
-        "" // Not applicable on Windows
-#endif
-    }
-    //
-};
+#include <algorithm>
 
-void Settings::updatePlayerList(Ui::Settings *ui) {
-  // 1. Setup the table
-  ui->listPlayersTableWidget->setRowCount(mediaPlayerEntries.size());
+void Settings::updatePlayerList(Ui::Settings *ui,
+                                const QVector<FoundPlayer> &players) {
+  // 1. Setup the table: every player the app looks for, found or not
+  const QVector<KnownPlayer> &known = PlayerDiscovery::knownPlayers();
+  ui->listPlayersTableWidget->setRowCount(known.size());
   ui->listPlayersTableWidget->setColumnCount(2);
 
   // Set headers (Added from previous fix, necessary for a good table)
@@ -111,55 +28,25 @@ void Settings::updatePlayerList(Ui::Settings *ui) {
   labels << "Video Player Name" << "Default Path";
   ui->listPlayersTableWidget->setHorizontalHeaderLabels(labels);
 
-  // clear all media player paths from DB to add new entries
-  Settings::dbInstance->execQuery("DELETE FROM MediaPlayerPath");
-
   int row = 0;
 
-  // 2. Populate the table
-  for (const auto &entry : mediaPlayerEntries) {
-    const QString &name = entry.first;
-    const QString &path = entry.second;
-
-    // Check if the file exists on the current system
-    bool fileExists = QFile::exists(path);
-
-    // --- Core Logic for Item Flags and Appearance ---
-
-    // --- DB INSERTION LOGIC ---
-    if (fileExists) {
-      // Manually escape single quotes (' -> '') to prevent SQL injection/errors
-      QString safeName = name;
-      safeName.replace("'", "''");
-
-      QString safePath = path;
-      safePath.replace("'", "''");
-
-      // Construct the raw query string
-      // We use INSERT OR REPLACE to update the path if the player name already
-      // exists
-      QString q = QString("INSERT OR REPLACE INTO MediaPlayerPath "
-                          "(mediaPlayerName, mediaPlayerPath) "
-                          "VALUES ('%1', '%2')")
-                      .arg(safeName, safePath);
-
-      // Execute using the requested helper function from SQliteDB
-      SQliteDB::instance()->execQuery(q);
-    }
+  // 2. Populate the table from MediaPlayerPath (PlayerDiscovery's cache);
+  // nothing is looked up on disk here
+  for (const KnownPlayer &player : known) {
+    const auto found =
+        std::find_if(players.cbegin(), players.cend(),
+                     [&](const FoundPlayer &p) { return p.name == player.name; });
+    const bool installed = found != players.cend();
 
     // Create QTableWidgetItem for the name and path
-    QTableWidgetItem *nameItem = new QTableWidgetItem(name);
-    QTableWidgetItem *pathItem = new QTableWidgetItem(path);
-
-    if (!fileExists) {
-      // 1. Visually disable: Set text and background color to silver/gray
-      // QBrush disabledBrush(Qt::red); // Use a light color for the background
-
-      // Set the color for both cells
-      // nameItem->setBackground(disabledBrush);
-      // pathItem->setBackground(disabledBrush);
-
-      // 2. Interactively disable: Remove the ItemIsEnabled flag
+    QTableWidgetItem *nameItem = new QTableWidgetItem(player.name);
+    QTableWidgetItem *pathItem = new QTableWidgetItem(
+        installed ? found->path : player.defaultPath);
+    if (installed && found->source != "known")
+      pathItem->setToolTip("Found through " + found->source);
+
+    if (!installed) {
+      // Interactively disable: Remove the ItemIsEnabled flag
       Qt::ItemFlags flags = nameItem->flags();
       flags &= ~Qt::ItemIsEnabled;
 
@@ -178,32 +65,49 @@ void Settings::updatePlayerList(Ui::Settings *ui) {
   ui->listPlayersTableWidget->resizeColumnsToContents();
 }
 
-void updateDfltCombo(Ui::Settings *ui) {
+void Settings::updateDfltCombo(const QVector<FoundPlayer> &players) {
   QComboBox *comboBox = ui->dfltMediaPlayerComboBox;
 
-  // 1. Clear any existing items in the combo box
-  comboBox->clear();
-
-  // 2. Populate the combo box with media player names
-  for (const auto &entry : mediaPlayerEntries) {
-    const QString &name = entry.first;
-    const QString &path = entry.second;
-
-    // Check if the file exists on the current system
-    bool fileExists = QFile::exists(path);
-
-    // Add the name to the combo box.
-    // NOTE: We use the *name* as the display text, and optionally,
-    // we could store the *path* (entry.second) as the user data.
-    if (fileExists)
-      comboBox->addItem(name);
+  // 1. The saved default; filling the combo must not overwrite it
+  QString defaultPath;
+  QSqlQuery general = dbInstance->execPrepared(
+      "SELECT defaultMediaPlayer FROM General WHERE id = 1");
+  if (general.next())
+    defaultPath = general.value(0).toString();
+  general.finish();
+
+  // 2. Installed players: name shown, path as the user data
+  {
+    const QSignalBlocker blocker(comboBox);
+    comboBox->clear();
+    for (const FoundPlayer &player : players)
+      comboBox->addItem(player.name, player.path);
+    int current = comboBox->findData(defaultPath);
+
+    // The saved one is no longer among them (uninstalled, moved): shown as
+    // such, not as a blank combo that looks like no default was chosen
+    if (current < 0 && !defaultPath.isEmpty()) {
+      const QString name = QFileInfo(defaultPath).fileName();
+      comboBox->insertItem(0,
+                           QFileInfo::exists(defaultPath)
+                               ? name
+                               : QString("%1 (not installed)").arg(name),
+                           defaultPath);
+      comboBox->setItemData(0, defaultPath, Qt::ToolTipRole);
+      current = 0;
+    }
+    comboBox->setCurrentIndex(current);
   }
 
-  // 3. Select the first item by default
-  // Check if the vector was not empty before trying to select
-  if (!mediaPlayerEntries.empty()) {
+  // 3. No default yet (first run): the first installed player becomes it
+  if (defaultPath.isEmpty() && comboBox->count() > 0)
     comboBox->setCurrentIndex(0);
-  }
+}
+
+void Settings::showPlayers() {
+  const QVector<FoundPlayer> players = PlayerDiscovery::load();
+  updatePlayerList(ui, players);
+  updateDfltCombo(players);
 }
 
 // This function is automatically called when the user changes the selection
@@ -215,40 +119,16 @@ void Settings::on_dfltMediaPlayerComboBox_currentTextChanged(
     return;
   }
 
-  // 2. Prepare the Name for the SELECT query
-  // We must escape quotes HERE first to safely find the path
-  QString safeLookupName = arg1;
-  safeLookupName.replace("'", "''");
-
-  // 3. Fetch the Path from DB
-  // Notice the added single quotes around '%1'
-  QString selectQ = QString("SELECT mediaPlayerPath FROM MediaPlayerPath WHERE "
-                            "mediaPlayerName = '%1'")
-                        .arg(safeLookupName);
-
-  QSqlQuery temp = dbInstance->execQuery(selectQ);
-
-  QString pathFound = "";
-
-  // CRITICAL FIX: You must call next() to get the record
-  if (temp.next()) {
-    pathFound = temp.value("mediaPlayerPath").toString();
-  } else {
+  // 2. The path PlayerDiscovery found for it
+  const QString pathFound = ui->dfltMediaPlayerComboBox->currentData().toString();
+  if (pathFound.isEmpty()) {
     qWarning() << "[Settings] Could not find path for player:" << arg1;
     return; // Stop if no path found
   }
 
-  // 4. Escape the Path for the UPDATE query
-  // The path (e.g., C:\Program Files\...) might contain special chars
-  QString safePath = pathFound;
-  safePath.replace("'", "''");
-
-  // 5. Update the General table
-  QString updateQ =
-      QString("UPDATE General SET defaultMediaPlayer = '%1' WHERE id = 1")
-          .arg(safePath);
-
-  dbInstance->execQuery(updateQ);
+  // 3. Update the General table (write-behind)
+  DbWriter::instance()->enqueue(
+      "UPDATE General SET defaultMediaPlayer = ? WHERE id = 1", {pathFound});
 
   qDebug() << "[Settings] Default media player set to path:" << pathFound;
 }
@@ -280,50 +160,267 @@ Settings::Settings(QWidget *parent) : QWidget(parent), ui(new Ui::Settings) {
   ui->appPath->setText(QCoreApplication::applicationFilePath());
   ui->version->setText("0.1");
 
-  // Call the updated function
-  updatePlayerList(ui);
-  updateDfltCombo(ui);
+  // Players from the discovery cache; refilled if a search in the
+  // background finds a different set while this is open
+  showPlayers();
+  connect(PlayerDiscovery::instance(), &PlayerDiscovery::playersChanged, this,
+          &Settings::showPlayers);
+
+  // Backup store: progress of manual and automatic snapshots, retention
+  BackupStore *store = BackupStore::instance();
+  connect(store, &BackupStore::progress, this, &Settings::onBackupProgress);
+  connect(store, &BackupStore::finished, this, &Settings::onBackupFinished);
+  ui->backupLocation->setText(BackupStore::storePath());
+  showLastBackup();
+
+  loadRetention();
+  for (QSpinBox *spinBox : {ui->autoBackupHours, ui->keepLast,
+                            ui->keepHourly, ui->keepDaily, ui->keepWeekly})
+    connect(spinBox, &QSpinBox::editingFinished, this,
+            &Settings::onRetentionChanged);
+
+  // Span latencies recorded so far (empty unless built with tracing)
+  showTraceSummary();
 }
 
 Settings::~Settings() { delete ui; }
 
+void Settings::setThumbnails(const ThumbnailService *service) {
+  thumbnails = service;
+  showThumbnailStats();
+}
+
+void Settings::showThumbnailStats() {
+  if (!thumbnails)
+    return;
+  const ThumbnailStats stats = thumbnails->stats();
+  const quint64 requests = stats.requests();
+  if (requests == 0)
+    return;
+  const auto percent = [requests](quint64 count) {
+    return QString::number(count * 100.0 / requests, 'f', 1) + " %";
+  };
+  ui->thumbnailStats->setText(
+      QString("Thumbnails: %1 requests, %2 from memory, %3 from disk, %4 "
+              "made, %5 with none")
+          .arg(requests)
+          .arg(percent(stats.memoryHits))
+          .arg(percent(stats.diskHits))
+          .arg(percent(stats.generated))
+          .arg(percent(stats.failures)));
+}
+
+void Settings::showTraceSummary() {
+  QTableWidget *table = ui->traceSummaryTable;
+  if (!Tracing::compiledIn()) {
+    ui->tracingState->setText(
+        "Tracing is not built in (qmake CONFIG+=tracing)");
+    table->setEnabled(false);
+    ui->exportTrace->setEnabled(false); // Refresh still updates thumbnails
+    return;
+  }
+
+  const QVector<TraceSummary> spans = Tracing::summary();
+  table->setRowCount(spans.size());
+  const auto cell = [](const QVariant &value) {
+    auto *item = new QTableWidgetItem;
+    item->setData(Qt::DisplayRole, value);
+    return item;
+  };
+  int row = 0;
+  for (const TraceSummary &span : spans) {
+    table->setItem(row, 0, new QTableWidgetItem(span.name));
+    table->setItem(row, 1, cell(span.count));
+    table->setItem(row, 2, cell(QString::number(span.p50Ms, 'f', 3)));
+    table->setItem(row, 3, cell(QString::number(span.p99Ms, 'f', 3)));
+    table->setItem(row, 4, cell(QString::number(span.maxMs, 'f', 3)));
+    row++;
+  }
+  table->resizeColumnsToContents();
+
+  const qint64 dropped = Tracing::droppedEvents();
+  if (dropped > 0)
+    ui->tracingState->setText(
+        QString("Latency of the traced spans; %1 events past the per-thread "
+                "limit were not recorded")
+            .arg(dropped));
+}
+
+void Settings::on_refreshTraceSummary_clicked() {
+  showTraceSummary();
+  showThumbnailStats();
+}
+
+void Settings::on_exportTrace_clicked() {
+  const QString path = QFileDialog::getSaveFileName(
+      this, "Export Chrome Trace",
+      QDir::home().filePath("playlistcompanion-trace.json"),
+      "Chrome trace (*.json)");
+  if (path.isEmpty())
+    return;
+  QString error;
+  if (!Tracing::exportChrome(path, &error)) {
+    QMessageBox::warning(this, "Failed !!!",
+                         "The trace was not written.\n\n" + error);
+    return;
+  }
+  QMessageBox::information(
+      this, "Trace exported",
+      "Open it in chrome://tracing or https://ui.perfetto.dev");
+}
+
+void Settings::showLastBackup() {
+  const QVector<SnapshotInfo> snapshots = BackupStore::listSnapshots();
+  if (snapshots.isEmpty())
+    return;
+  ui->lastBackup->setText(
+      QString("%1 (%2 snapshots)")
+          .arg(snapshots.first().created.toString("yyyy-MM-dd HH:mm:ss"))
+          .arg(snapshots.size()));
+}
+
+void Settings::loadRetention() {
+  const RetentionPolicy policy = BackupStore::loadPolicy();
+  ui->autoBackupHours->setValue(policy.autoBackupHours);
+  ui->keepLast->setValue(policy.keepLast);
+  ui->keepHourly->setValue(policy.keepHourly);
+  ui->keepDaily->setValue(policy.keepDaily);
+  ui->keepWeekly->setValue(policy.keepWeekly);
+}
+
+void Settings::onRetentionChanged() {
+  DbWriter::instance()->enqueue(
+      "UPDATE General SET autoBackupHours = ?, backupKeepLast = ?, "
+      "backupKeepHourly = ?, backupKeepDaily = ?, backupKeepWeekly = ? "
+      "WHERE id = 1",
+      {ui->autoBackupHours->value(), ui->keepLast->value(),
+       ui->keepHourly->value(), ui->keepDaily->value(),
+       ui->keepWeekly->value()});
+  BackupStore::instance()->setAutoBackupInterval(ui->autoBackupHours->value());
+}
+
 void Settings::on_restoreBackup_clicked() {
+  // 1. Which snapshot: one of the store, or any SQLite file
+  const QVector<SnapshotInfo> snapshots = BackupStore::listSnapshots();
+  QStringList choices;
+  for (const SnapshotInfo &snap : snapshots)
+    choices.append(QString("%1  (%2 KiB, schema %3)")
+                       .arg(snap.id)
+                       .arg(snap.size / 1024)
+                       .arg(snap.schemaVersion));
+  const QString otherFile = "Other SQLite file...";
+  choices.append(otherFile);
+
+  bool chosen = false;
+  const QString choice = QInputDialog::getItem(
+      this, "Restore Backup", "Snapshot to restore:", choices, 0, false,
+      &chosen);
+  if (!chosen)
+    return;
 
-  // get which file to restore
-  QString filter = "SQLite (*.sqlite)";
-  QString backupFileName = QFileDialog::getOpenFileName(
-      this, "Select a SQLite file that stored previous backup",
-      Settings::dbInstance->getDbDirPath(), filter);
-  // check whether the file exists
-  QFile instructionFile(backupFileName);
-  if (!instructionFile.open(QFile::ReadOnly)) {
-    QMessageBox::warning(this, "File failed to select !!!",
-                         "File failed to select!");
+  QString backupFileName;
+  if (choice == otherFile) {
+    QString filter = "SQLite (*.sqlite)";
+    backupFileName = QFileDialog::getOpenFileName(
+        this, "Select a SQLite file that stored previous backup",
+        Settings::dbInstance->getDbDirPath(), filter);
+    // check whether the file exists
+    QFile instructionFile(backupFileName);
+    if (!instructionFile.open(QFile::ReadOnly)) {
+      QMessageBox::warning(this, "File failed to select !!!",
+                           "File failed to select!");
+      return;
+    }
   }
-  // perform backup & replacement
-  dbInstance->restoreDBfile(backupFileName);
 
-  // NOTE: upadate UI with new data ; it can be a better approach to close the
-  // app and reopen it again
+  // 2. Hot restore: the writer commits its queue and parks, the old data
+  // is snapshotted, then replaced; the main window reloads on its own
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  QString error;
+  const bool restored =
+      backupFileName.isEmpty()
+          ? dbInstance->restoreSnapshot(snapshots[choices.indexOf(choice)].id,
+                                        &error)
+          : dbInstance->restoreDBfile(backupFileName, &error);
+  QApplication::restoreOverrideCursor();
+  if (!restored && SQliteDB::hasPendingRestore()) {
+    QMessageBox::information(this, "Backup Restoration",
+                             "Restart to finish the restore.\n\n" + error);
+    return;
+  }
+  if (!restored) {
+    QMessageBox::warning(this, "Failed !!!",
+                         "Nothing was restored.\n\n" + error);
+    return;
+  }
 
+  showLastBackup();
+  loadRetention();
   QMessageBox::information(
       this, "Backup Restoration",
-      "For safety measurements, we have made a backup of the current database. "
-      "Now, the data will be replaced with the data from the backup/sqlite "
-      "file you have just selected.\n\nIf you want to get back your data, you "
-      "can restore it again. SQLite backup filename contains timestamp "
-      "reffering when backup was performed.");
+      "The backup is restored. For safety, the data you had before is kept "
+      "as a snapshot; restore it to get it back.");
 }
 
 void Settings::on_createBackup_clicked() {
-  QString newlyCreatedBackup = dbInstance->backupDBfile();
-  QFile newlyCreatedBackupFile(newlyCreatedBackup);
-  if (!newlyCreatedBackupFile.open(QFile::ReadOnly)) {
+  // Writes queued so far are committed first, so the snapshot has them.
+  // The copy itself runs on a worker while the app keeps writing.
+  DbWriter::instance()->flush();
+  manualBackup = true;
+  ui->createBackup->setEnabled(false);
+  ui->restoreBackup->setEnabled(false);
+  ui->backupProgress->setValue(0);
+  ui->backupProgress->setVisible(true);
+
+  // An automatic snapshot is running and may have started before those
+  // writes: this one follows when it is done
+  if (!BackupStore::instance()->start()) {
+    backupQueued = true;
+    ui->lastBackup->setText(
+        "An automatic backup is in progress, yours starts after it");
+  }
+}
+
+void Settings::onBackupProgress(int copiedPages, int totalPages) {
+  // Automatic snapshots show up here as well
+  ui->backupProgress->setVisible(true);
+  ui->backupProgress->setMaximum(totalPages);
+  ui->backupProgress->setValue(copiedPages);
+}
+
+void Settings::onBackupFinished(bool ok, const SnapshotInfo &info,
+                                const QString &error) {
+  // The automatic one a click waited for; the click's own comes next
+  // (should that not start, the click gets this result)
+  if (backupQueued) {
+    backupQueued = false;
+    showLastBackup();
+    if (BackupStore::instance()->start())
+      return;
+  }
+
+  ui->createBackup->setEnabled(true);
+  ui->restoreBackup->setEnabled(true);
+  ui->backupProgress->setVisible(false);
+  showLastBackup();
+  if (!manualBackup)
+    return; // automatic snapshots only report to the log
+  manualBackup = false;
+
+  if (!ok) {
     QMessageBox::warning(this, "Failed !!!",
-                         "Failed to create backup! Please make sure .... ");
-  } else {
-    QMessageBox::information(this, "Success",
-                             "Succcessfully backup created at location: \n\n" +
-                                 newlyCreatedBackup);
+                         "Failed to create backup!\n\n" + error);
+    return;
   }
+  QMessageBox::information(
+      this, "Success",
+      info.unchanged
+          ? QString("Nothing changed since the last snapshot (%1).")
+                .arg(info.id)
+          : QString("Snapshot %1 created: %2 of %3 chunks were new, %4 KiB "
+                    "stored.")
+                .arg(info.id)
+                .arg(info.newChunks)
+                .arg(info.chunkCount)
+                .arg(info.storedBytes / 1024));
 }
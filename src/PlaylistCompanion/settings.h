@@ -3,6 +3,11 @@
 
 #include <QWidget>
 #include <include/db_sqlite.h>
+#include <include/backupstore.h>
+#include <include/dbwriter.h>
+#include <include/playerdiscovery.h>
+#include <include/thumbnailservice.h>
+#include <include/tracing.h>
 #include <QVector>
 
 namespace Ui {
@@ -16,16 +21,34 @@ public:
   explicit Settings(QWidget *parent = nullptr);
   ~Settings();
 
+  // Hit rates shown under the trace summary; the service outlives this
+  void setThumbnails(const ThumbnailService *service);
+
 private slots:
   void on_restoreBackup_clicked();
   void on_createBackup_clicked();
   void on_dfltMediaPlayerComboBox_currentTextChanged(const QString &arg1);
+  void onBackupProgress(int copiedPages, int totalPages);
+  void onBackupFinished(bool ok, const SnapshotInfo &info,
+                        const QString &error);
+  void onRetentionChanged();
+  void on_refreshTraceSummary_clicked();
+  void on_exportTrace_clicked();
 
 private:
   Ui::Settings *ui;
   SQliteDB *dbInstance;
-
-  void updatePlayerList(Ui::Settings *ui);
+  bool manualBackup = false; // finished() of a "Create Backup" click
+  bool backupQueued = false; // that click came during an automatic one
+  const ThumbnailService *thumbnails = nullptr;
+
+  void showPlayers(); // from MediaPlayerPath, no filesystem access
+  void updatePlayerList(Ui::Settings *ui, const QVector<FoundPlayer> &players);
+  void updateDfltCombo(const QVector<FoundPlayer> &players);
+  void showLastBackup();
+  void showTraceSummary();
+  void showThumbnailStats();
+  void loadRetention();
 };
 
 #endif // SETTINGS_H
@@ -0,0 +1,52 @@
+#include "include/startuptrace.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstdio>
+
+QElapsedTimer StartupTrace::clock;
+QVector<StartupTrace::Phase> StartupTrace::phases;
+bool StartupTrace::enabled = false;
+bool StartupTrace::finished = false;
+
+void StartupTrace::start() { clock.start(); }
+
+void StartupTrace::setEnabled(bool on) { enabled = on; }
+
+void StartupTrace::phase(const char *name) {
+  if (finished || !clock.isValid())
+    return;
+  phases.append({name, clock.nsecsElapsed()});
+}
+
+void StartupTrace::finish() {
+  if (finished)
+    return;
+  finished = true;
+  if (!enabled)
+    return;
+
+  // 1. Phases in the order they ended
+  const auto ms = [](qint64 ns) { return double(ns / 1000) / 1000.0; };
+  QJsonArray list;
+  qint64 previousNs = 0;
+  double firstPaintMs = -1;
+  for (const Phase &p : std::as_const(phases)) {
+    list.append(QJsonObject{{"phase", p.name},
+                            {"ms", ms(p.endNs - previousNs)},
+                            {"atMs", ms(p.endNs)}});
+    if (firstPaintMs < 0 && qstrcmp(p.name, "first paint") == 0)
+      firstPaintMs = ms(p.endNs);
+    previousNs = p.endNs;
+  }
+
+  // 2. One line, flushed: scripts run the app and read it from a pipe
+  const QJsonObject report{{"startup", list},
+                           {"firstPaintMs", firstPaintMs},
+                           {"readyMs", ms(clock.nsecsElapsed())}};
+  const QByteArray line = QJsonDocument(report).toJson(QJsonDocument::Compact);
+  std::fwrite(line.constData(), 1, size_t(line.size()), stdout);
+  std::fputc('\n', stdout);
+  std::fflush(stdout);
+}
@@ -0,0 +1,341 @@
+#include "include/thumbnailservice.h"
+#include "include/db_sqlite.h"
+#include "include/mediaprobe.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QVector>
+#include <algorithm>
+
+#ifdef PLC_HAVE_MULTIMEDIA
+#include <QMediaPlayer>
+#include <QUrl>
+#include <QVideoFrame>
+#include <QVideoSink>
+#endif
+
+namespace {
+
+QString memoryKey(const QString &path, int width) {
+  return path + '@' + QString::number(width);
+}
+
+// Marker next to where the .jpg would be: this file has nothing to show
+QString noneMarker(const QString &jpgPath) {
+  return jpgPath.left(jpgPath.size() - 4) + ".none";
+}
+
+} // namespace
+
+ThumbnailService::ThumbnailService(QObject *parent)
+    : QObject(parent), memory(kMemoryCacheKiB) {
+  // Decoding JPEGs and reading headers; two threads leave the cores to
+  // the scanner and the prober
+  pool.setMaxThreadCount(kWorkerThreads);
+  pool.start(&ThumbnailService::trimDiskCache, -1);
+
+#ifdef PLC_HAVE_MULTIMEDIA
+  // One player, one file at a time: seek to 10%, take the first frame
+  player = new QMediaPlayer(this);
+  sink = new QVideoSink(this);
+  player->setVideoOutput(sink);
+  connect(sink, &QVideoSink::videoFrameChanged, this,
+          &ThumbnailService::onFrame);
+  connect(player, &QMediaPlayer::mediaStatusChanged, this,
+          [this](QMediaPlayer::MediaStatus status) {
+            if (!grabbing)
+              return;
+            if (status == QMediaPlayer::LoadedMedia) {
+              if (player->duration() > 0)
+                player->setPosition(player->duration() / 10);
+              player->play();
+            } else if (status == QMediaPlayer::InvalidMedia) {
+              finishGrab(QVideoFrame(), true);
+            }
+          });
+  // Errors other than an unplayable file (a busy device, a decoder that
+  // died) and timeouts are not remembered across runs
+  connect(player, &QMediaPlayer::errorOccurred, this, [this]() {
+    if (grabbing)
+      finishGrab(QVideoFrame(),
+                 player->mediaStatus() == QMediaPlayer::InvalidMedia);
+  });
+  grabTimer.setSingleShot(true);
+  connect(&grabTimer, &QTimer::timeout, this,
+          [this]() { finishGrab(QVideoFrame(), false); });
+#endif
+}
+
+ThumbnailService::~ThumbnailService() {
+  prefetchRound++; // queued prefetches return at once
+  pool.clear();
+  pool.waitForDone();
+  logStats();
+}
+
+QPixmap ThumbnailService::cached(const QString &path, int width) const {
+  const QPixmap *pixmap = memory.object(memoryKey(path, width));
+  return pixmap ? *pixmap : QPixmap();
+}
+
+QPixmap ThumbnailService::request(const QString &path, int width) {
+  const QString key = memoryKey(path, width);
+  if (const QPixmap *pixmap = memory.object(key)) {
+    counters.memoryHits++;
+    return *pixmap;
+  }
+  if (!failed.contains(path) && !pending.contains(key))
+    start(Job{path, width, 0}, 1); // ahead of every prefetch
+  return QPixmap();
+}
+
+void ThumbnailService::prefetch(const QStringList &paths, int width) {
+  const int round = ++prefetchRound;
+  for (const QString &path : paths) {
+    const QString key = memoryKey(path, width);
+    if (memory.contains(key)) {
+      counters.memoryHits++;
+      continue;
+    }
+    if (!failed.contains(path) && !pending.contains(key))
+      start(Job{path, width, round}, 0);
+  }
+}
+
+bool ThumbnailService::hasNoThumbnail(const QString &path) const {
+  return failed.contains(path);
+}
+
+ThumbnailStats ThumbnailService::stats() const {
+  ThumbnailStats result = counters;
+  result.diskHits = diskHits;
+  result.generated = generated;
+  return result;
+}
+
+void ThumbnailService::logStats() const {
+  const ThumbnailStats s = stats();
+  const quint64 hits = s.memoryHits + s.diskHits;
+  thumbdebug << "requests" << s.requests() << "| memory hits" << s.memoryHits
+             << "| disk hits" << s.diskHits << "| generated" << s.generated
+             << "| none" << s.failures << "| hit rate"
+             << (s.requests() ? hits * 100 / s.requests() : 0) << "%";
+}
+
+void ThumbnailService::start(const Job &job, int priority) {
+  pending.insert(memoryKey(job.path, job.width));
+  pool.start(
+      [this, job]() {
+        QImage image;
+        const Outcome outcome = load(job, image);
+        QMetaObject::invokeMethod(
+            this,
+            [this, job, outcome, image]() { deliver(job, outcome, image); },
+            Qt::QueuedConnection);
+      },
+      priority);
+}
+
+void ThumbnailService::deliver(const Job &job, Outcome outcome,
+                               const QImage &image) {
+  const QString key = memoryKey(job.path, job.width);
+  switch (outcome) {
+  case Outcome::Ready:
+    pending.remove(key);
+    // QPixmap only exists on the GUI thread; cost in KiB
+    memory.insert(key, new QPixmap(QPixmap::fromImage(image)),
+                  qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+    emit thumbnailReady(job.path, job.width);
+    break;
+  case Outcome::NeedsFrame:
+#ifdef PLC_HAVE_MULTIMEDIA
+    // Still pending until the grab is done
+    if (job.prefetchRound == 0)
+      grabQueue.prepend(job);
+    else
+      grabQueue.append(job);
+    grabNext();
+    break;
+#else
+    [[fallthrough]]; // load() never asks for a frame without Multimedia
+#endif
+  case Outcome::Failed:
+    pending.remove(key);
+    failed.insert(job.path);
+    counters.failures++;
+    emit thumbnailReady(job.path, job.width); // cached() stays null
+    break;
+  case Outcome::Dropped:
+    pending.remove(key);
+    break;
+  }
+}
+
+ThumbnailService::Outcome ThumbnailService::load(const Job &job,
+                                                 QImage &image) {
+  // 1. Scrolled past since it was queued
+  if (job.prefetchRound != 0 && job.prefetchRound != prefetchRound)
+    return Outcome::Dropped;
+
+  const QString jpgPath = diskPath(job.path);
+  if (jpgPath.isEmpty())
+    return Outcome::Failed;
+
+  // 2. Disk cache. The mtime is bumped on every hit, so trimming drops
+  // the least recently used ones.
+  if (image.load(jpgPath)) {
+    diskHits++;
+    QFile jpg(jpgPath);
+    if (jpg.open(QIODevice::ReadWrite))
+      jpg.setFileTime(QDateTime::currentDateTime(),
+                      QFileDevice::FileModificationTime);
+    image = scaled(image, job.width);
+    return Outcome::Ready;
+  }
+  if (QFile::exists(noneMarker(jpgPath)))
+    return Outcome::Failed;
+
+  // 3. Embedded cover art: a few header reads, no decoder
+  const QImage cover = QImage::fromData(MediaProbe::coverArt(job.path));
+  if (!cover.isNull())
+    return store(job, cover, image, true);
+
+#ifdef PLC_HAVE_MULTIMEDIA
+  return Outcome::NeedsFrame;
+#else
+  return store(job, QImage(), image, true);
+#endif
+}
+
+ThumbnailService::Outcome ThumbnailService::store(const Job &job,
+                                                  const QImage &source,
+                                                  QImage &image,
+                                                  bool remember) {
+  const QString jpgPath = diskPath(job.path);
+  if (jpgPath.isEmpty())
+    return Outcome::Failed;
+  QDir().mkpath(QFileInfo(jpgPath).absolutePath());
+
+  if (source.isNull()) {
+    // Remembered across runs, so the file is not tried again until it
+    // changes (a new size / mtime is a new key)
+    QFile marker(noneMarker(jpgPath));
+    if (remember && marker.open(QIODevice::WriteOnly))
+      marker.close();
+    return Outcome::Failed; // in `failed` either way until the next run
+  }
+
+  const QImage thumb = scaled(source, kDiskWidth);
+  if (!thumb.save(jpgPath, "JPG", kJpegQuality))
+    qWarning() << "[ThumbnailService] Can not write" << jpgPath;
+  generated++;
+  image = scaled(thumb, job.width);
+  return Outcome::Ready;
+}
+
+QString ThumbnailService::diskPath(const QString &path) {
+  const QFileInfo info(path);
+  if (!info.exists())
+    return QString();
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(path.toUtf8());
+  hash.addData(QByteArray(1, '\0'));
+  hash.addData(QByteArray::number(info.size()));
+  hash.addData(QByteArray(1, '\0'));
+  hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+  const QString key = QString::fromLatin1(hash.result().toHex());
+  return cacheDir() + key.left(2) + "/" + key + ".jpg";
+}
+
+QString ThumbnailService::cacheDir() {
+  return SQliteDB::getDbDirPath() + "thumbnails/";
+}
+
+QImage ThumbnailService::scaled(const QImage &image, int width) {
+  if (image.width() <= width)
+    return image;
+  return image.scaledToWidth(width, Qt::SmoothTransformation);
+}
+
+void ThumbnailService::trimDiskCache() {
+  struct Entry {
+    qint64 mtime;
+    qint64 size;
+    QString path;
+  };
+  QVector<Entry> entries;
+  qint64 total = 0;
+  QDirIterator it(cacheDir(), {"*.jpg", "*.none"}, QDir::Files,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    const QFileInfo info = it.fileInfo();
+    entries.append({info.lastModified().toMSecsSinceEpoch(), info.size(),
+                    info.absoluteFilePath()});
+    total += info.size();
+  }
+  if (total <= kDiskCacheBytes)
+    return;
+
+  // Least recently used first, down to 3/4 so this does not run every time
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.mtime < b.mtime; });
+  int removed = 0;
+  for (const Entry &entry : std::as_const(entries)) {
+    if (total <= kDiskCacheBytes * 3 / 4)
+      break;
+    if (QFile::remove(entry.path)) {
+      total -= entry.size;
+      removed++;
+    }
+  }
+  thumbdebug << "disk cache trimmed:" << removed << "files removed";
+}
+
+#ifdef PLC_HAVE_MULTIMEDIA
+void ThumbnailService::grabNext() {
+  while (!grabbing && !grabQueue.isEmpty()) {
+    const Job job = grabQueue.takeFirst();
+    if (job.prefetchRound != 0 && job.prefetchRound != prefetchRound) {
+      pending.remove(memoryKey(job.path, job.width));
+      continue;
+    }
+    grabbing = true;
+    grabJob = job;
+    grabTimer.start(kGrabTimeoutMs);
+    player->setSource(QUrl::fromLocalFile(job.path));
+  }
+}
+
+void ThumbnailService::onFrame(const QVideoFrame &frame) {
+  // Frames before play() are left over from the previous file
+  if (grabbing && frame.isValid() &&
+      player->playbackState() == QMediaPlayer::PlayingState)
+    finishGrab(frame, false);
+}
+
+void ThumbnailService::finishGrab(const QVideoFrame &frame,
+                                  bool unplayable) {
+  grabTimer.stop();
+  player->stop();
+  player->setSource(QUrl());
+  grabbing = false;
+
+  // Converting and encoding the frame on the pool, not here
+  const Job job = grabJob;
+  pool.start([this, job, frame, unplayable]() {
+    QImage image;
+    const Outcome outcome = store(
+        job, frame.isValid() ? frame.toImage() : QImage(), image, unplayable);
+    QMetaObject::invokeMethod(
+        this, [this, job, outcome, image]() { deliver(job, outcome, image); },
+        Qt::QueuedConnection);
+  });
+  // Not from inside the player's signal
+  QTimer::singleShot(0, this, &ThumbnailService::grabNext);
+}
+#endif
@@ -0,0 +1,219 @@
+#include "include/tracing.h"
+
+#ifdef PLC_TRACING
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+  const char *name = nullptr;
+  qint64 startNs = 0;
+  qint64 durationNs = 0;
+  qint64 rows = -1;
+  QString detail;
+};
+
+// Events live in chunks that never move: the owner fills a slot, then
+// publishes it by bumping `published` (release). A reader takes
+// `published` (acquire) and may read every slot below it, while the owner
+// keeps appending behind.
+struct ThreadBuffer {
+  static constexpr int kChunkSize = 4096;
+  static constexpr int kChunks = Tracing::kMaxEventsPerThread / kChunkSize;
+
+  std::array<std::unique_ptr<TraceEvent[]>, kChunks> chunks;
+  std::atomic<int> published{0};
+  std::atomic<qint64> dropped{0};
+  int tid = 0;
+  QString threadName;
+
+  void append(TraceEvent &&event) {
+    const int index = published.load(std::memory_order_relaxed);
+    if (index >= Tracing::kMaxEventsPerThread) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    std::unique_ptr<TraceEvent[]> &chunk = chunks[index / kChunkSize];
+    if (!chunk)
+      chunk.reset(new TraceEvent[kChunkSize]);
+    chunk[index % kChunkSize] = std::move(event);
+    published.store(index + 1, std::memory_order_release);
+  }
+
+  const TraceEvent &at(int index) const {
+    return chunks[index / kChunkSize][index % kChunkSize];
+  }
+};
+
+// Buffers outlive their threads (pool threads come and go); the lock is
+// only taken when a thread records its first span and by readers
+QMutex registryMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> registry;
+thread_local ThreadBuffer *localBuffer = nullptr;
+
+ThreadBuffer *threadBuffer() {
+  if (localBuffer)
+    return localBuffer;
+  auto buffer = std::make_shared<ThreadBuffer>();
+  QThread *thread = QThread::currentThread();
+  QMutexLocker locker(&registryMutex);
+  buffer->tid = int(registry.size()) + 1;
+  buffer->threadName =
+      QCoreApplication::instance() &&
+              thread == QCoreApplication::instance()->thread()
+          ? QString("main")
+      : !thread->objectName().isEmpty()
+          ? thread->objectName()
+          : QString("thread %1").arg(buffer->tid);
+  registry.push_back(buffer);
+  localBuffer = buffer.get();
+  return localBuffer;
+}
+
+std::vector<std::shared_ptr<ThreadBuffer>> buffers() {
+  QMutexLocker locker(&registryMutex);
+  return registry;
+}
+
+qint64 nowNs() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+double toMs(qint64 ns) { return double(ns) / 1e6; }
+
+} // namespace
+
+TraceSpan::TraceSpan(const char *name) : name(name), startNs(nowNs()) {}
+
+TraceSpan::~TraceSpan() {
+  threadBuffer()->append(
+      {name, startNs, nowNs() - startNs, rows, std::move(detail)});
+}
+
+QVector<TraceSummary> Tracing::summary() {
+  // 1. Durations per name, from every buffer as far as it is published
+  QHash<QString, std::vector<qint64>> durations;
+  for (const auto &buffer : buffers()) {
+    const int count = buffer->published.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+      const TraceEvent &event = buffer->at(i);
+      durations[QString::fromLatin1(event.name)].push_back(event.durationNs);
+    }
+  }
+
+  // 2. Nearest-rank percentiles
+  QVector<TraceSummary> result;
+  for (auto it = durations.begin(); it != durations.end(); ++it) {
+    std::vector<qint64> &values = it.value();
+    std::sort(values.begin(), values.end());
+    const auto rank = [&values](double q) {
+      const size_t n = values.size();
+      const size_t index = size_t(std::ceil(q * double(n)));
+      return values[std::clamp<size_t>(index, 1, n) - 1];
+    };
+    TraceSummary s;
+    s.name = it.key();
+    s.count = int(values.size());
+    s.p50Ms = toMs(rank(0.50));
+    s.p99Ms = toMs(rank(0.99));
+    s.maxMs = toMs(values.back());
+    for (qint64 value : values)
+      s.totalMs += toMs(value);
+    result.append(s);
+  }
+  std::sort(result.begin(), result.end(),
+            [](const TraceSummary &a, const TraceSummary &b) {
+              return a.totalMs > b.totalMs;
+            });
+  return result;
+}
+
+bool Tracing::exportChrome(const QString &path, QString *error) {
+  const auto fail = [error](const QString &reason) {
+    if (error)
+      *error = reason;
+    qWarning() << "[Tracing]" << reason;
+    return false;
+  };
+
+  // 1. A name per thread track, then complete ("X") events in microseconds
+  QJsonArray events;
+  for (const auto &buffer : buffers()) {
+    events.append(QJsonObject{{"name", "thread_name"},
+                              {"ph", "M"},
+                              {"pid", 1},
+                              {"tid", buffer->tid},
+                              {"args", QJsonObject{{"name", buffer->threadName}}}});
+    const int count = buffer->published.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+      const TraceEvent &event = buffer->at(i);
+      QJsonObject args;
+      if (!event.detail.isEmpty())
+        args.insert("detail", event.detail);
+      if (event.rows >= 0)
+        args.insert("rows", event.rows);
+      QJsonObject entry{{"name", QString::fromLatin1(event.name)},
+                        {"cat", "plc"},
+                        {"ph", "X"},
+                        {"ts", double(event.startNs) / 1e3},
+                        {"dur", double(event.durationNs) / 1e3},
+                        {"pid", 1},
+                        {"tid", buffer->tid}};
+      if (!args.isEmpty())
+        entry.insert("args", args);
+      events.append(entry);
+    }
+  }
+
+  // 2. Written whole or not at all
+  const QJsonObject trace{{"traceEvents", events},
+                          {"displayTimeUnit", "ms"},
+                          {"otherData",
+                           QJsonObject{{"droppedEvents", droppedEvents()}}}};
+  QSaveFile out(path);
+  if (!out.open(QIODevice::WriteOnly) ||
+      out.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) < 0 ||
+      !out.commit())
+    return fail("Cannot write " + path + ": " + out.errorString());
+  return true;
+}
+
+qint64 Tracing::droppedEvents() {
+  qint64 dropped = 0;
+  for (const auto &buffer : buffers())
+    dropped += buffer->dropped.load(std::memory_order_relaxed);
+  return dropped;
+}
+
+#else // no PLC_TRACING: nothing was recorded
+
+QVector<TraceSummary> Tracing::summary() { return {}; }
+
+bool Tracing::exportChrome(const QString &, QString *error) {
+  if (error)
+    *error = "Tracing is not built in (qmake CONFIG+=tracing)";
+  return false;
+}
+
+qint64 Tracing::droppedEvents() { return 0; }
+
+#endif // PLC_TRACING
@@ -0,0 +1,131 @@
+#include "include/videoingest.h"
+#include "include/naturalsortkey.h"
+#include "include/playlistrescanner.h"
+#include "include/videosearch.h"
+
+#include <QElapsedTimer>
+
+namespace {
+
+QString insertSql(int rows) {
+  QString sql = "INSERT INTO Video (playlistID, videoPath, videoTitle, "
+                "sortKey, searchText, fileSize, fileMtime) VALUES ";
+  sql.reserve(sql.size() + rows * 25);
+  for (int i = 0; i < rows; ++i)
+    sql += (i == 0) ? "(?, ?, ?, ?, ?, ?, ?)" : ", (?, ?, ?, ?, ?, ?, ?)";
+  return sql;
+}
+
+} // namespace
+
+QString VideoIngest::titleOf(const QString &videoPath) {
+  const QString fileName = videoPath.mid(videoPath.lastIndexOf('/') + 1);
+  const qsizetype dot = fileName.lastIndexOf('.');
+  return dot > 0 ? fileName.left(dot) : fileName;
+}
+
+IngestStats VideoIngest::insertVideos(int playlistId,
+                                      const QString &playlistPath,
+                                      const VideoCollection &vdos) {
+  QElapsedTimer timer;
+  timer.start();
+
+  IngestStats stats;
+  DbWriter *writer = DbWriter::instance();
+  QSqlDatabase &db = writer->database();
+  const PathStore &paths = vdos.fileList;
+  const QString fullStatement = insertSql(kRowsPerStatement);
+
+  // 1. Videos, one transaction per chunk
+  for (int chunkStart = 0; chunkStart < paths.size() && stats.ok;
+       chunkStart += kRowsPerTransaction) {
+    const int chunkEnd =
+        qMin(chunkStart + kRowsPerTransaction, int(paths.size()));
+    if (!db.transaction()) {
+      stats.ok = false;
+      break;
+    }
+
+    for (int first = chunkStart; first < chunkEnd && stats.ok;
+         first += kRowsPerStatement) {
+      const int count = qMin(kRowsPerStatement, chunkEnd - first);
+      QVariantList binds;
+      binds.reserve(count * 7);
+      for (int i = first; i < first + count; ++i) {
+        // The row keeps the path below the playlist folder; title, sort
+        // key and search words come from the whole path
+        const QString path = paths.path(i);
+        binds << playlistId << PathStore::relativeTo(playlistPath, path)
+              << titleOf(path) << naturalSortKey(path)
+              << VideoSearch::indexText(path);
+        // Size and mtime from the scan, for telling renames apart later
+        const FileIdentity identity =
+            i < vdos.identities.size() ? vdos.identities[i] : FileIdentity();
+        binds << (identity.isValid() ? QVariant(identity.size) : QVariant())
+              << (identity.isValid() ? QVariant(identity.mtimeMs)
+                                     : QVariant());
+      }
+      // Full batches always reuse the same cached statement
+      stats.ok = writer
+                     ->execPrepared(count == kRowsPerStatement
+                                        ? fullStatement
+                                        : insertSql(count),
+                                    binds)
+                     .isActive();
+    }
+
+    if (stats.ok && db.commit()) {
+      stats.rows += chunkEnd - chunkStart;
+    } else {
+      stats.ok = false;
+      db.rollback();
+    }
+  }
+
+  // 2. Folder fingerprints, so the first rescan can skip unchanged folders
+  if (stats.ok && !vdos.dirFingerprints.isEmpty() && db.transaction()) {
+    if (PlaylistRescanner::storeFingerprints(playlistId, vdos.dirFingerprints))
+      db.commit();
+    else
+      db.rollback();
+  }
+
+  stats.elapsedMs = timer.elapsed();
+  stats.rowsPerSecond =
+      stats.elapsedMs > 0 ? stats.rows * 1000.0 / stats.elapsedMs : stats.rows;
+  ingestdebug << "playlist" << playlistId << ":" << stats.rows << "rows in"
+              << stats.elapsedMs << "ms (" << qRound(stats.rowsPerSecond)
+              << "rows/s )" << (stats.ok ? "" : "FAILED");
+  return stats;
+}
+
+int VideoIngest::createPlaylist(const Playlist &pl, const VideoCollection &vdos,
+                                IngestStats *stats) {
+  DbWriter *writer = DbWriter::instance();
+
+  // 1. The Playlist row; values are bound, quotes need no escaping
+  QSqlQuery insert = writer->execPrepared(
+      "INSERT INTO Playlist (playlistTitle, playlistPath, status, "
+      "totalTimeHour, watchFolder) VALUES (?, ?, ?, ?, ?)",
+      {pl.playlistTitle, pl.playlistPath, pl.status, pl.totalTimeHour,
+       pl.watchFolder});
+  const QVariant lastId = insert.lastInsertId();
+  insert.finish();
+  if (!lastId.isValid()) {
+    qCritical() << "[VideoIngest] Could not create playlist"
+                << pl.playlistPath;
+    return -1;
+  }
+  const int playlistId = lastId.toInt();
+
+  // 2. Its videos, chunked; also seeds the folder fingerprints for rescans
+  IngestStats videoStats;
+  if (!vdos.fileList.isEmpty())
+    videoStats = insertVideos(playlistId, pl.playlistPath, vdos);
+  if (!videoStats.ok)
+    qCritical() << "[VideoIngest] Video import incomplete:" << videoStats.rows
+                << "of" << vdos.fileList.size();
+  if (stats)
+    *stats = videoStats;
+  return playlistId;
+}
@@ -0,0 +1,217 @@
+#include "include/videoscanner.h"
+#include "include/naturalsortkey.h"
+#include "include/tracing.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QPair>
+#include <QThread>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/stat.h>
+#endif
+
+VideoScanner::VideoScanner(QObject *parent) : QObject(parent) {
+  // Directory listing is I/O bound (network shares especially), so allow a
+  // few more threads than cores.
+  pool.setMaxThreadCount(qMax(4, QThread::idealThreadCount()));
+}
+
+VideoScanner::~VideoScanner() {
+  cancel();
+  pool.waitForDone();
+}
+
+const QStringList &VideoScanner::videoNameFilters() {
+  static const QStringList filters = {"*.mp4", "*.avi", "*.mkv", "*.mov",
+                                      "*.wmv", "*.flv", "*.webm", "*.ts"};
+  return filters;
+}
+
+bool VideoScanner::readFingerprint(const QString &dirPath,
+                                   DirFingerprint &fp) {
+  fp.dirPath = dirPath;
+#ifdef __linux__
+  struct stat st;
+  if (::stat(QFile::encodeName(dirPath).constData(), &st) != 0 ||
+      !S_ISDIR(st.st_mode))
+    return false;
+  fp.mtime = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  fp.inode = quint64(st.st_ino);
+#else
+  QFileInfo info(dirPath);
+  if (!info.isDir())
+    return false;
+  fp.mtime = info.lastModified().toMSecsSinceEpoch();
+  fp.inode = 0;
+#endif
+  return true;
+}
+
+void VideoScanner::listDirectory(const QString &dirPath, QStringList &files,
+                                 QStringList &subdirs,
+                                 QVector<FileIdentity> *identities,
+                                 const std::atomic_bool *cancelFlag) {
+  // QDir::AllDirs -> directories are listed even though they do not match
+  // the name filters. No Subdirectories flag: callers decide how to recurse.
+  QDirIterator it(dirPath, videoNameFilters(),
+                  QDir::Files | QDir::AllDirs | QDir::NoDotAndDotDot);
+  while (it.hasNext() && !(cancelFlag && *cancelFlag)) {
+    const QString path = it.next();
+    const QFileInfo info = it.fileInfo();
+    if (info.isDir()) {
+      // Same as the old recursive QDirIterator: symlinks are not followed
+      if (!info.isSymLink())
+        subdirs.append(path);
+    } else {
+      files.append(path);
+      if (identities)
+        identities->append(
+            {info.size(), info.lastModified().toMSecsSinceEpoch()});
+    }
+  }
+}
+
+QVector<PathStore::Handle> VideoScanner::naturalSort(PathStore &paths) {
+  // One key per path up front, then plain byte compares. Much cheaper than
+  // a numeric QCollator compare on every one of the n*log(n) comparisons.
+  // Only the handles are sorted; the names stay where they were appended.
+  QVector<QPair<QByteArray, PathStore::Handle>> keyed;
+  keyed.reserve(paths.size());
+  for (int i = 0; i < paths.size(); ++i)
+    keyed.append({naturalSortKey(paths.path(i)), PathStore::Handle(i)});
+  std::sort(keyed.begin(), keyed.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+  QVector<PathStore::Handle> order;
+  order.reserve(keyed.size());
+  for (const auto &entry : std::as_const(keyed))
+    order.append(entry.second);
+  paths.reorder(order);
+  return order;
+}
+
+void VideoScanner::start(const QString &rootPath) {
+  if (running) {
+    cancel();
+    pool.waitForDone();
+  }
+
+  // 1. Reset state from a previous run
+  cancelRequested = false;
+  running = true;
+  pendingDirs = 0;
+  scannedDirs = 0;
+  filesFound = 0;
+  {
+    QMutexLocker locker(&foundMutex);
+    found = PathStore(rootPath);
+    foundIdentities.clear();
+    fingerprints.clear();
+  }
+
+  scandebug << "scan started:" << rootPath;
+
+  // 2. The root is the first task, every subdirectory spawns its own
+  enqueueDirectory(rootPath, QString());
+}
+
+void VideoScanner::cancel() { cancelRequested = true; }
+
+bool VideoScanner::isRunning() const { return running; }
+
+void VideoScanner::enqueueDirectory(const QString &dirPath,
+                                    const QString &parentPath) {
+  // Must be counted before it is started, so pendingDirs can not drop to
+  // zero while the parent is still handing out children.
+  pendingDirs++;
+  pool.start(
+      [this, dirPath, parentPath]() { scanDirectory(dirPath, parentPath); });
+}
+
+void VideoScanner::scanDirectory(const QString &dirPath,
+                                 const QString &parentPath) {
+  QStringList files;
+  QStringList subdirs;
+  QVector<FileIdentity> identities;
+  DirFingerprint fp;
+  bool haveFingerprint = false;
+
+  if (!cancelRequested) {
+    PLC_TRACE_SPAN(span, "scan.dir");
+    PLC_TRACE_DETAIL(span, dirPath);
+    // Fingerprint first: a change made while listing then shows up as a
+    // mismatch on the next rescan instead of being missed.
+    haveFingerprint = readFingerprint(dirPath, fp);
+    listDirectory(dirPath, files, subdirs, &identities, &cancelRequested);
+    PLC_TRACE_ROWS(span, files.size());
+    for (const QString &subdir : std::as_const(subdirs))
+      enqueueDirectory(subdir, dirPath);
+  }
+
+  if (!files.isEmpty() || haveFingerprint) {
+    QMutexLocker locker(&foundMutex);
+    for (const QString &file : std::as_const(files))
+      found.add(file);
+    foundIdentities.append(identities);
+    if (haveFingerprint) {
+      fp.parentPath = parentPath;
+      fp.entryCount = int(files.size() + subdirs.size());
+      fingerprints.append(fp);
+    }
+  }
+
+  const int total = (filesFound += int(files.size()));
+  const int scanned = ++scannedDirs;
+  const int pending = pendingDirs - 1;
+
+  // Counts to the thread that owns the scanner; the paths stay here
+  QMetaObject::invokeMethod(
+      this,
+      [this, scanned, pending, total]() {
+        emit progress(scanned, pending, total);
+      },
+      Qt::QueuedConnection);
+
+  if (--pendingDirs == 0)
+    finishScan();
+}
+
+void VideoScanner::finishScan() {
+  if (cancelRequested) {
+    running = false;
+    scandebug << "scan cancelled";
+    QMetaObject::invokeMethod(
+        this, [this]() { emit cancelled(); }, Qt::QueuedConnection);
+    return;
+  }
+
+  VideoCollection result;
+  {
+    QMutexLocker locker(&foundMutex);
+    result.fileList = std::move(found);
+    result.identities = std::move(foundIdentities);
+    result.dirFingerprints = fingerprints;
+    found = PathStore();
+    foundIdentities.clear();
+    fingerprints.clear();
+  }
+  result.count = result.fileList.size();
+
+  // Sort here, on the worker, not on the GUI thread
+  const QVector<PathStore::Handle> order = naturalSort(result.fileList);
+  QVector<FileIdentity> sorted;
+  sorted.reserve(order.size());
+  for (PathStore::Handle handle : order)
+    sorted.append(result.identities[handle]);
+  result.identities = std::move(sorted);
+
+  running = false;
+  scandebug << "scan finished:" << result.count << "videos in"
+            << scannedDirs.load() << "folders";
+  QMetaObject::invokeMethod(
+      this, [this, result]() { emit finished(result); },
+      Qt::QueuedConnection);
+}
@@ -0,0 +1,195 @@
+#include "include/videosearch.h"
+#include "include/db_sqlite.h"
+#include "include/pathstore.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+
+namespace {
+
+enum class CharClass { Other, Lower, Upper, Digit };
+
+CharClass classOf(QChar c) {
+  if (c.isDigit())
+    return CharClass::Digit;
+  if (c.isUpper())
+    return CharClass::Upper;
+  if (c.isLetter() || c.isMark())
+    return CharClass::Lower; // also scripts without case
+  return CharClass::Other;
+}
+
+// Words of a text: runs of letters and digits, anything else separates
+QStringList wordsOf(const QString &text) {
+  QStringList words;
+  qsizetype start = -1;
+  for (qsizetype i = 0; i <= text.size(); ++i) {
+    const bool inWord =
+        i < text.size() && classOf(text[i]) != CharClass::Other;
+    if (inWord && start < 0) {
+      start = i;
+    } else if (!inWord && start >= 0) {
+      words.append(text.mid(start, i - start));
+      start = -1;
+    }
+  }
+  return words;
+}
+
+QString quoted(const QString &term, bool prefix) {
+  // Terms are letters and digits only, nothing to escape
+  return '"' + term + (prefix ? "\"*" : "\"");
+}
+
+} // namespace
+
+QStringList VideoSearch::splitWord(const QString &word) {
+  QStringList parts;
+  qsizetype start = 0;
+  for (qsizetype i = 1; i < word.size(); ++i) {
+    const CharClass prev = classOf(word[i - 1]);
+    const CharClass cur = classOf(word[i]);
+    const bool digitEdge =
+        (prev == CharClass::Digit) != (cur == CharClass::Digit);
+    // "deepLearning" -> deep|Learning, "HTTPServer" -> HTTP|Server
+    const bool camelHump =
+        (prev == CharClass::Lower && cur == CharClass::Upper) ||
+        (prev == CharClass::Upper && cur == CharClass::Upper &&
+         i + 1 < word.size() && classOf(word[i + 1]) == CharClass::Lower);
+    if (digitEdge || camelHump) {
+      parts.append(word.mid(start, i - start));
+      start = i;
+    }
+  }
+  if (start < word.size())
+    parts.append(word.mid(start));
+  return parts;
+}
+
+QString VideoSearch::indexText(const QString &path) {
+  QStringList terms;
+  for (const QString &word : wordsOf(path)) {
+    const QStringList parts = splitWord(word);
+    terms.append(parts);
+    // "DeepLearning" is also found as "deeplearn". Not for words with
+    // digits: "Lecture1" ... "Lecture900" would each be a term of their own
+    // and make every "lecture*" prefix query merge all of them.
+    if (parts.size() > 1 &&
+        std::none_of(word.cbegin(), word.cend(),
+                     [](QChar c) { return c.isDigit(); }))
+      terms.append(word);
+  }
+  return terms.join(' ');
+}
+
+QString VideoSearch::matchExpression(const QString &typed, bool allPrefix) {
+  QStringList terms;
+  for (const QString &word : wordsOf(typed))
+    terms.append(splitWord(word));
+  if (terms.isEmpty())
+    return QString();
+
+  // A trailing space means the last word is complete as well
+  const bool typingLast = !typed.isEmpty() && !typed.back().isSpace();
+  QStringList match;
+  for (qsizetype i = 0; i < terms.size(); ++i) {
+    const bool last = i == terms.size() - 1;
+    const bool prefix =
+        terms[i].size() >= 2 && (allPrefix || (last && typingLast));
+    match.append(quoted(terms[i], prefix));
+  }
+  return match.join(' '); // implicit AND
+}
+
+QVector<SearchHit> VideoSearch::search(const QString &typed, int limit) {
+  QElapsedTimer timer;
+  timer.start();
+
+  // 1. Whole words as typed, the last one still being typed
+  const QString match = matchExpression(typed);
+  if (match.isEmpty())
+    return {};
+  QVector<SearchHit> hits = searchVideos(match, limit);
+  hits += searchNotes(match, limit);
+
+  // 2. Nothing: maybe an earlier word was cut short too
+  if (hits.isEmpty()) {
+    const QString loose = matchExpression(typed, true);
+    if (loose != match) {
+      hits = searchVideos(loose, limit);
+      hits += searchNotes(loose, limit);
+    }
+  }
+
+  // 3. One list; bm25 scores of both tables are close enough to mix
+  std::stable_sort(hits.begin(), hits.end(),
+                   [](const SearchHit &a, const SearchHit &b) {
+                     return a.score < b.score;
+                   });
+  if (hits.size() > limit)
+    hits.resize(limit);
+
+  searchdebug << typed << ":" << hits.size() << "hits in" << timer.elapsed()
+              << "ms";
+  return hits;
+}
+
+QVector<SearchHit> VideoSearch::searchVideos(const QString &match, int limit) {
+  // The inner query ranks every match (FTS5 keeps only the best `limit`
+  // while it goes), then the few rows shown are joined
+  QSqlQuery query = SQliteDB::instance()->execRead(
+      "SELECT v.playlistID, v.videoID, v.videoTitle, v.videoPath, "
+      "p.playlistTitle, hit.score, p.playlistPath "
+      "FROM (SELECT rowid AS id, rank AS score FROM VideoSearch "
+      "  WHERE VideoSearch MATCH ? ORDER BY rank LIMIT ?) AS hit "
+      "JOIN Video v ON v.videoID = hit.id "
+      "JOIN Playlist p ON p.playlistId = v.playlistID "
+      "ORDER BY hit.score",
+      {match, limit});
+  if (!query.isActive())
+    return {}; // logged by execRead()
+
+  QVector<SearchHit> hits;
+  while (query.next()) {
+    SearchHit hit;
+    hit.playlistId = query.value(0).toInt();
+    hit.videoId = query.value(1).toInt();
+    hit.title = query.value(2).toString();
+    hit.detail = PathStore::absoluteOf(query.value(6).toString(),
+                                       query.value(3).toString());
+    hit.playlistTitle = query.value(4).toString();
+    hit.score = query.value(5).toDouble();
+    hits.append(hit);
+  }
+  return hits;
+}
+
+QVector<SearchHit> VideoSearch::searchNotes(const QString &match, int limit) {
+  QSqlQuery query = SQliteDB::instance()->execRead(
+      "SELECT n.playlistId, IFNULL(n.videoID, -1), n.noteID, "
+      "IFNULL(v.videoTitle, p.playlistTitle), p.playlistTitle, "
+      "substr(n.noteText, 1, 200), hit.score "
+      "FROM (SELECT rowid AS id, rank AS score FROM NoteSearch "
+      "  WHERE NoteSearch MATCH ? ORDER BY rank LIMIT ?) AS hit "
+      "JOIN Notes n ON n.noteID = hit.id "
+      "JOIN Playlist p ON p.playlistId = n.playlistId "
+      "LEFT JOIN Video v ON v.videoID = n.videoID "
+      "ORDER BY hit.score",
+      {match, limit});
+  if (!query.isActive())
+    return {}; // logged by execRead()
+
+  QVector<SearchHit> hits;
+  while (query.next()) {
+    SearchHit hit;
+    hit.playlistId = query.value(0).toInt();
+    hit.videoId = query.value(1).toInt();
+    hit.noteId = query.value(2).toInt();
+    hit.title = query.value(3).toString();
+    hit.playlistTitle = query.value(4).toString();
+    hit.detail = query.value(5).toString().simplified();
+    hit.score = query.value(6).toDouble();
+    hits.append(hit);
+  }
+  return hits;
+}
@@ -0,0 +1,386 @@
+#include "include/videotablemodel.h"
+#include "include/db_sqlite.h"
+#include "include/naturalsortkey.h"
+#include "include/thumbnailservice.h"
+#include "include/tracing.h"
+
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+
+VideoTableModel::VideoTableModel(QObject *parent)
+    : QAbstractTableModel(parent) {}
+
+void VideoTableModel::setPlaylist(int playlistId) {
+  PLC_TRACE_SPAN(span, "model.reset");
+  beginResetModel();
+  currentPlaylistId = playlistId;
+  // Pages hand out videoPath as stored, below the playlist folder
+  QString rootPath;
+  if (playlistId > 0) {
+    QSqlQuery root = SQliteDB::instance()->execPrepared(
+        "SELECT playlistPath FROM Playlist WHERE playlistId = ?",
+        {playlistId});
+    if (root.next())
+      rootPath = root.value(0).toString();
+    root.finish();
+  }
+  pathStore = PathStore(rootPath);
+  ids.clear();
+  pageEndKey.clear();
+  pageEndId = -1;
+  paths.clear();
+  watched.clear();
+  durations.clear();
+  rowIndex.clear();
+  allFetched = playlistId <= 0;
+  endResetModel();
+}
+
+int VideoTableModel::playlistId() const { return currentPlaylistId; }
+
+void VideoTableModel::setThumbnails(ThumbnailService *service, int width) {
+  thumbnails = service;
+  thumbnailWidth = width;
+}
+
+int VideoTableModel::videoIdAt(int row) const {
+  return (row >= 0 && row < ids.size()) ? ids[row] : -1;
+}
+
+QString VideoTableModel::videoPathAt(int row) const {
+  return (row >= 0 && row < paths.size()) ? pathStore.path(paths[row])
+                                           : QString();
+}
+
+qsizetype VideoTableModel::memoryBytes() const {
+  return ids.capacity() * sizeof(int) +
+         paths.capacity() * sizeof(PathStore::Handle) +
+         watched.capacity() * sizeof(quint8) +
+         durations.capacity() * sizeof(qint64) + pathStore.memoryBytes();
+}
+
+int VideoTableModel::rowOf(int videoId) const {
+  // Rows are not in id order; the map is dropped whenever rows move
+  if (rowIndex.size() != ids.size()) {
+    rowIndex.clear();
+    rowIndex.reserve(ids.size());
+    for (int row = 0; row < ids.size(); ++row)
+      rowIndex.insert(ids[row], row);
+  }
+  return rowIndex.value(videoId, -1);
+}
+
+int VideoTableModel::insertPosition(const QByteArray &key, int videoId) const {
+  // Upper bound on (sortKey, videoID); QByteArray compares like memcmp,
+  // which is how SQLite orders BLOBs. Keys are not kept per row: the few
+  // probed here are rebuilt from the path, like Video.sortKey was.
+  int low = 0, high = int(ids.size());
+  while (low < high) {
+    const int mid = (low + high) / 2;
+    const int cmp =
+        naturalSortKey(pathStore.path(paths[mid])).compare(key);
+    if (cmp < 0 || (cmp == 0 && ids[mid] <= videoId))
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+void VideoTableModel::insertVideoRows(int row, const QVector<NewRow> &rows,
+                                      int from, int count) {
+  beginInsertRows(QModelIndex(), row, row + count - 1);
+  ids.insert(row, count, 0);
+  paths.insert(row, count, 0);
+  watched.insert(row, count, 0);
+  durations.insert(row, count, -1);
+  for (int i = 0; i < count; ++i) {
+    const NewRow &added = rows[from + i];
+    ids[row + i] = added.vdo.videoID;
+    paths[row + i] = pathStore.add(added.vdo.videoPath);
+    watched[row + i] = added.vdo.isWatched ? 1 : 0;
+    durations[row + i] = added.durationMs;
+  }
+  rowIndex.clear(); // rebuilt once, on the next rowOf()
+  endInsertRows();
+}
+
+void VideoTableModel::removeVideoRows(int first, int last) {
+  const int count = last - first + 1;
+  beginRemoveRows(QModelIndex(), first, last);
+  ids.remove(first, count);
+  paths.remove(first, count);
+  watched.remove(first, count);
+  durations.remove(first, count);
+  rowIndex.clear();
+  endRemoveRows();
+}
+
+int VideoTableModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : int(ids.size());
+}
+
+int VideoTableModel::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant VideoTableModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= ids.size())
+    return QVariant();
+  const int row = index.row();
+
+  if (index.column() == WatchedColumn) {
+    if (role == Qt::CheckStateRole)
+      return watched[row] ? Qt::Checked : Qt::Unchecked;
+    if (role == Qt::UserRole)
+      return ids[row];
+  } else if (index.column() == NameColumn) {
+    // Only rows that are painted ever get their name decoded
+    if (role == Qt::DisplayRole)
+      return pathStore.fileName(paths[row]);
+    if (role == Qt::ToolTipRole)
+      return pathStore.path(paths[row]);
+    if (role == Qt::DecorationRole && thumbnails) {
+      const QPixmap thumb =
+          thumbnails->cached(pathStore.path(paths[row]), thumbnailWidth);
+      if (!thumb.isNull())
+        return thumb;
+    }
+  } else if (index.column() == DurationColumn) {
+    if (role == Qt::DisplayRole)
+      return formatDuration(durations[row]);
+    if (role == Qt::TextAlignmentRole)
+      return int(Qt::AlignRight | Qt::AlignVCenter);
+  }
+  return QVariant();
+}
+
+bool VideoTableModel::setData(const QModelIndex &index, const QVariant &value,
+                              int role) {
+  if (!index.isValid() || index.column() != WatchedColumn ||
+      role != Qt::CheckStateRole)
+    return false;
+
+  const quint8 isWatched = value.toInt() == Qt::Checked ? 1 : 0;
+  if (watched[index.row()] == isWatched)
+    return false;
+  watched[index.row()] = isWatched;
+  emit dataChanged(index, index, {Qt::CheckStateRole});
+  emit watchedToggled(ids[index.row()], isWatched);
+  return true;
+}
+
+Qt::ItemFlags VideoTableModel::flags(const QModelIndex &index) const {
+  if (!index.isValid())
+    return Qt::NoItemFlags;
+  // Read-only name (user can't rename the file here)
+  Qt::ItemFlags itemFlags = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+  if (index.column() == WatchedColumn)
+    itemFlags |= Qt::ItemIsUserCheckable;
+  return itemFlags;
+}
+
+QVariant VideoTableModel::headerData(int section, Qt::Orientation orientation,
+                                     int role) const {
+  if (role != Qt::DisplayRole)
+    return QVariant();
+  if (orientation == Qt::Vertical)
+    return section + 1;
+  switch (section) {
+  case WatchedColumn:
+    return "Watched";
+  case NameColumn:
+    return "Video Name";
+  case DurationColumn:
+    return "Duration";
+  default:
+    return QVariant();
+  }
+}
+
+bool VideoTableModel::canFetchMore(const QModelIndex &parent) const {
+  return !parent.isValid() && !allFetched;
+}
+
+void VideoTableModel::fetchMore(const QModelIndex &parent) {
+  if (parent.isValid() || allFetched)
+    return;
+  PLC_TRACE_SPAN(span, "model.fetchMore");
+
+  // Keyset paging: continue after the last fetched (sortKey, videoID), no
+  // OFFSET scans; idx_video_playlist_sortkey hands rows out in order. A
+  // delta that removed that row since does not matter, the pair still
+  // marks where the next page starts.
+  QSqlQuery query =
+      pageEndId < 0
+          ? SQliteDB::instance()->execPrepared(
+                "SELECT videoID, videoPath, isWatched, durationMs, sortKey "
+                "FROM Video WHERE playlistID = ? "
+                "ORDER BY sortKey, videoID LIMIT ?",
+                {currentPlaylistId, kPageSize})
+          : SQliteDB::instance()->execPrepared(
+                "SELECT videoID, videoPath, isWatched, durationMs, sortKey "
+                "FROM Video WHERE playlistID = ? "
+                "AND (sortKey, videoID) > (?, ?) "
+                "ORDER BY sortKey, videoID LIMIT ?",
+                {currentPlaylistId, pageEndKey, pageEndId, kPageSize});
+
+  QVector<int> pageIds;
+  QVector<PathStore::Handle> pagePaths;
+  QVector<quint8> pageWatched;
+  QVector<qint64> pageDurations;
+  pageIds.reserve(kPageSize);
+  pagePaths.reserve(kPageSize);
+  pageWatched.reserve(kPageSize);
+  pageDurations.reserve(kPageSize);
+  while (query.next()) {
+    pageIds.append(query.value(0).toInt());
+    pagePaths.append(pathStore.add(query.value(1).toString()));
+    pageWatched.append(query.value(2).toInt() ? 1 : 0);
+    const QVariant duration = query.value(3);
+    pageDurations.append(duration.isNull() ? -1 : duration.toLongLong());
+    pageEndKey = query.value(4).toByteArray();
+  }
+
+  PLC_TRACE_ROWS(span, pageIds.size());
+  allFetched = pageIds.size() < kPageSize;
+  if (pageIds.isEmpty())
+    return;
+  pageEndId = pageIds.last();
+
+  const int first = int(ids.size());
+  beginInsertRows(QModelIndex(), first, first + int(pageIds.size()) - 1);
+  // Appending keeps the row map valid, no rebuild per page
+  if (rowIndex.size() == first) {
+    for (int i = 0; i < pageIds.size(); ++i)
+      rowIndex.insert(pageIds[i], first + i);
+  }
+  ids.append(pageIds);
+  paths.append(pagePaths);
+  watched.append(pageWatched);
+  durations.append(pageDurations);
+  endInsertRows();
+}
+
+bool VideoTableModel::setWatched(int videoId, bool isWatched) {
+  const int row = rowOf(videoId);
+  if (row < 0)
+    return false;
+  setData(index(row, WatchedColumn), isWatched ? Qt::Checked : Qt::Unchecked,
+          Qt::CheckStateRole);
+  return true;
+}
+
+int VideoTableModel::fetchUntil(int videoId) {
+  int row = rowOf(videoId);
+  while (row < 0 && !allFetched) {
+    fetchMore(QModelIndex());
+    row = rowOf(videoId);
+  }
+  return row;
+}
+
+void VideoTableModel::applyDelta(const VideoDelta &delta) {
+  if (delta.playlistId != currentPlaylistId)
+    return;
+
+  // 1. Every lookup against one row map, before any row moves. Renamed
+  // rows keep their videoID, watched state and duration, but the new name
+  // may sort elsewhere: taken out and put back where a reload would put it.
+  QVector<int> dropRows;
+  QVector<NewRow> incoming;
+  for (int videoId : delta.removedIds) {
+    const int row = rowOf(videoId);
+    if (row >= 0)
+      dropRows.append(row);
+  }
+  for (const Video &vdo : delta.renamed) {
+    const int row = rowOf(vdo.videoID);
+    if (row < 0) {
+      // Old row not paged in yet: the new name may sort into the loaded
+      // part, so it comes in like an added row (step 3 skips it otherwise)
+      incoming.append({naturalSortKey(vdo.videoPath), vdo,
+                       delta.renamedDurations.value(vdo.videoID, -1)});
+      continue;
+    }
+    dropRows.append(row);
+    Video moved = vdo;
+    moved.isWatched = watched[row];
+    incoming.append({naturalSortKey(vdo.videoPath), moved, durations[row]});
+  }
+  for (const Video &vdo : delta.added) {
+    if (rowOf(vdo.videoID) < 0) // -1: the prober picks new files up
+      incoming.append({naturalSortKey(vdo.videoPath), vdo, -1});
+  }
+
+  // 2. Removed rows, bottom up, neighbours in one go
+  std::sort(dropRows.begin(), dropRows.end(), std::greater<int>());
+  dropRows.erase(std::unique(dropRows.begin(), dropRows.end()),
+                 dropRows.end());
+  for (int i = 0; i < dropRows.size();) {
+    const int last = dropRows[i];
+    int first = last;
+    while (++i < dropRows.size() && dropRows[i] == first - 1)
+      first = dropRows[i];
+    removeVideoRows(first, last);
+  }
+
+  // 3. New rows go where a reload (ORDER BY sortKey, videoID) would put
+  // them; the keys are the ones VideoIngest stored. Positions are taken
+  // before inserting, rows for one position go in as one run, last run
+  // first so the earlier positions stay valid.
+  std::sort(incoming.begin(), incoming.end(),
+            [](const NewRow &a, const NewRow &b) {
+              const int cmp = a.key.compare(b.key);
+              return cmp < 0 || (cmp == 0 && a.vdo.videoID < b.vdo.videoID);
+            });
+  QVector<int> positions(incoming.size());
+  for (int i = 0; i < incoming.size(); ++i)
+    positions[i] = insertPosition(incoming[i].key, incoming[i].vdo.videoID);
+  for (int end = int(incoming.size()); end > 0;) {
+    int begin = end - 1;
+    while (begin > 0 && positions[begin - 1] == positions[end - 1])
+      --begin;
+    const int row = positions[begin];
+    // Past the last loaded page rows are picked up by fetchMore() instead
+    if (allFetched || row < ids.size())
+      insertVideoRows(row, incoming, begin, end - begin);
+    end = begin;
+  }
+}
+
+void VideoTableModel::applyDurations(int playlistId,
+                                     const QHash<int, qint64> &probed) {
+  if (playlistId != currentPlaylistId)
+    return;
+  // Batches follow videoID order, not the row order: one dataChanged over
+  // the span of touched rows
+  int first = -1, last = -1;
+  for (auto it = probed.cbegin(); it != probed.cend(); ++it) {
+    const int row = rowOf(it.key());
+    if (row < 0)
+      continue; // not paged in yet, fetchMore() reads it from the DB
+    durations[row] = it.value();
+    first = first < 0 ? row : qMin(first, row);
+    last = qMax(last, row);
+  }
+  if (first >= 0)
+    emit dataChanged(index(first, DurationColumn), index(last, DurationColumn),
+                     {Qt::DisplayRole});
+}
+
+QString VideoTableModel::formatDuration(qint64 ms) {
+  if (ms <= 0)
+    return QString();
+  const qint64 seconds = ms / 1000;
+  const qint64 hours = seconds / 3600;
+  const int minutes = int(seconds / 60 % 60);
+  const int secs = int(seconds % 60);
+  if (hours > 0)
+    return QString("%1:%2:%3")
+        .arg(hours)
+        .arg(minutes, 2, 10, QChar('0'))
+        .arg(secs, 2, 10, QChar('0'));
+  return QString("%1:%2").arg(minutes).arg(secs, 2, 10, QChar('0'));
+}
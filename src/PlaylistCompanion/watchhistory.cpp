@@ -0,0 +1,139 @@
+#include "include/watchhistory.h"
+#include "include/db_sqlite.h"
+#include "include/dbwriter.h"
+
+#include <QStringList>
+
+QFuture<WriteResult> WatchHistory::recordSession(int playlistId, int videoId,
+                                                 int seconds) {
+  if (playlistId <= 0 || seconds <= 0)
+    return {}; // opened and closed again: not a session worth counting
+  historydebug << "session of video" << videoId << ":" << seconds << "s";
+  return DbWriter::instance()->enqueue(
+      "INSERT INTO WatchEvent(playlistID, videoID, kind, seconds) "
+      "VALUES (?, ?, 'session', ?)",
+      {playlistId, videoId, seconds});
+}
+
+QVector<WatchPeriod> WatchHistory::loadPeriods(const char *sql,
+                                               const QDate &from) {
+  QSqlQuery query = SQliteDB::instance()->execRead(
+      sql, {from.toString(Qt::ISODate)});
+  QVector<WatchPeriod> periods;
+  while (query.next()) {
+    WatchPeriod period;
+    period.start = QDate::fromString(query.value(0).toString(), Qt::ISODate);
+    period.secondsWatched = query.value(1).toLongLong();
+    period.videosFinished = query.value(2).toInt();
+    period.sessions = query.value(3).toInt();
+    periods.append(period);
+  }
+  return periods;
+}
+
+WatchStats WatchHistory::load() {
+  WatchStats stats;
+  const QDate today = QDate::currentDate();
+
+  // 1. Days and weeks: primary key ranges
+  stats.days = loadPeriods("SELECT day, secondsWatched, videosFinished, "
+                           "sessions FROM WatchDaily WHERE day >= ? "
+                           "ORDER BY day",
+                           today.addDays(1 - kDays));
+  const QDate monday = today.addDays(1 - today.dayOfWeek());
+  stats.weeks = loadPeriods("SELECT week, secondsWatched, videosFinished, "
+                            "sessions FROM WatchWeekly WHERE week >= ? "
+                            "ORDER BY week",
+                            monday.addDays(-7 * (kWeeks - 1)));
+
+  // 2. One row per playlist ever watched
+  QSqlQuery totals = SQliteDB::instance()->execRead(
+      "SELECT t.playlistID, IFNULL(p.playlistTitle, ''), t.secondsWatched, "
+      "t.videosFinished, t.sessions "
+      "FROM WatchPlaylistTotal t "
+      "LEFT JOIN Playlist p ON p.playlistId = t.playlistID "
+      "ORDER BY t.secondsWatched DESC, t.videosFinished DESC");
+  while (totals.next()) {
+    PlaylistWatchTotal total;
+    total.playlistId = totals.value(0).toInt();
+    total.playlistTitle = totals.value(1).toString();
+    total.secondsWatched = totals.value(2).toLongLong();
+    total.videosFinished = totals.value(3).toInt();
+    total.sessions = totals.value(4).toInt();
+    stats.playlists.append(total);
+  }
+
+  // 3. The stored streak ends on its last day; a gap since breaks it
+  QSqlQuery streak = SQliteDB::instance()->execRead(
+      "SELECT lastDay, currentDays, longestDays FROM WatchStreak WHERE id = 1");
+  if (streak.next()) {
+    const QDate lastDay =
+        QDate::fromString(streak.value(0).toString(), Qt::ISODate);
+    if (lastDay.isValid() && lastDay.daysTo(today) <= 1)
+      stats.currentStreak = streak.value(1).toInt();
+    stats.longestStreak = streak.value(2).toInt();
+  }
+  return stats;
+}
+
+QString WatchHistory::formatSeconds(qint64 seconds) {
+  const qint64 minutes = (seconds + 30) / 60;
+  if (minutes < 60)
+    return QString("%1 min").arg(minutes);
+  return QString("%1 h %2 min")
+      .arg(minutes / 60)
+      .arg(minutes % 60, 2, 10, QChar('0'));
+}
+
+QString WatchHistory::summary(const WatchStats &stats) {
+  const QDate today = QDate::currentDate();
+  const QDate monday = today.addDays(1 - today.dayOfWeek());
+  WatchPeriod todayTotal;
+  WatchPeriod weekTotal;
+  qint64 lastDaysSeconds = 0;
+  for (const WatchPeriod &day : stats.days) {
+    lastDaysSeconds += day.secondsWatched;
+    if (day.start == today)
+      todayTotal = day;
+  }
+  for (const WatchPeriod &week : stats.weeks) {
+    if (week.start == monday)
+      weekTotal = week;
+  }
+
+  QStringList lines;
+  lines << QString("Today: %1, %2 videos finished")
+               .arg(formatSeconds(todayTotal.secondsWatched))
+               .arg(todayTotal.videosFinished);
+  lines << QString("This week: %1, %2 videos finished")
+               .arg(formatSeconds(weekTotal.secondsWatched))
+               .arg(weekTotal.videosFinished);
+  lines << QString("Last %1 days: %2").arg(kDays).arg(
+      formatSeconds(lastDaysSeconds));
+  lines << QString("Streak: %1 days (longest %2)")
+               .arg(stats.currentStreak)
+               .arg(stats.longestStreak);
+
+  if (!stats.weeks.isEmpty()) {
+    lines << "" << "Weeks:";
+    for (const WatchPeriod &week : stats.weeks)
+      lines << QString("  %1  %2, %3 finished")
+                   .arg(week.start.toString("d MMM"))
+                   .arg(formatSeconds(week.secondsWatched))
+                   .arg(week.videosFinished);
+  }
+
+  if (!stats.playlists.isEmpty()) {
+    lines << "" << "Playlists:";
+    for (const PlaylistWatchTotal &total : stats.playlists) {
+      const QString title = total.playlistTitle.isEmpty()
+                                ? QString("(removed playlist)")
+                                : total.playlistTitle;
+      lines << QString("  %1: %2, %3 finished")
+                   .arg(title)
+                   .arg(formatSeconds(total.secondsWatched))
+                   .arg(total.videosFinished);
+    }
+  }
+  return lines.join('\n');
+}